@@ -3,6 +3,7 @@
 
 #include "System/Types.hpp"
 #include "System/KeyCode.hpp"
+#include "System/EventCoalesce.hpp"
 
 
 namespace Cider {
@@ -16,8 +17,11 @@ struct OnWindowWillClose
 };
 
 
+// リサイズ中に連続して積まれた場合は最後の大きさだけを配送する
 struct OnResizeWindow
 {
+    static constexpr System::EVENT_COALESCE COALESCE = System::EVENT_COALESCE::KEEP_LAST;
+
     UInt32 width;
     UInt32 height;
 };
@@ -1,6 +1,10 @@
 ﻿#pragma once
 
 #include "System/Event.hpp"
+#include "System/EventBus.hpp"
+#include "System/JobSystem.hpp"
+#include "GameSystem/Archetype.hpp"
+#include <mutex>
 
 
 namespace Cider {
@@ -9,8 +13,16 @@ namespace GameSystem {
 
 struct OnStart {};
 struct OnDestroy {};
+// 同じフレームに複数回積まれた場合は経過時間を合算して 1 回だけ配送する
 struct OnUpdate
 {
+    static constexpr System::EVENT_COALESCE COALESCE = System::EVENT_COALESCE::MERGE;
+
+    static Void Merge(OnUpdate& pending, const OnUpdate& incoming)
+    {
+        pending.deltaTime += incoming.deltaTime;
+    }
+
     Double deltaTime;
 };
 
@@ -35,12 +47,39 @@ public:
         EntityManager::Instance()->BroadcastEvent(eventData);
     }
 
+    /*
+        HandleEvent と SubscribeEvent したハンドラを呼ぶスレッド
+        ・1 つのエンティティのコンポーネントは、同時には呼ばれない (登録順に 1 つずつ呼ばれる)
+        ・EntityManager が DISPATCH_MODE::PARALLEL の場合、別のエンティティのコンポーネントは別のスレッドから同時に呼ばれる
+          - 自分のエンティティのコンポーネント以外と共有する状態は、ハンドラの側で同期する
+          - PostEvent / BroadcastEvent / DestroyEntity は呼べる (配送は次の DispatchEvent)
+          - CreateEntity / RegisterComponent / UnregisterComponent は呼べない
+          - AddDataComponent / RemoveDataComponent は呼べない (GetDataComponent で自分のエンティティの値を読み書きするのは構わない)
+        ・呼ばれるスレッドは DispatchEvent のたびに変わりうる (スレッドごとの状態に頼らない)
+    */
+
+    // 型を問わず全てのイベントを受け取る
     virtual Void HandleEvent(const System::SystemEvent&) {}
 
+    // エンティティへの登録時に呼ばれる。必要なイベント型だけを SubscribeEvent で購読する
+    virtual Void RegisterEventHandlers(System::SystemEventBus&) {}
+
     virtual const Char* GetComponentName() const { return "Component"; }
 
+protected:
+    // 購読はコンポーネントの破棄時に解除される
+    template<typename T, typename Handler>
+    Void SubscribeEvent(System::SystemEventBus& eventBus, Handler&& handler)
+    {
+        m_eventConnections.emplace_back();
+        m_eventConnections.back() = eventBus.Subscribe<T>(std::forward<Handler>(handler));
+    }
+
 protected:
     STL::weak_ptr<Entity> m_ownerEntity;
+
+private:
+    STL::vector<System::ScopedConnection> m_eventConnections;
 };
 
 
@@ -80,10 +119,25 @@ public:
     template<typename T>
     Void PostEvent(T&& eventData)
     {
-        m_eventQueue.Enqueue<T>(std::forward<T>(eventData));
+        m_eventBus.Enqueue<std::decay_t<T>>(std::forward<T>(eventData));
     }
 
-    Void DispatchEvent();
+    // frameCount 回後の DispatchEvent で配送する
+    template<typename T>
+    Void PostEventAfterFrames(UInt32 frameCount, T&& eventData)
+    {
+        m_eventBus.EnqueueAfterFrames<std::decay_t<T>>(frameCount, std::forward<T>(eventData));
+    }
+
+    // DispatchEvent に渡した経過時間が delay 秒進んだ DispatchEvent で配送する
+    template<typename T>
+    Void PostEventAfterTime(Double delay, T&& eventData)
+    {
+        m_eventBus.EnqueueAfterTime<std::decay_t<T>>(delay, std::forward<T>(eventData));
+    }
+
+    // deltaTime は前回からの経過時間 (秒)
+    Void DispatchEvent(Double deltaTime = 0.0);
 
     Void RegisterComponent(const Char* componentName);
 
@@ -91,11 +145,28 @@ public:
 
 private:
     System::ScopedConnection                m_eventConnection;
-    System::SystemEventQueue         m_eventQueue;
+    System::SystemEventBus                  m_eventBus;
     STL::list<STL::shared_ptr<Component>>   m_componentList;
 };
 
 
+// EntityManager::DispatchEvent の配送方法
+enum class DISPATCH_MODE
+{
+    SERIAL          // 呼び出したスレッドでエンティティを順に配送する
+    , PARALLEL      // エンティティごとに JobSystem で並列に配送する (Component::HandleEvent の制約を参照)
+};
+
+
+/*
+    エンティティの管理
+    ・エンティティID は下位 32 ビットがスロットの番号、上位 32 ビットが世代
+      スロットは破棄後に再利用し、世代が変わるため破棄済みの ID は別のエンティティを指さない
+    ・ID 0 は無効 (世代は 1 から始まる)
+    ・エンティティは詰めた配列に並べ、破棄時は末尾と入れ替えて詰める (配送順は生成順とは限らない)
+    ・Component とは別に、データコンポーネント (トリビアルにコピーできる構造体) を持てる
+      組み合わせごとにまとめて保持し (ArchetypeStorage)、ForEach で配列のまま処理する
+*/
 class EntityManager
 {
 public:
@@ -109,26 +180,50 @@ public:
     template<typename T>
     Void PostEvent(UInt64 entityId, T&& eventData)
     {
-        auto entityIt = m_entityTable.find(entityId);
+        if (auto entity = FindEntity(entityId))
+        {
+            entity->PostEvent(eventData);
+        }
+    }
 
-        if (entityIt != std::end(m_entityTable))
+    template<typename T>
+    Void PostEventAfterFrames(UInt64 entityId, UInt32 frameCount, T&& eventData)
+    {
+        if (auto entity = FindEntity(entityId))
+        {
+            entity->PostEventAfterFrames(frameCount, eventData);
+        }
+    }
+
+    template<typename T>
+    Void PostEventAfterTime(UInt64 entityId, Double delay, T&& eventData)
+    {
+        if (auto entity = FindEntity(entityId))
         {
-            CIDER_ASSERT((*entityIt).second, "");
-            (*entityIt).second->PostEvent(eventData);
+            entity->PostEventAfterTime(delay, eventData);
         }
     }
 
     template<typename T>
     Void BroadcastEvent(T&& eventData)
     {
-        for (auto& entityPair : m_entityTable)
+        for (auto& entity : m_entities)
         {
-            CIDER_ASSERT(entityPair.second, "");
-            entityPair.second->PostEvent(eventData);
+            CIDER_ASSERT(entity, "");
+            entity->PostEvent(eventData);
         }
     }
 
-    Void DispatchEvent();
+    Void DispatchEvent(Double deltaTime = 0.0);
+
+    // jobSystem は PARALLEL の配送と ParallelForEach で使う (nullptr なら JobSystem::Instance())
+    // 呼び出すたびに指定し直すため、借りた JobSystem を破棄する前に nullptr で呼び直すこと
+    Void SetDispatchMode(DISPATCH_MODE dispatchMode, System::JobSystem* jobSystem = nullptr);
+
+    DISPATCH_MODE GetDispatchMode() const
+    {
+        return m_dispatchMode;
+    }
 
     UInt64 CreateEntity();
 
@@ -138,15 +233,122 @@ public:
 
     Void UnregisterComponent(UInt64 entityId, const Char* componentName);
 
+    // 破棄を反映する前 (DestroyEntity の後、次の DispatchEvent まで) は true
+    Bool IsEntityAlive(UInt64 entityId) const
+    {
+        return FindEntity(entityId) != nullptr;
+    }
+
+    SizeT GetEntityCount() const
+    {
+        return m_entities.size();
+    }
+
+    // 生きていないエンティティには追加せずに nullptr を返す
+    // 返したポインタは、次にデータコンポーネントを追加・削除するまで有効
+    template<typename T>
+    T* AddDataComponent(UInt64 entityId, const T& value = T())
+    {
+        return FindEntity(entityId) ? &m_dataComponents.Add(entityId, value) : nullptr;
+    }
+
+    template<typename T>
+    Void RemoveDataComponent(UInt64 entityId)
+    {
+        m_dataComponents.Remove<T>(entityId);
+    }
+
+    template<typename T>
+    T* GetDataComponent(UInt64 entityId) const
+    {
+        return m_dataComponents.Get<T>(entityId);
+    }
+
+    // Types を全て持つエンティティについて function(Types&...) を呼ぶ
+    template<typename...Types, typename Function>
+    Void ForEach(Function&& function)
+    {
+        m_dataComponents.ForEach<Types...>(std::forward<Function>(function));
+    }
+
+    // チャンクを単位に SetDispatchMode の JobSystem (無ければ JobSystem::Instance()) で並列に ForEach する
+    template<typename...Types, typename Function>
+    Void ParallelForEach(Function&& function)
+    {
+        auto jobSystem = m_jobSystem ? m_jobSystem : System::JobSystem::Instance();
+        m_dataComponents.ParallelForEach<Types...>(*jobSystem, std::forward<Function>(function));
+    }
+
+    ArchetypeStorage& GetDataComponents()
+    {
+        return m_dataComponents;
+    }
+
 private:
+    // 空きスロットの nextFreeIndex の終端
+    static constexpr UInt32 INVALID_INDEX = 0xffffffff;
+
+    struct EntitySlot
+    {
+        UInt32 generation;
+        union
+        {
+            UInt32 entityIndex;     // 使用中 : m_entities の位置
+            UInt32 nextFreeIndex;   // 空き   : 次の空きスロット
+        };
+    };
+
+    static UInt32 GetSlotIndex(UInt64 entityId)
+    {
+        return static_cast<UInt32>(entityId);
+    }
+
+    static UInt32 GetGeneration(UInt64 entityId)
+    {
+        return static_cast<UInt32>(entityId >> 32);
+    }
+
+    Entity* FindEntity(UInt64 entityId) const
+    {
+        const UInt32 slotIndex = GetSlotIndex(entityId);
+
+        if (slotIndex >= m_entitySlots.size())
+        {
+            return nullptr;
+        }
+
+        // 空きスロットは破棄時に世代を進めているため一致しない
+        const EntitySlot& slot = m_entitySlots[slotIndex];
+
+        if (slot.generation != GetGeneration(entityId))
+        {
+            return nullptr;
+        }
+
+        CIDER_ASSERT(m_entities[slot.entityIndex], "");
+        return m_entities[slot.entityIndex].get();
+    }
+
     void ApplyDestroyEntityIds();
 
 private:
-    typedef STL::map<UInt64, STL::shared_ptr<Entity>> EntityTableType;
+    // PARALLEL で 1 つのジョブが配送するエンティティの数
+    static constexpr SizeT DISPATCH_GRAIN_SIZE = 128;
+
+    STL::vector<EntitySlot> m_entitySlots;
+    UInt32 m_freeSlotIndex;                         // 空きスロットの先頭 (無ければ INVALID_INDEX)
+
+    // 生きているエンティティを詰めて並べる (同じ位置にスロットの番号)
+    STL::vector<STL::shared_ptr<Entity>> m_entities;
+    STL::vector<UInt32> m_entitySlotIndices;
+
+    ArchetypeStorage m_dataComponents;
 
-    UInt64 m_nextEntityId;
-    EntityTableType m_entityTable;
     STL::vector<UInt64> m_destroyEntityIds;
+    std::mutex m_destroyLock;   // DestroyEntity は並列の配送中にも呼ばれる
+
+    DISPATCH_MODE m_dispatchMode;
+    System::JobSystem* m_jobSystem;
 };
 
 
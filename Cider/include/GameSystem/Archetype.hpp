@@ -0,0 +1,402 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/STL.hpp"
+#include "System/Assert.hpp"
+#include "System/Memory.hpp"
+#include "System/JobSystem.hpp"
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace Cider {
+namespace GameSystem {
+
+
+// データコンポーネントの組み合わせ (型ごとに 1 ビット)
+typedef UInt64 DataComponentMask;
+
+
+namespace Detail {
+
+
+// 登録できるデータコンポーネントの型の数
+static constexpr UInt32 MAX_DATA_COMPONENT_TYPES = 64;
+
+
+struct DataComponentType
+{
+    SizeT size;
+    SizeT alignment;
+};
+
+
+// 型を登録してビット位置を割り当てる (任意のスレッドから呼べる)
+UInt32 RegisterDataComponentType(SizeT size, SizeT alignment);
+
+DataComponentType GetDataComponentType(UInt32 typeIndex);
+
+
+template<typename T>
+struct DataComponentTypeOf final
+{
+    static_assert(std::is_trivially_copyable_v<T>, "data component must be trivially copyable.");
+    static_assert(std::is_trivially_destructible_v<T>, "data component must be trivially destructible.");
+    static_assert(!std::is_pointer_v<T>, "<T> is not pointer.");
+
+    // 最初に使った時に登録する (順序は実行ごとに変わりうる)
+    static UInt32 GetIndex()
+    {
+        static const UInt32 index = RegisterDataComponentType(sizeof(T), alignof(T));
+        return index;
+    }
+};
+
+
+template<typename T>
+UInt32 DataComponentIndexOf()
+{
+    return DataComponentTypeOf<std::remove_cv_t<T>>::GetIndex();
+}
+
+
+template<typename...Types>
+DataComponentMask DataComponentMaskOf()
+{
+    DataComponentMask mask = 0;
+
+    for (const UInt32 index : { DataComponentIndexOf<Types>()... })
+    {
+        CIDER_ASSERT((mask & (1ull << index)) == 0, "duplicated data component type.");
+        mask |= 1ull << index;
+    }
+
+    return mask;
+}
+
+
+} // namespace Detail
+
+
+/*
+    同じデータコンポーネントの組み合わせを持つエンティティの集まり
+    ・CHUNK_SIZE のチャンクに、型ごとの配列 (SoA) とエンティティID の配列を並べる
+    ・行は先頭のチャンクから詰めて並べ、削除時は最後の行を移して詰める (末尾のチャンク以外は常に満杯)
+*/
+class Archetype final : public System::BaseAllocator<System::MEMORY_AREA::SYSTEM>
+{
+public:
+    static constexpr SizeT CHUNK_SIZE = 16 * 1024;
+    static constexpr SizeT CHUNK_ALIGNMENT = 64;
+
+    explicit Archetype(DataComponentMask mask);
+
+    ~Archetype();
+
+    Archetype(const Archetype&) = delete;
+    Void operator=(const Archetype&) = delete;
+
+    DataComponentMask GetMask() const
+    {
+        return m_mask;
+    }
+
+    Bool Contains(UInt32 typeIndex) const
+    {
+        return (m_mask & (1ull << typeIndex)) != 0;
+    }
+
+    // 1 つのチャンクに入る行の数
+    SizeT GetChunkCapacity() const
+    {
+        return m_chunkCapacity;
+    }
+
+    SizeT GetChunkCount() const
+    {
+        return m_chunks.size();
+    }
+
+    SizeT GetRowCount(SizeT chunkIndex) const
+    {
+        return m_chunks[chunkIndex].rowCount;
+    }
+
+    SizeT GetEntityCount() const
+    {
+        return m_chunks.empty() ? 0 : (m_chunks.size() - 1) * m_chunkCapacity + m_chunks.back().rowCount;
+    }
+
+    Void* GetArray(SizeT chunkIndex, UInt32 typeIndex) const
+    {
+        CIDER_ASSERT(Contains(typeIndex), "");
+        return m_chunks[chunkIndex].memory + m_offsets[typeIndex];
+    }
+
+    template<typename T>
+    T* GetArray(SizeT chunkIndex) const
+    {
+        return static_cast<T*>(GetArray(chunkIndex, Detail::DataComponentIndexOf<T>()));
+    }
+
+    SizeT GetComponentSize(UInt32 typeIndex) const
+    {
+        CIDER_ASSERT(Contains(typeIndex), "");
+        return m_sizes[typeIndex];
+    }
+
+    Void* GetComponent(SizeT chunkIndex, SizeT row, UInt32 typeIndex) const
+    {
+        return static_cast<UInt8*>(GetArray(chunkIndex, typeIndex)) + m_sizes[typeIndex] * row;
+    }
+
+    const UInt64* GetEntityIds(SizeT chunkIndex) const
+    {
+        return reinterpret_cast<const UInt64*>(m_chunks[chunkIndex].memory);
+    }
+
+    // 末尾に行を追加する (コンポーネントは未初期化)
+    Void AddRow(UInt64 entityId, UInt32& chunkIndex, UInt32& row);
+
+    // 行を削除し、最後の行を移して詰める
+    // 移したエンティティのIDを返す (移さなかった場合は 0)
+    UInt64 RemoveRow(UInt32 chunkIndex, UInt32 row);
+
+private:
+    struct Chunk
+    {
+        UInt8*  memory;
+        SizeT   rowCount;
+    };
+
+    UInt8* AllocateChunk();
+
+private:
+    DataComponentMask       m_mask;
+    SizeT                   m_chunkCapacity;
+    UInt32                  m_offsets[Detail::MAX_DATA_COMPONENT_TYPES];   // チャンク内の配列の位置 (型のビット位置ごと)
+    UInt32                  m_sizes[Detail::MAX_DATA_COMPONENT_TYPES];
+    STL::vector<Chunk>      m_chunks;
+    UInt8*                  m_spareChunk;   // 追加と削除を繰り返しても確保し直さないよう 1 つだけ残す
+};
+
+
+/*
+    データコンポーネントのアーキタイプ別の保管庫
+    ・データコンポーネントはトリビアルにコピーできる構造体で、仮想関数の Component とは別に持つ
+    ・エンティティのコンポーネントの組み合わせが変わると、行を別のアーキタイプへ移す
+    ・ForEach<A, B> は A と B を両方持つアーキタイプのチャンクを順に、配列のまま渡す
+      const を付けた型は読むだけであることを表す (ParallelForEach で同時に読んでも構わない)
+    ・ForEach の最中は追加と削除をしない
+*/
+class ArchetypeStorage final
+{
+public:
+    ArchetypeStorage() = default;
+
+    ~ArchetypeStorage() = default;
+
+    ArchetypeStorage(const ArchetypeStorage&) = delete;
+    Void operator=(const ArchetypeStorage&) = delete;
+
+    // 既に持っている場合は値を上書きする
+    template<typename T>
+    T& Add(UInt64 entityId, const T& value)
+    {
+        // value が移動する行を指している場合に備えて先に写す
+        const T copiedValue = value;
+        const UInt32 typeIndex = Detail::DataComponentIndexOf<T>();
+
+        EntityLocation& location = GetLocation(entityId);
+
+        if (!location.archetype || !location.archetype->Contains(typeIndex))
+        {
+            const DataComponentMask mask = location.archetype ? location.archetype->GetMask() : 0;
+            MoveEntity(location, mask | (1ull << typeIndex));
+        }
+
+        T* component = location.archetype->GetArray<T>(location.chunkIndex) + location.row;
+        *component = copiedValue;
+        return *component;
+    }
+
+    template<typename T>
+    Void Remove(UInt64 entityId)
+    {
+        const UInt32 typeIndex = Detail::DataComponentIndexOf<T>();
+
+        EntityLocation* location = FindLocation(entityId);
+
+        if (location && location->archetype->Contains(typeIndex))
+        {
+            MoveEntity(*location, location->archetype->GetMask() & ~(1ull << typeIndex));
+        }
+    }
+
+    // 持っていなければ nullptr
+    template<typename T>
+    T* Get(UInt64 entityId) const
+    {
+        const UInt32 typeIndex = Detail::DataComponentIndexOf<T>();
+
+        const EntityLocation* location = FindLocation(entityId);
+
+        if (!location || !location->archetype->Contains(typeIndex))
+        {
+            return nullptr;
+        }
+
+        return location->archetype->GetArray<T>(location->chunkIndex) + location->row;
+    }
+
+    template<typename T>
+    Bool Has(UInt64 entityId) const
+    {
+        return Get<T>(entityId) != nullptr;
+    }
+
+    // エンティティの全てのデータコンポーネントを削除する
+    Void RemoveEntity(UInt64 entityId);
+
+    // function(Types&...) を全ての行について呼ぶ
+    template<typename...Types, typename Function>
+    Void ForEach(Function&& function)
+    {
+        ForEachChunk<Types...>([&function](SizeT rowCount, const UInt64*, Types*...arrays) {
+            ForEachRow(rowCount, function, arrays...);
+        });
+    }
+
+    // function(SizeT rowCount, const UInt64* entityIds, Types*...arrays) をチャンクごとに呼ぶ
+    template<typename...Types, typename Function>
+    Void ForEachChunk(Function&& function)
+    {
+        static_assert(sizeof...(Types) > 0, "");
+
+        const DataComponentMask mask = Detail::DataComponentMaskOf<Types...>();
+
+#ifdef _DEBUG
+        ++m_iterationDepth;
+#endif
+
+        for (auto& archetype : m_archetypes)
+        {
+            if ((archetype->GetMask() & mask) != mask)
+            {
+                continue;
+            }
+
+            for (SizeT chunkIndex = 0; chunkIndex < archetype->GetChunkCount(); ++chunkIndex)
+            {
+                function(
+                    archetype->GetRowCount(chunkIndex),
+                    archetype->GetEntityIds(chunkIndex),
+                    archetype->GetArray<Types>(chunkIndex)...);
+            }
+        }
+
+#ifdef _DEBUG
+        --m_iterationDepth;
+#endif
+    }
+
+    // チャンクを単位に jobSystem で並列に ForEach する
+    // 同じチャンクの行は同じスレッドで順に処理する
+    template<typename...Types, typename Function>
+    Void ParallelForEach(System::JobSystem& jobSystem, Function&& function)
+    {
+        static_assert(sizeof...(Types) > 0, "");
+
+        const DataComponentMask mask = Detail::DataComponentMaskOf<Types...>();
+
+        // 入れ子や同時に呼ばれた ParallelForEach と共有しないよう、呼び出しごとに集める
+        STL::vector<ParallelChunk> chunks;
+        CollectChunks(mask, chunks);
+
+#ifdef _DEBUG
+        ++m_iterationDepth;
+#endif
+
+        jobSystem.ParallelFor(
+            chunks.size(),
+            1,
+            [&chunks, &function](SizeT begin, SizeT end) {
+            for (SizeT i = begin; i < end; ++i)
+            {
+                const auto& chunk = chunks[i];
+
+                ForEachRow(
+                    chunk.archetype->GetRowCount(chunk.chunkIndex),
+                    function,
+                    chunk.archetype->GetArray<Types>(chunk.chunkIndex)...);
+            }
+        }
+        );
+
+#ifdef _DEBUG
+        --m_iterationDepth;
+#endif
+    }
+
+    // 全てのアーキタイプ (組み合わせごとに 1 つ。空になっても残る)
+    const STL::vector<STL::unique_ptr<Archetype>>& GetArchetypes() const
+    {
+        return m_archetypes;
+    }
+
+private:
+    // m_locations の添字は エンティティID の下位 32 ビット
+    struct EntityLocation
+    {
+        UInt64      entityId = 0;
+        Archetype*  archetype = nullptr;    // データコンポーネントが無ければ nullptr
+        UInt32      chunkIndex = 0;
+        UInt32      row = 0;
+    };
+
+    struct ParallelChunk
+    {
+        Archetype*  archetype;
+        SizeT       chunkIndex;
+    };
+
+    // 配列は関数に渡す前に取り出してあるため、ループの中で別名にならず展開しやすい
+    template<typename Function, typename...Types>
+    static Void ForEachRow(SizeT rowCount, Function& function, Types*...arrays)
+    {
+        for (SizeT row = 0; row < rowCount; ++row)
+        {
+            function(arrays[row]...);
+        }
+    }
+
+    EntityLocation* FindLocation(UInt64 entityId);
+
+    const EntityLocation* FindLocation(UInt64 entityId) const;
+
+    // 無ければ作る
+    EntityLocation& GetLocation(UInt64 entityId);
+
+    // mask のアーキタイプへ行を移す (0 ならどこにも置かない)
+    Void MoveEntity(EntityLocation& location, DataComponentMask mask);
+
+    Archetype* GetOrCreateArchetype(DataComponentMask mask);
+
+    Void CollectChunks(DataComponentMask mask, STL::vector<ParallelChunk>& chunks) const;
+
+private:
+    STL::vector<STL::unique_ptr<Archetype>>                 m_archetypes;
+    STL::unordered_map<DataComponentMask, Archetype*>       m_archetypeTable;
+    STL::vector<EntityLocation>                             m_locations;
+
+#ifdef _DEBUG
+    std::atomic<SizeT>                                      m_iterationDepth { 0 };    // ジョブの中からの ForEach でも数える
+#endif
+};
+
+
+} // namespace GameSystem
+} // namespace Cider
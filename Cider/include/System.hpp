@@ -8,7 +8,16 @@
 #include "System/Memory.hpp"
 #include "System/StackTrace.hpp"
 #include "System/Log.hpp"
+#include "System/LogBinary.hpp"
+#include "System/LogSink.hpp"
 #include "System/STL.hpp"
+#include "System/Delegate.hpp"
+#include "System/Mailbox.hpp"
+#include "System/JobSystem.hpp"
+#include "System/SignalCombiner.hpp"
 #include "System/Signals.hpp"
+#include "System/TimingWheel.hpp"
+#include "System/EventCoalesce.hpp"
 #include "System/Event.hpp"
+#include "System/EventBus.hpp"
 
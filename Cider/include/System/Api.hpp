@@ -6,3 +6,11 @@
 #   define CIDER_APIENTRY __stdcall
 #endif
 
+
+#ifndef CIDER_NOINLINE
+#   if defined(_MSC_VER)
+#       define CIDER_NOINLINE __declspec(noinline)
+#   else
+#       define CIDER_NOINLINE __attribute__((noinline))
+#   endif
+#endif
@@ -0,0 +1,292 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/Memory.hpp"
+#include "System/Assert.hpp"
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+// Delegate がインラインに保持できる呼び出し可能オブジェクトの既定サイズ (バイト)
+// ポインタ 4 個分 (this + キャプチャ 3 個程度) を想定
+#ifndef CIDER_DELEGATE_INLINE_SIZE
+#   define CIDER_DELEGATE_INLINE_SIZE (sizeof(Cider::Void*) * 4)
+#endif
+
+
+namespace Cider {
+namespace System {
+
+
+template<typename Function, SizeT InlineSize = CIDER_DELEGATE_INLINE_SIZE>
+class Delegate;
+
+
+/*
+    std::function の代替
+    ・InlineSize 以下で、ムーブが例外を投げない呼び出し可能オブジェクトはヒープを使わずに保持する
+    ・それを超える場合のみ MEMORY_AREA::SYSTEM から確保する
+    ・トリビアルにコピーできるもの (関数ポインタ、参照キャプチャのラムダ、メンバ関数の束縛) はコピーが memcpy で済む
+*/
+template<typename Result, typename... Arguments, SizeT InlineSize>
+class Delegate<Result(Arguments...), InlineSize> final
+{
+private:
+    static_assert(InlineSize >= sizeof(Void*), "InlineSize must hold at least one pointer.");
+
+    typedef Result(*InvokeFunction)(Void* storage, Arguments&&... arguments);
+
+    // 非トリビアルな保持物のみ使用する (nullptr なら memcpy でコピーでき、破棄も不要)
+    struct Operations
+    {
+        Void(*copy)(Void* destination, const Void* source);
+        Void(*move)(Void* destination, Void* source);
+        Void(*destroy)(Void* storage);
+    };
+
+    template<typename T>
+    static constexpr Bool IsInline =
+        sizeof(T) <= InlineSize &&
+        alignof(T) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<T>;
+
+    template<typename T>
+    static constexpr Bool IsTrivial =
+        IsInline<T> &&
+        std::is_trivially_copyable_v<T> &&
+        std::is_trivially_destructible_v<T>;
+
+public:
+    Delegate() = default;
+
+    Delegate(std::nullptr_t)
+    {}
+
+    template<
+        typename Callable,
+        typename Decayed = std::decay_t<Callable>,
+        std::enable_if_t<
+            !std::is_same_v<Decayed, Delegate> &&
+            std::is_invocable_r_v<Result, Decayed&, Arguments...>, Int32> = 0
+    >
+    Delegate(Callable&& callable)
+    {
+        Assign<Decayed>(std::forward<Callable>(callable));
+    }
+
+    Delegate(const Delegate& other)
+    {
+        CopyFrom(other);
+    }
+
+    Delegate(Delegate&& other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    ~Delegate()
+    {
+        Reset();
+    }
+
+    Delegate& operator=(const Delegate& other)
+    {
+        if (this != &other)
+        {
+            Reset();
+            CopyFrom(other);
+        }
+        return *this;
+    }
+
+    Delegate& operator=(Delegate&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    Delegate& operator=(std::nullptr_t)
+    {
+        Reset();
+        return *this;
+    }
+
+    // オブジェクトとメンバ関数を束縛する (ポインタ 1 個分しか使わない)
+    template<auto Method, typename Class>
+    static Delegate Bind(Class* instance)
+    {
+        CIDER_ASSERT(instance, "");
+
+        return Delegate([instance](Arguments... arguments) -> Result {
+            return (instance->*Method)(std::forward<Arguments>(arguments)...);
+        });
+    }
+
+    Result operator()(Arguments... arguments) const
+    {
+        CIDER_ASSERT(m_invoke, "empty delegate.");
+        return m_invoke(m_storage, std::forward<Arguments>(arguments)...);
+    }
+
+    explicit operator Bool() const
+    {
+        return m_invoke != nullptr;
+    }
+
+    // 確保せずに保持しているか
+    Bool IsInlined() const
+    {
+        return !m_operations || m_operations->move != &MoveHeap;
+    }
+
+    Void Reset()
+    {
+        if (m_operations)
+        {
+            m_operations->destroy(m_storage);
+        }
+
+        m_invoke = nullptr;
+        m_operations = nullptr;
+    }
+
+private:
+    template<typename T, typename Callable>
+    Void Assign(Callable&& callable)
+    {
+        if constexpr (IsInline<T>)
+        {
+            new(m_storage) T(std::forward<Callable>(callable));
+
+            m_invoke = &InvokeInline<T>;
+            m_operations = IsTrivial<T> ? nullptr : &INLINE_OPERATIONS<T>;
+        }
+        else
+        {
+            Void* memory = MemoryManager::MallocDebug(
+                __FILE__, __LINE__, MEMORY_AREA::SYSTEM, sizeof(T), GetHeapAlignment<T>());
+
+            *reinterpret_cast<T**>(m_storage) = new(memory) T(std::forward<Callable>(callable));
+
+            m_invoke = &InvokeHeap<T>;
+            m_operations = &HEAP_OPERATIONS<T>;
+        }
+    }
+
+    Void CopyFrom(const Delegate& other)
+    {
+        if (other.m_operations)
+        {
+            other.m_operations->copy(m_storage, other.m_storage);
+        }
+        else
+        {
+            std::memcpy(m_storage, other.m_storage, InlineSize);
+        }
+
+        m_invoke = other.m_invoke;
+        m_operations = other.m_operations;
+    }
+
+    Void MoveFrom(Delegate& other)
+    {
+        if (other.m_operations)
+        {
+            other.m_operations->move(m_storage, other.m_storage);
+        }
+        else
+        {
+            std::memcpy(m_storage, other.m_storage, InlineSize);
+        }
+
+        m_invoke = other.m_invoke;
+        m_operations = other.m_operations;
+
+        other.m_invoke = nullptr;
+        other.m_operations = nullptr;
+    }
+
+    template<typename T>
+    static constexpr SizeT GetHeapAlignment()
+    {
+        return alignof(T) > MemoryManager::DEFAULT_ALIGNMENT_SIZE ? alignof(T) : MemoryManager::DEFAULT_ALIGNMENT_SIZE;
+    }
+
+    template<typename T>
+    static Result InvokeInline(Void* storage, Arguments&&... arguments)
+    {
+        return (*std::launder(reinterpret_cast<T*>(storage)))(std::forward<Arguments>(arguments)...);
+    }
+
+    template<typename T>
+    static Result InvokeHeap(Void* storage, Arguments&&... arguments)
+    {
+        return (**reinterpret_cast<T**>(storage))(std::forward<Arguments>(arguments)...);
+    }
+
+    template<typename T>
+    static Void CopyInline(Void* destination, const Void* source)
+    {
+        new(destination) T(*std::launder(reinterpret_cast<const T*>(source)));
+    }
+
+    template<typename T>
+    static Void MoveInline(Void* destination, Void* source)
+    {
+        T* value = std::launder(reinterpret_cast<T*>(source));
+        new(destination) T(std::move(*value));
+        value->~T();
+    }
+
+    template<typename T>
+    static Void DestroyInline(Void* storage)
+    {
+        std::launder(reinterpret_cast<T*>(storage))->~T();
+    }
+
+    template<typename T>
+    static Void CopyHeap(Void* destination, const Void* source)
+    {
+        Void* memory = MemoryManager::MallocDebug(
+            __FILE__, __LINE__, MEMORY_AREA::SYSTEM, sizeof(T), GetHeapAlignment<T>());
+
+        *reinterpret_cast<T**>(destination) = new(memory) T(**reinterpret_cast<T* const*>(source));
+    }
+
+    static Void MoveHeap(Void* destination, Void* source)
+    {
+        std::memcpy(destination, source, sizeof(Void*));
+    }
+
+    template<typename T>
+    static Void DestroyHeap(Void* storage)
+    {
+        T* value = *reinterpret_cast<T**>(storage);
+        value->~T();
+        MemoryManager::Free(MEMORY_AREA::SYSTEM, value);
+    }
+
+    template<typename T>
+    static constexpr Operations INLINE_OPERATIONS = { &CopyInline<T>, &MoveInline<T>, &DestroyInline<T> };
+
+    template<typename T>
+    static constexpr Operations HEAP_OPERATIONS = { &CopyHeap<T>, &MoveHeap, &DestroyHeap<T> };
+
+private:
+    alignas(std::max_align_t) mutable UInt8 m_storage[InlineSize];
+
+    InvokeFunction      m_invoke = nullptr;
+    const Operations*   m_operations = nullptr;
+};
+
+
+} // namespace System
+} // namespace Cider
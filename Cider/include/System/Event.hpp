@@ -5,28 +5,92 @@
 #include "System/STL.hpp"
 #include "System/Assert.hpp"
 #include "System/Signals.hpp"
+#include "System/EventCoalesce.hpp"
+#include "System/TimingWheel.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <thread>
 #include <type_traits>
-#include <typeinfo>
 #include <utility>
 
 
+// Event が確保せずに保持できる値の最大サイズ (バイト)
+#ifndef CIDER_EVENT_INLINE_SIZE
+#   define CIDER_EVENT_INLINE_SIZE 48
+#endif
+
+
 namespace Cider {
 namespace System {
+
+
+// イベントの型ID (コンパイル時に決まる)
+typedef UInt64 EventTypeId;
+
+
 namespace Detail {
 
 
+// FNV-1a
+constexpr EventTypeId HashEventTypeName(const Char* name)
+{
+    EventTypeId hash = 14695981039346656037ull;
+
+    for (; *name != '\0'; ++name)
+    {
+        hash ^= static_cast<UInt8>(*name);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+
+// 型名を含む関数シグネチャから求めるため、RTTI も静的初期化も使わない
+// ※ 型名が同じであれば同じ ID になる。別の翻訳単位の無名名前空間に
+//    同名のイベント型を置かないこと (As や Visit、EventBus が別の型として扱い、未定義動作になる)
+template<typename T>
+constexpr EventTypeId GetEventTypeId()
+{
+#if defined(_MSC_VER)
+    return HashEventTypeName(__FUNCSIG__);
+#else
+    return HashEventTypeName(__PRETTY_FUNCTION__);
+#endif
+}
+
+
 template<typename T>
-struct EventHashCode final
+struct EventTypeIdOf final
 {
     static_assert(!std::is_pointer_v<T>, "<T> is not pointer.");
     static_assert(std::is_object_v<T>, "<T> is object type.");
 
-    static const SizeT Value;
+    static constexpr EventTypeId Value = GetEventTypeId<std::remove_cv_t<T>>();
 };
 
 
-template<typename T>
-const SizeT EventHashCode<T>::Value = typeid(const T*).hash_code();
+template<typename...Types>
+constexpr Bool IsUniqueEventTypeIds()
+{
+    constexpr EventTypeId ids[] = { EventTypeIdOf<Types>::Value... };
+
+    for (SizeT i = 0; i < sizeof...(Types); ++i)
+    {
+        for (SizeT j = i + 1; j < sizeof...(Types); ++j)
+        {
+            if (ids[i] == ids[j])
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
 
 
 template<MEMORY_AREA AREA>
@@ -39,7 +103,9 @@ struct EventBody : public BaseAllocator<AREA>
 
     virtual ~EventBody() = default;
 
-    virtual SizeT HashCode() const = 0;
+    virtual EventTypeId TypeId() const = 0;
+
+    virtual const Void* Data() const = 0;
 };
 
 
@@ -55,44 +121,92 @@ struct EventBodyOverride final : public EventBody<AREA>
         : data(std::forward<Arguments>(arguments)...)
     {}
 
-    SizeT HashCode() const override
+    EventTypeId TypeId() const override
+    {
+        return EventTypeIdOf<T>::Value;
+    }
+
+    const Void* Data() const override
     {
-        return EventHashCode<T>::Value;
+        return &data;
     }
 
     T data;
 };
 
 
+template<MEMORY_AREA AREA>
+class EventBuffer;
+
+
 } // namespace Detail
 
 
+/*
+    任意の型の値を 1 つ保持するイベント
+    ・CIDER_EVENT_INLINE_SIZE 以下でトリビアルにコピーできる値は確保せずに内部に保持する
+    ・それ以外の値のみ AREA から確保した EventBody に保持する
+    ・EventQueue などが配送中に渡すものは、キューが保持している値を参照しているだけなので、配送中のみ有効
+*/
 template<MEMORY_AREA AREA>
 class Event final
 {
     template<typename T>
     using EventBodyOverrideType = Detail::EventBodyOverride<T, AREA>;
     typedef Detail::EventBody<AREA> EventBodyType;
+
+    template<typename T>
+    static constexpr Bool IsInline =
+        sizeof(T) <= CIDER_EVENT_INLINE_SIZE &&
+        alignof(T) <= alignof(std::max_align_t) &&
+        std::is_trivially_copyable_v<T> &&
+        std::is_trivially_destructible_v<T>;
+
 public:
     Event() = delete;
     Event(const Event&) = delete;
     void operator=(const Event&) = delete;
 
-    Event(Event&&) = default;
-    Event& operator=(Event&&) = default;
+    Event(Event&& other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    Event& operator=(Event&& other) noexcept
+    {
+        if (this != &other)
+        {
+            m_body.reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
 
     template<typename T>
     explicit Event(T&& value)
     {
         typedef std::remove_reference_t<T> ValueType;
-        typedef EventBodyOverrideType<ValueType> ContainerType;
+        typedef std::remove_cv_t<ValueType> StorageType;
 
-        static_assert(!std::is_same_v<Event, ValueType>, "");
+        static_assert(!std::is_same_v<Event, StorageType>, "");
         static_assert(std::is_object_v<ValueType>, "<T> is object type.");
         static_assert(!std::is_pointer_v<ValueType>, "pointer type is not supported.");
-        static_assert(std::is_base_of_v<EventBodyType, ContainerType>, "Container is not a base class of 'EventBody'.");
 
-        m_body = STL::make_unique<ContainerType>(std::forward<T>(value));
+        if constexpr (IsInline<StorageType>)
+        {
+            new(m_storage) StorageType(std::forward<T>(value));
+        }
+        else
+        {
+            typedef EventBodyOverrideType<StorageType> ContainerType;
+
+            static_assert(std::is_base_of_v<EventBodyType, ContainerType>, "Container is not a base class of 'EventBody'.");
+
+            m_body = STL::make_unique<ContainerType>(std::forward<T>(value));
+            m_data = m_body->Data();
+        }
+
+        m_typeId = Detail::EventTypeIdOf<StorageType>::Value;
     }
 
     template<typename T>
@@ -102,98 +216,1791 @@ public:
         static_assert(!std::is_pointer_v<T>, "pointer type is not supported.");
         static_assert(std::is_object_v<T>, "<T> is object type.");
 
-        CIDER_ASSERT(m_body, "");
-        return m_body && (m_body->HashCode() == Detail::EventHashCode<T>::Value);
+        CIDER_ASSERT(IsValid(), "");
+        return m_typeId == Detail::EventTypeIdOf<T>::Value;
     }
 
+    // 型IDが一致した場合のみデータを返す (RTTI を使わない)
     template<typename T>
     const T* As() const
     {
-        typedef EventBodyOverrideType<T> ContainerType;
-
         static_assert(!std::is_reference_v<T>, "reference type is not supported.");
         static_assert(!std::is_pointer_v<T>, "pointer type is not supported.");
         static_assert(std::is_object_v<T>, "<T> is object type.");
-        static_assert(std::is_base_of_v<EventBodyType, ContainerType>, "Container is not a base class of 'EventBody'.");
 
-        CIDER_ASSERT(m_body, "");
+        if (!Is<T>())
+        {
+            return nullptr;
+        }
+
+        CIDER_ASSERT(!m_body || m_body->TypeId() == m_typeId, "");
+        return static_cast<const T*>(GetData());
+    }
+
+    /*
+        Types... のうちイベントの型に一致するものを visitor(const T&) で受け取る
+        型IDの比較を 1 回ずつ行うだけで、一致しなければ visitor は呼ばれない
+        戻り値は一致する型があったか
+    */
+    template<typename...Types, typename Visitor>
+    Bool Visit(Visitor&& visitor) const
+    {
+        static_assert(sizeof...(Types) > 0, "");
+        static_assert(Detail::IsUniqueEventTypeIds<Types...>(), "duplicate event type.");
+
+        CIDER_ASSERT(IsValid(), "");
 
-        if (auto p = dynamic_cast<const ContainerType*>(m_body.get()))
+        if (!IsValid())
         {
-            CIDER_ASSERT(Is<T>(), "");
-            return &p->data;
+            return false;
         }
-        return nullptr;
+
+        const Void* data = GetData();
+
+        return ((m_typeId == Detail::EventTypeIdOf<Types>::Value
+            ? (visitor(*static_cast<const Types*>(data)), true)
+            : false) || ...);
+    }
+
+    EventTypeId GetTypeId() const
+    {
+        CIDER_ASSERT(IsValid(), "");
+        return m_typeId;
+    }
+
+    // GetTypeId が示す型のデータ
+    const Void* GetData() const
+    {
+        CIDER_ASSERT(IsValid(), "");
+        return m_data ? m_data : static_cast<const Void*>(m_storage);
+    }
+
+    // 確保せずに保持しているか
+    Bool IsInlined() const
+    {
+        return !m_body;
+    }
+
+private:
+    friend class Detail::EventBuffer<AREA>;
+
+    // 参照のみ (保持しない)
+    Event(EventTypeId typeId, const Void* data)
+        : m_data(data)
+        , m_typeId(typeId)
+    {
+        CIDER_ASSERT(data, "");
+    }
+
+    // ムーブ元でないか
+    Bool IsValid() const
+    {
+        return m_typeId != INVALID_TYPE_ID;
+    }
+
+    Void MoveFrom(Event& other)
+    {
+        if (other.m_body)
+        {
+            m_body = std::move(other.m_body);
+        }
+        else
+        {
+            std::memcpy(m_storage, other.m_storage, CIDER_EVENT_INLINE_SIZE);
+        }
+
+        m_data = other.m_data;
+        m_typeId = other.m_typeId;
+
+        other.m_data = nullptr;
+        other.m_typeId = INVALID_TYPE_ID;
     }
 
 private:
+    static constexpr EventTypeId INVALID_TYPE_ID = 0;
+
+    alignas(std::max_align_t) UInt8 m_storage[CIDER_EVENT_INLINE_SIZE];
+
     STL::unique_ptr<EventBodyType> m_body;
+
+    // m_storage 以外にあるデータ (m_body のデータか参照先)
+    const Void* m_data = nullptr;
+    EventTypeId m_typeId = INVALID_TYPE_ID;
 };
 
 
-template<MEMORY_AREA AREA = MEMORY_AREA::SYSTEM>
-class EventQueue final
+// EventQueue の容量を超えて積もうとした場合の動作
+enum class EVENT_OVERFLOW
+{
+    BLOCK               // 空くまで待つ (配送するスレッドと、最初の配送の前は待たずに容量を超えて積む)
+                        // 配送するスレッドは 1 つに固定する (変わると、次に配送するスレッドが前のスレッドを待ち続けることがある)
+    , DROP_NEWEST       // 積もうとしたイベントを捨てる
+    , DROP_OLDEST       // 積むスレッドの、優先度が同じか低い最も古いイベントを捨てる (低い優先度から。無ければ積もうとしたものを捨てる)
+                        // 他のスレッドが積んだものは捨てない (書き込み中のバッファに触れないため)。容量を他のスレッドが使っている場合は
+                        // 積もうとしたものを捨て、EventQueueStatistics::droppedNewestCount に数える
+    , SPILL             // 容量とは別のバッファに積む (配送後に解放する)
+};
+
+
+// イベントの優先度
+// 配送は優先度の高い順に行い、同じ優先度の中は積まれた順 (同じスレッドから積んだものの間のみ)
+enum class EVENT_PRIORITY
+{
+    HIGH
+    , NORMAL
+    , LOW
+    , NUM
+};
+
+
+// 容量の超過の状況
+struct EventQueueStatistics
+{
+    UInt64  droppedCount;       // 捨てたイベントの数
+    UInt64  droppedNewestCount; // DROP_OLDEST で積むスレッドに捨てられるものが無く、積もうとしたものを捨てた数 (droppedCount に含む)
+    UInt64  spilledCount;       // 別のバッファに積んだイベントの数
+    UInt64  blockedCount;       // 空くのを待った Enqueue の数
+    SizeT   highWaterMark;      // 1 回の配送で取り出したイベントの最大数
+};
+
+
+namespace Detail {
+
+
+// (型ID, 集約キー) から積まれているイベントを引くテーブル
+// Clear してもメモリは保持するため、定常状態では確保しない
+class EventCoalesceTable final
+{
+public:
+    Void* Find(EventTypeId typeId, UInt64 key) const
+    {
+        if (m_count == 0)
+        {
+            return nullptr;
+        }
+
+        for (SizeT index = Hash(typeId, key) & m_mask;; index = (index + 1) & m_mask)
+        {
+            const Entry& entry = m_entries[index];
+
+            if (!entry.value)
+            {
+                return nullptr;
+            }
+
+            if (entry.typeId == typeId && entry.key == key)
+            {
+                return entry.value;
+            }
+        }
+    }
+
+    // 同じキーがあれば置き換える
+    Void Insert(EventTypeId typeId, UInt64 key, Void* value)
+    {
+        CIDER_ASSERT(value, "");
+
+        // 使用率を半分以下に保つ
+        if ((m_count + 1) * 2 > m_entries.size())
+        {
+            Grow();
+        }
+
+        if (InsertEntry(Entry { typeId, key, value }))
+        {
+            ++m_count;
+        }
+    }
+
+    Void Clear()
+    {
+        if (m_count > 0)
+        {
+            for (auto& entry : m_entries)
+            {
+                entry.value = nullptr;
+            }
+            m_count = 0;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        EventTypeId typeId;
+        UInt64      key;
+        Void*       value;  // nullptr は空き
+    };
+
+    static constexpr SizeT INITIAL_CAPACITY = 16;
+
+    static SizeT Hash(EventTypeId typeId, UInt64 key)
+    {
+        UInt64 hash = typeId ^ (key * 0x9E3779B97F4A7C15ull);
+        hash ^= hash >> 32;
+        return static_cast<SizeT>(hash);
+    }
+
+    // 追加した場合は true、置き換えた場合は false
+    Bool InsertEntry(const Entry& newEntry)
+    {
+        for (SizeT index = Hash(newEntry.typeId, newEntry.key) & m_mask;; index = (index + 1) & m_mask)
+        {
+            Entry& entry = m_entries[index];
+
+            if (!entry.value)
+            {
+                entry = newEntry;
+                return true;
+            }
+
+            if (entry.typeId == newEntry.typeId && entry.key == newEntry.key)
+            {
+                entry.value = newEntry.value;
+                return false;
+            }
+        }
+    }
+
+    Void Grow()
+    {
+        STL::vector<Entry> entries(m_entries.empty() ? INITIAL_CAPACITY : m_entries.size() * 2, Entry {});
+        std::swap(entries, m_entries);
+        m_mask = m_entries.size() - 1;
+
+        for (const auto& entry : entries)
+        {
+            if (entry.value)
+            {
+                InsertEntry(entry);
+            }
+        }
+    }
+
+private:
+    STL::vector<Entry>  m_entries;
+    SizeT               m_mask = 0;
+    SizeT               m_count = 0;
+};
+
+
+/*
+    イベントを詰めて保持するバッファ
+    ・[Record][データ] を確保済みのブロックに隙間なく並べる
+    ・Clear してもブロックは解放せずに再利用するため、定常状態では確保しない
+    ・ブロックは MIN_BLOCK_SIZE から倍々に大きくする (数個しか積まないバッファが大量にある場合の使用量を抑える)
+    ・集約する型 (EventCoalesce.hpp) は積む時点で積まれているものにまとめる
+    ・スレッドセーフではない
+*/
+template<MEMORY_AREA AREA>
+class EventBuffer final
 {
 public:
     typedef Event<AREA> EventType;
 
-    EventQueue()
-        : m_signalBody(STL::make_shared<SignalBody>())
-    {}
+    static constexpr SizeT MIN_BLOCK_SIZE = 512;
+    static constexpr SizeT BLOCK_SIZE = 64 * 1024;
+    static constexpr SizeT BLOCK_ALIGNMENT = 64;
 
-    EventQueue(const EventQueue&) = delete;
-    void operator=(const EventQueue&) = delete;
+    EventBuffer() = default;
 
-    EventQueue(EventQueue&&) = delete;
-    void operator=(EventQueue&&) = delete;
+    EventBuffer(const EventBuffer&) = delete;
+    void operator=(const EventBuffer&) = delete;
 
-    Connection Connect(const Slot<void(const EventType&)>& slot)
+    ~EventBuffer()
     {
-        CIDER_ASSERT(slot, "");
-        CIDER_ASSERT(m_signalBody, "");
-        return Connection { m_signalBody->Connect(slot) };
+        Release();
     }
 
-    Connection Connect(Slot<void(const EventType&)>&& slot)
+    // T をバッファ上に直接構築する (集約する型は積まれているものにまとめる)
+    template<typename T, typename...Arguments>
+    Void Emplace(Arguments&&...arguments)
     {
-        CIDER_ASSERT(slot, "");
-        CIDER_ASSERT(m_signalBody, "");
-        return Connection { m_signalBody->Connect(slot) };
+        if constexpr (IsCoalesced<T>)
+        {
+            T value { std::forward<Arguments>(arguments)... };
+
+            if (!TryCoalesce(value))
+            {
+                EmplaceNew<T>(std::move(value));
+            }
+        }
+        else
+        {
+            EmplaceNew<T>(std::forward<Arguments>(arguments)...);
+        }
     }
 
-    void Enqueue(EventType&& eventValue)
+    // 同じキーのイベントが積まれていればまとめる。まとめた場合は true
+    template<typename T>
+    Bool TryCoalesce(T& value)
     {
-        std::lock_guard<std::recursive_mutex> lock(m_notificationProtection);
-        m_events.emplace_back(std::move(eventValue));
+        static_assert(IsCoalesced<T>, "<T> is not coalesced.");
+
+        Record* pending = static_cast<Record*>(m_coalesceTable.Find(EventTypeIdOf<T>::Value, EventCoalescer<T>::GetKey(value)));
+
+        if (!pending || pending->skipped)
+        {
+            return false;
+        }
+
+        EventCoalescer<T>::Coalesce(*static_cast<T*>(GetData(pending)), std::move(value));
+        return true;
     }
 
+    // まとめずに新しいレコードとして積む
     template<typename T, typename...Arguments>
-    void Enqueue(Arguments&&...arguments)
+    Void EmplaceNew(Arguments&&...arguments)
     {
-        Enqueue(EventType { T{std::forward<Arguments>(arguments)...} });
+        static_assert(std::is_object_v<T>, "<T> is object type.");
+        static_assert(!std::is_pointer_v<T>, "pointer type is not supported.");
+        static_assert(alignof(T) <= BLOCK_ALIGNMENT, "over-aligned event type is not supported.");
+
+        Record* record = Construct<T>(EventTypeIdOf<T>::Value, false, std::forward<Arguments>(arguments)...);
+
+        if constexpr (IsCoalesced<T>)
+        {
+            const UInt64 key = EventCoalescer<T>::GetKey(*static_cast<const T*>(GetData(record)));
+            m_coalesceTable.Insert(record->typeId, key, record);
+            ++m_coalescableCount;
+        }
     }
 
-    void Emit()
+    // 構築済みのイベントはそのまま保持する (集約しない)
+    Void Push(EventType&& eventValue)
     {
-        CIDER_ASSERT(m_signalBody, "");
+        const EventTypeId typeId = eventValue.GetTypeId();
+        Construct<EventType>(typeId, true, std::move(eventValue));
+    }
+
+    // 最も古いイベントを捨てる。捨てるものが無ければ false
+    // 捨てたものが残りより多くなったら scratch を使って詰め直し、使用量を抑える
+    Bool DropOldest(EventBuffer& scratch)
+    {
+        Record* record = FindOldest();
 
-        std::vector<EventType> notifications;
+        if (!record)
         {
-            std::lock_guard<std::recursive_mutex> lock(m_notificationProtection);
-            std::swap(notifications, m_events);
+            return false;
         }
 
-        for (auto& notification : notifications)
+        if (record->operations && record->operations->destroy)
         {
-            m_signalBody->operator()(notification);
+            record->operations->destroy(GetData(record));
+        }
+
+        record->operations = nullptr;
+        record->skipped = true;
+
+        --m_count;
+        ++m_skippedCount;
+
+        if (m_skippedCount > COMPACT_THRESHOLD && m_skippedCount > m_count)
+        {
+            Compact(scratch);
+        }
+
+        return true;
+    }
+
+    // 他のバッファと合わせて集約する
+    // table に同じキーがあればそちらにまとめてこのバッファのものは配送しない。無ければ table に加える
+    Void CoalesceInto(EventCoalesceTable& table)
+    {
+        if (m_coalescableCount == 0)
+        {
+            return;
+        }
+
+        ForEachRecord([&table](Record& record) {
+            if (record.skipped || !record.operations || !record.operations->getKey)
+            {
+                return;
+            }
+
+            const UInt64 key = record.operations->getKey(GetData(&record));
+
+            if (auto pending = static_cast<Record*>(table.Find(record.typeId, key)))
+            {
+                record.operations->coalesce(GetData(pending), GetData(&record));
+                record.skipped = true;
+            }
+            else
+            {
+                table.Insert(record.typeId, key, &record);
+            }
+        });
+    }
+
+    // 積まれた T を積まれた順に function(T&) に渡す (Push したものは除く)
+    template<typename T, typename Function>
+    Void ForEachOf(Function&& function)
+    {
+        ForEachRecord([&function](Record& record) {
+            if (!record.skipped && !record.boxed && record.typeId == EventTypeIdOf<T>::Value)
+            {
+                function(*static_cast<T*>(GetData(&record)));
+            }
+        });
+    }
+
+    // 積まれた順に visitor(const EventType&) を呼ぶ
+    template<typename Visitor>
+    Void ForEach(Visitor&& visitor) const
+    {
+        for (SizeT blockIndex = 0; blockIndex < m_blocks.size(); ++blockIndex)
+        {
+            const Block& block = m_blocks[blockIndex];
+
+            for (SizeT position = 0; position < block.used;)
+            {
+                const Record* record = reinterpret_cast<const Record*>(block.memory + position);
+                const Void* data = reinterpret_cast<const UInt8*>(record) + record->dataOffset;
+
+                if (!record->skipped)
+                {
+                    if (record->boxed)
+                    {
+                        visitor(*static_cast<const EventType*>(data));
+                    }
+                    else
+                    {
+                        visitor(EventType { record->typeId, data });
+                    }
+                }
+
+                position += record->size;
+            }
+        }
+    }
+
+    // 全てのイベントを破棄する (ブロックは保持したまま)
+    Void Clear()
+    {
+        ForEachRecord([](Record& record) {
+            if (record.operations && record.operations->destroy)
+            {
+                record.operations->destroy(GetData(&record));
+            }
+        });
+
+        for (auto& block : m_blocks)
+        {
+            block.used = 0;
+        }
+
+        m_coalesceTable.Clear();
+        m_currentBlock = 0;
+        m_oldestBlock = 0;
+        m_oldestPosition = 0;
+        m_count = 0;
+        m_skippedCount = 0;
+        m_coalescableCount = 0;
+    }
+
+    // 全てのイベントを破棄し、ブロックも解放する
+    Void Release()
+    {
+        Clear();
+
+        for (auto& block : m_blocks)
+        {
+            MemoryManager::Free(AREA, block.memory);
         }
+
+        m_blocks.clear();
+    }
+
+    // 積まれているイベントの数 (まとめたもの、捨てたものは含まない)
+    SizeT GetCount() const
+    {
+        return m_count;
+    }
+
+    Bool IsEmpty() const
+    {
+        return m_count == 0;
+    }
+
+    // 集約する型のイベントを含むか
+    Bool HasCoalescable() const
+    {
+        return m_coalescableCount > 0;
     }
 
 private:
-    typedef Detail::SignalBody<void(const EventType&)> SignalBody;
-    std::vector<EventType> m_events;
-    std::shared_ptr<SignalBody> m_signalBody;
-    std::recursive_mutex m_notificationProtection;
+    // 型ごとの操作。不要なもの (トリビアルなコピーと破棄、集約しない型) は nullptr
+    struct RecordOperations
+    {
+        Void(*destroy)(Void* data);
+        Void(*relocate)(Void* destination, Void* source);   // ムーブして移動元を破棄する
+        UInt64(*getKey)(const Void* data);
+        Void(*coalesce)(Void* pending, Void* incoming);
+    };
+
+    struct Record
+    {
+        EventTypeId             typeId;
+        const RecordOperations* operations;     // nullptr なら memcpy で移動でき、破棄も不要
+        UInt32                  size;           // 次のレコードまでのバイト数
+        UInt32                  dataOffset;     // レコードの先頭からデータまでのバイト数
+        UInt32                  dataSize;
+        UInt16                  dataAlignment;
+        Bool                    boxed;          // データが EventType
+        Bool                    skipped;        // まとめたか捨てたため配送しない
+    };
+
+    struct Block
+    {
+        UInt8*  memory;
+        SizeT   capacity;
+        SizeT   used;
+    };
+
+    // 捨てたレコードがこれを超えるまでは詰め直さない
+    static constexpr SizeT COMPACT_THRESHOLD = 64;
+
+    static constexpr SizeT AlignUp(SizeT value, SizeT alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    static Void* GetData(Record* record)
+    {
+        return reinterpret_cast<UInt8*>(record) + record->dataOffset;
+    }
+
+    template<typename T>
+    static Void Destroy(Void* data)
+    {
+        static_cast<T*>(data)->~T();
+    }
+
+    template<typename T>
+    static Void Relocate(Void* destination, Void* source)
+    {
+        T* value = static_cast<T*>(source);
+        new(destination) T(std::move(*value));
+        value->~T();
+    }
+
+    template<typename T>
+    static UInt64 GetKey(const Void* data)
+    {
+        return EventCoalescer<T>::GetKey(*static_cast<const T*>(data));
+    }
+
+    template<typename T>
+    static Void Coalesce(Void* pending, Void* incoming)
+    {
+        EventCoalescer<T>::Coalesce(*static_cast<T*>(pending), std::move(*static_cast<T*>(incoming)));
+    }
+
+    template<typename T>
+    static constexpr Bool IsCoalesced = EventCoalescer<T>::POLICY != EVENT_COALESCE::NONE;
+
+    template<typename T>
+    static constexpr Bool NeedsOperations = !std::is_trivially_copyable_v<T> || IsCoalesced<T>;
+
+    template<typename T>
+    static constexpr RecordOperations MakeOperations()
+    {
+        RecordOperations operations = { nullptr, nullptr, nullptr, nullptr };
+
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            operations.destroy = &Destroy<T>;
+        }
+
+        if constexpr (!std::is_trivially_copyable_v<T>)
+        {
+            operations.relocate = &Relocate<T>;
+        }
+
+        if constexpr (IsCoalesced<T>)
+        {
+            operations.getKey = &GetKey<T>;
+            operations.coalesce = &Coalesce<T>;
+        }
+
+        return operations;
+    }
+
+    template<typename T>
+    static constexpr RecordOperations OPERATIONS = MakeOperations<T>();
+
+    template<typename Function>
+    Void ForEachRecord(Function&& function)
+    {
+        for (SizeT blockIndex = 0; blockIndex < m_blocks.size(); ++blockIndex)
+        {
+            Block& block = m_blocks[blockIndex];
+
+            for (SizeT position = 0; position < block.used;)
+            {
+                Record* record = reinterpret_cast<Record*>(block.memory + position);
+                function(*record);
+                position += record->size;
+            }
+        }
+    }
+
+    Record* FindOldest()
+    {
+        for (; m_oldestBlock < m_blocks.size(); ++m_oldestBlock, m_oldestPosition = 0)
+        {
+            Block& block = m_blocks[m_oldestBlock];
+
+            for (; m_oldestPosition < block.used;)
+            {
+                Record* record = reinterpret_cast<Record*>(block.memory + m_oldestPosition);
+
+                if (!record->skipped)
+                {
+                    return record;
+                }
+
+                m_oldestPosition += record->size;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // 残っているレコードを scratch に移して入れ替える
+    Void Compact(EventBuffer& scratch)
+    {
+        CIDER_ASSERT(&scratch != this && scratch.IsEmpty(), "");
+
+        ForEachRecord([&scratch](Record& record) {
+            if (!record.skipped)
+            {
+                scratch.RelocateRecord(record);
+            }
+        });
+
+        std::swap(m_blocks, scratch.m_blocks);
+        std::swap(m_currentBlock, scratch.m_currentBlock);
+        std::swap(m_count, scratch.m_count);
+        std::swap(m_coalescableCount, scratch.m_coalescableCount);
+        std::swap(m_coalesceTable, scratch.m_coalesceTable);
+
+        m_skippedCount = 0;
+        m_oldestBlock = 0;
+        m_oldestPosition = 0;
+
+        // 移動元は全て破棄済み
+        scratch.Clear();
+    }
+
+    Void RelocateRecord(Record& source)
+    {
+        SizeT dataOffset = 0;
+        SizeT recordSize = 0;
+        Block& block = Reserve(source.dataSize, source.dataAlignment, dataOffset, recordSize);
+
+        UInt8* recordMemory = block.memory + block.used;
+        Void* data = recordMemory + dataOffset;
+
+        if (source.operations && source.operations->relocate)
+        {
+            source.operations->relocate(data, GetData(&source));
+        }
+        else
+        {
+            std::memcpy(data, GetData(&source), source.dataSize);
+        }
+
+        Record* record = new(recordMemory) Record(source);
+        record->size = static_cast<UInt32>(recordSize);
+        record->dataOffset = static_cast<UInt32>(dataOffset);
+
+        source.operations = nullptr;
+
+        block.used += recordSize;
+        ++m_count;
+
+        if (record->operations && record->operations->getKey)
+        {
+            m_coalesceTable.Insert(record->typeId, record->operations->getKey(data), record);
+            ++m_coalescableCount;
+        }
+    }
+
+    template<typename T, typename...Arguments>
+    Record* Construct(EventTypeId typeId, Bool boxed, Arguments&&...arguments)
+    {
+        SizeT dataOffset = 0;
+        SizeT recordSize = 0;
+        Block& block = Reserve(sizeof(T), alignof(T), dataOffset, recordSize);
+
+        UInt8* recordMemory = block.memory + block.used;
+
+        // 構築に成功してから確定する
+        new(recordMemory + dataOffset) T { std::forward<Arguments>(arguments)... };
+
+        Record* record = new(recordMemory) Record;
+        record->typeId = typeId;
+        record->operations = NeedsOperations<T> ? &OPERATIONS<T> : nullptr;
+        record->size = static_cast<UInt32>(recordSize);
+        record->dataOffset = static_cast<UInt32>(dataOffset);
+        record->dataSize = static_cast<UInt32>(sizeof(T));
+        record->dataAlignment = static_cast<UInt16>(alignof(T));
+        record->boxed = boxed;
+        record->skipped = false;
+
+        block.used += recordSize;
+        ++m_count;
+
+        return record;
+    }
+
+    // ブロックの先頭は BLOCK_ALIGNMENT に揃っているため、ブロック内の位置で揃えればよい
+    Block& Reserve(SizeT bytes, SizeT alignment, SizeT& dataOffset, SizeT& recordSize)
+    {
+        for (; m_currentBlock < m_blocks.size(); ++m_currentBlock)
+        {
+            Block& block = m_blocks[m_currentBlock];
+
+            if (Fits(block, bytes, alignment, dataOffset, recordSize))
+            {
+                return block;
+            }
+        }
+
+        const SizeT required = AlignUp(sizeof(Record), alignment) + AlignUp(bytes, alignof(Record));
+
+        SizeT capacity = m_blocks.empty() ? MIN_BLOCK_SIZE : m_blocks.back().capacity * 2;
+        capacity = capacity < BLOCK_SIZE ? capacity : BLOCK_SIZE;
+        capacity = required > capacity ? AlignUp(required, BLOCK_ALIGNMENT) : capacity;
+
+        Block block;
+        block.memory = static_cast<UInt8*>(MemoryManager::MallocDebug(__FILE__, __LINE__, AREA, capacity, BLOCK_ALIGNMENT));
+        block.capacity = capacity;
+        block.used = 0;
+
+        m_blocks.push_back(block);
+        m_currentBlock = m_blocks.size() - 1;
+
+        const Bool fits = Fits(m_blocks.back(), bytes, alignment, dataOffset, recordSize);
+        CIDER_ASSERT(fits, "");
+        (void)fits;
+
+        return m_blocks.back();
+    }
+
+    static Bool Fits(const Block& block, SizeT bytes, SizeT alignment, SizeT& dataOffset, SizeT& recordSize)
+    {
+        const SizeT dataPosition = AlignUp(block.used + sizeof(Record), alignment);
+        const SizeT end = AlignUp(dataPosition + bytes, alignof(Record));
+
+        if (end > block.capacity)
+        {
+            return false;
+        }
+
+        dataOffset = dataPosition - block.used;
+        recordSize = end - block.used;
+        return true;
+    }
+
+private:
+    STL::vector<Block>  m_blocks;
+    SizeT               m_currentBlock = 0;
+    SizeT               m_oldestBlock = 0;      // DropOldest の探索開始位置
+    SizeT               m_oldestPosition = 0;
+    SizeT               m_count = 0;
+    SizeT               m_skippedCount = 0;
+    SizeT               m_coalescableCount = 0;
+    EventCoalesceTable  m_coalesceTable;
+};
+
+
+// 時間指定のイベントの基準
+enum class EventClock : UInt8
+{
+    Frame       // 取り出した回数
+    , Time      // 取り出す時に渡された経過時間の累計 (EventScheduler::TICKS_PER_SECOND 単位)
+};
+
+
+// 時間指定で積まれたイベント (取り出す時に EventScheduler へ移す)
+template<MEMORY_AREA AREA>
+struct ScheduledEvent
+{
+    Event<AREA>     event;
+    UInt64          expireTick;
+    EventClock      clock;
+};
+
+
+/*
+    時間指定のイベントを期限まで保持する
+    ・基準ごとに階層化タイミングホイールを持ち、追加と期限切れの取り出しは 1 件あたり O(1)
+    ・ノードはまとめて確保して空きリストで使い回すため、定常状態では確保しない
+    ・スレッドセーフではない (取り出すスレッドのみが使う)
+*/
+template<MEMORY_AREA AREA>
+class EventScheduler final : public BaseAllocator<AREA>
+{
+public:
+    typedef Event<AREA> EventType;
+
+    static constexpr UInt64 TICKS_PER_SECOND = 1000;
+    static constexpr SizeT CHUNK_NODE_COUNT = 256;
+
+    EventScheduler() = default;
+
+    EventScheduler(const EventScheduler&) = delete;
+    void operator=(const EventScheduler&) = delete;
+
+    ~EventScheduler()
+    {
+        auto free = [this](Node* node) {
+            FreeNode(node);
+        };
+
+        m_frameWheel.Clear(free);
+        m_timeWheel.Clear(free);
+
+        for (Node* node = m_expiredHead; node;)
+        {
+            Node* next = node->next;
+            FreeNode(node);
+            node = next;
+        }
+
+        for (Void* chunk : m_chunks)
+        {
+            MemoryManager::Free(AREA, chunk);
+        }
+    }
+
+    // 秒を tick に変換する (期限より早くならないよう切り上げる)
+    static UInt64 ToTick(Double seconds)
+    {
+        return seconds > 0.0 ? static_cast<UInt64>(std::ceil(seconds * TICKS_PER_SECOND)) : 0;
+    }
+
+    Void Insert(ScheduledEvent<AREA>& scheduled)
+    {
+        Node* node = AllocateNode(std::move(scheduled.event), scheduled.expireTick);
+
+        if (scheduled.clock == EventClock::Frame)
+        {
+            m_frameWheel.Insert(node);
+        }
+        else
+        {
+            m_timeWheel.Insert(node);
+        }
+    }
+
+    // 期限が来たものを配送待ちにする
+    Void Advance(UInt64 frame, UInt64 timeTick)
+    {
+        auto expired = [this](Node* node) {
+            if (m_expiredTail)
+            {
+                m_expiredTail->next = node;
+            }
+            else
+            {
+                m_expiredHead = node;
+            }
+            m_expiredTail = node;
+        };
+
+        m_frameWheel.Advance(frame, expired);
+        m_timeWheel.Advance(timeTick, expired);
+    }
+
+    // 配送待ちのものを visitor(const EventType&) に渡して破棄する。渡した数を返す
+    template<typename Visitor>
+    SizeT Deliver(Visitor& visitor)
+    {
+        Node* node = m_expiredHead;
+        m_expiredHead = nullptr;
+        m_expiredTail = nullptr;
+
+        SizeT count = 0;
+
+        while (node)
+        {
+            Node* next = node->next;
+
+            visitor(static_cast<const EventType&>(node->event));
+            FreeNode(node);
+
+            node = next;
+            ++count;
+        }
+
+        return count;
+    }
+
+    // 期限が来ていないものの数
+    SizeT GetCount() const
+    {
+        return m_frameWheel.GetCount() + m_timeWheel.GetCount();
+    }
+
+private:
+    struct Node
+    {
+        EventType   event;
+        UInt64      expireTick;
+        Node*       next;
+    };
+
+    union Slot
+    {
+        Slot*                       next;
+        alignas(Node) UInt8         storage[sizeof(Node)];
+    };
+
+    static constexpr SizeT SLOT_ALIGNMENT =
+        alignof(Slot) > MemoryManager::DEFAULT_ALIGNMENT_SIZE ? alignof(Slot) : MemoryManager::DEFAULT_ALIGNMENT_SIZE;
+
+    Node* AllocateNode(EventType&& eventValue, UInt64 expireTick)
+    {
+        if (!m_freeList)
+        {
+            Slot* chunk = static_cast<Slot*>(MemoryManager::MallocDebug(
+                __FILE__, __LINE__, AREA, sizeof(Slot) * CHUNK_NODE_COUNT, SLOT_ALIGNMENT));
+
+            m_chunks.push_back(chunk);
+
+            for (SizeT i = 0; i < CHUNK_NODE_COUNT; ++i)
+            {
+                chunk[i].next = m_freeList;
+                m_freeList = &chunk[i];
+            }
+        }
+
+        Slot* slot = m_freeList;
+        m_freeList = slot->next;
+
+        return new(slot->storage) Node { std::move(eventValue), expireTick, nullptr };
+    }
+
+    Void FreeNode(Node* node)
+    {
+        node->~Node();
+
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        slot->next = m_freeList;
+        m_freeList = slot;
+    }
+
+private:
+    TimingWheel<Node>       m_frameWheel;
+    TimingWheel<Node>       m_timeWheel;
+    Node*                   m_expiredHead = nullptr;
+    Node*                   m_expiredTail = nullptr;
+    Slot*                   m_freeList = nullptr;
+    STL::vector<Void*>      m_chunks;
+};
+
+
+// ConcurrentEventBuffer ごとに一意な ID (アドレスは再利用されるため使わない)
+inline UInt64 NextConcurrentEventBufferId()
+{
+    static std::atomic<UInt64> counter { 0 };
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+
+/*
+    複数のスレッドから積み、1 つのスレッドで取り出すイベントバッファ
+    ・書き込むスレッドごとに EventBuffer を 2 つ持ち、書き込みはロックも共有の書き込み位置も使わない
+    ・Consume は全スレッドの書き込み先を切り替えてから、書き込みの途中だったスレッドの完了だけを待つ
+    ・順序は同じスレッドから積んだイベントの間でのみ保証する
+    ・スレッドごとのバッファはバッファの破棄まで保持する (終了したスレッドの ID を引き継いだスレッドは再利用する)
+    ・容量を指定した場合は、取り出していないイベントの数を共有のカウンタで数え、超えた分を overflow に従って扱う
+    ・優先度ごとに別のバッファに積み、高い優先度から取り出す
+    ・時間指定のイベントも同じ経路で積み、取り出す時に EventScheduler へ移す (容量の対象外、集約しない)
+      期限が来たものは NORMAL の先頭で取り出す
+*/
+template<MEMORY_AREA AREA>
+class ConcurrentEventBuffer final
+{
+public:
+    typedef Event<AREA> EventType;
+
+    // capacity が 0 の場合は容量を制限しない
+    explicit ConcurrentEventBuffer(SizeT capacity = 0, EVENT_OVERFLOW overflow = EVENT_OVERFLOW::BLOCK)
+        : m_id(NextConcurrentEventBufferId())
+        , m_capacity(capacity)
+        , m_overflow(overflow)
+    {}
+
+    ConcurrentEventBuffer(const ConcurrentEventBuffer&) = delete;
+    void operator=(const ConcurrentEventBuffer&) = delete;
+
+    ~ConcurrentEventBuffer()
+    {
+        Producer* producer = m_producers.load(std::memory_order_acquire);
+
+        while (producer)
+        {
+            Producer* next = producer->next;
+            CIDER_DELETE producer;
+            producer = next;
+        }
+    }
+
+    // 積んだ場合 (まとめた場合を含む) は true、容量を超えて捨てた場合は false
+    template<typename T, typename...Arguments>
+    Bool Emplace(EVENT_PRIORITY priority, Arguments&&...arguments)
+    {
+        CIDER_ASSERT(priority < EVENT_PRIORITY::NUM, "");
+
+        Producer& producer = GetProducer();
+        const SizeT lane = static_cast<SizeT>(priority);
+
+        if (m_capacity == 0)
+        {
+            const UInt32 index = producer.BeginWrite();
+            producer.GetLane(lane).buffers[index].template Emplace<T>(std::forward<Arguments>(arguments)...);
+            producer.EndWrite();
+            return true;
+        }
+
+        if constexpr (EventCoalescer<T>::POLICY != EVENT_COALESCE::NONE)
+        {
+            // まとめられる場合は容量を使わない
+            T value { std::forward<Arguments>(arguments)... };
+
+            Lane& laneBuffers = producer.GetLane(lane);
+
+            const UInt32 index = producer.BeginWrite();
+            const Bool coalesced =
+                laneBuffers.buffers[index].TryCoalesce(value) ||
+                laneBuffers.spills[index].TryCoalesce(value);
+            producer.EndWrite();
+
+            if (coalesced)
+            {
+                return true;
+            }
+
+            return Admit(producer, lane, [&value](EventBuffer<AREA>& buffer) -> Bool {
+                if (buffer.TryCoalesce(value))
+                {
+                    return false;
+                }
+                buffer.template EmplaceNew<T>(std::move(value));
+                return true;
+            });
+        }
+        else
+        {
+            return Admit(producer, lane, [&](EventBuffer<AREA>& buffer) -> Bool {
+                buffer.template EmplaceNew<T>(std::forward<Arguments>(arguments)...);
+                return true;
+            });
+        }
+    }
+
+    Bool Push(EVENT_PRIORITY priority, EventType&& eventValue)
+    {
+        CIDER_ASSERT(priority < EVENT_PRIORITY::NUM, "");
+
+        Producer& producer = GetProducer();
+        const SizeT lane = static_cast<SizeT>(priority);
+
+        if (m_capacity == 0)
+        {
+            const UInt32 index = producer.BeginWrite();
+            producer.GetLane(lane).buffers[index].Push(std::move(eventValue));
+            producer.EndWrite();
+            return true;
+        }
+
+        return Admit(producer, lane, [&eventValue](EventBuffer<AREA>& buffer) -> Bool {
+            buffer.Push(std::move(eventValue));
+            return true;
+        });
+    }
+
+    // frameCount 回後の Consume で取り出す (0 なら Emplace と同じ Consume)
+    template<typename T, typename...Arguments>
+    Void ScheduleAfterFrames(UInt64 frameCount, Arguments&&...arguments)
+    {
+        const UInt64 expireTick = m_frame.load(std::memory_order_relaxed) + 1 + frameCount;
+        Schedule(EventClock::Frame, expireTick, EventType { T { std::forward<Arguments>(arguments)... } });
+    }
+
+    // Consume に渡した経過時間が delay 秒進んだ Consume で取り出す
+    template<typename T, typename...Arguments>
+    Void ScheduleAfterTime(Double delay, Arguments&&...arguments)
+    {
+        const UInt64 expireTick = m_timeTick.load(std::memory_order_relaxed) + SchedulerType::ToTick(delay);
+        Schedule(EventClock::Time, expireTick, EventType { T { std::forward<Arguments>(arguments)... } });
+    }
+
+    // Consume に渡した経過時間の累計が time 秒に達した Consume で取り出す
+    template<typename T, typename...Arguments>
+    Void ScheduleAtTime(Double time, Arguments&&...arguments)
+    {
+        Schedule(EventClock::Time, SchedulerType::ToTick(time), EventType { T { std::forward<Arguments>(arguments)... } });
+    }
+
+    // 取り出した回数 (任意のスレッドから読める。取り出しと同時に読んだ場合は前後どちらかの値)
+    UInt64 GetFrame() const
+    {
+        return m_frame.load(std::memory_order_relaxed);
+    }
+
+    // Consume に渡した経過時間の累計 (秒)。取り出すスレッドから呼ぶ
+    Double GetTime() const
+    {
+        return m_time;
+    }
+
+    // 積まれたイベントを visitor(const EventType&) に渡して破棄する
+    // deltaTime は前回からの経過時間 (秒)。時間指定のイベントの時計を進める
+    // 取り出し中に積まれたイベントは次の Consume で取り出す
+    template<typename Visitor>
+    Void Consume(Double deltaTime, Visitor&& visitor)
+    {
+        CIDER_ASSERT(deltaTime >= 0.0, "");
+
+        const std::thread::id previousConsumerThread = m_consumerThread.exchange(std::this_thread::get_id(), std::memory_order_relaxed);
+
+        // 容量を超えて待っているスレッドは、前に取り出したスレッドを待っている
+        CIDER_ASSERT(
+            m_capacity == 0 || m_overflow != EVENT_OVERFLOW::BLOCK
+            || previousConsumerThread == std::thread::id() || previousConsumerThread == std::this_thread::get_id(),
+            "EVENT_OVERFLOW::BLOCK requires a single consumer thread.");
+        (Void)previousConsumerThread;
+
+        // 積む側が期限の基準にするため、切り替えより先に進める
+        const UInt64 frame = m_frame.load(std::memory_order_relaxed) + 1;
+        m_time += deltaTime;
+        m_frame.store(frame, std::memory_order_relaxed);
+        m_timeTick.store(SchedulerType::ToTick(m_time), std::memory_order_relaxed);
+
+        Producer* head = m_producers.load(std::memory_order_acquire);
+        SizeT coalescableCount = 0;
+        Bool scheduled = false;
+
+        // 先に全スレッドを切り替え、この時点までに積まれたものをまとめて取り出す
+        for (Producer* producer = head; producer; producer = producer->next)
+        {
+            const UInt32 index = producer->Swap();
+            producer->readIndex = index;
+
+            for (SizeT lane = 0; lane < LANE_COUNT; ++lane)
+            {
+                if (Lane* laneBuffers = producer->FindLane(lane))
+                {
+                    coalescableCount += laneBuffers->buffers[index].HasCoalescable() ? 1 : 0;
+                    coalescableCount += laneBuffers->spills[index].HasCoalescable() ? 1 : 0;
+                }
+            }
+
+            if (Lane* laneBuffers = producer->FindLane(SCHEDULED_LANE))
+            {
+                scheduled = scheduled || !laneBuffers->buffers[index].IsEmpty();
+            }
+        }
+
+        if (scheduled)
+        {
+            if (!m_scheduler)
+            {
+                m_scheduler = STL::make_unique<SchedulerType>();
+            }
+
+            for (Producer* producer = head; producer; producer = producer->next)
+            {
+                Lane* laneBuffers = producer->FindLane(SCHEDULED_LANE);
+
+                if (!laneBuffers)
+                {
+                    continue;
+                }
+
+                auto& buffer = laneBuffers->buffers[producer->readIndex];
+
+                buffer.template ForEachOf<ScheduledEvent<AREA>>([this](ScheduledEvent<AREA>& scheduledEvent) {
+                    m_scheduler->Insert(scheduledEvent);
+                });
+                buffer.Clear();
+            }
+        }
+
+        if (m_scheduler)
+        {
+            m_scheduler->Advance(frame, m_timeTick.load(std::memory_order_relaxed));
+        }
+
+        // 積んだ時点ではスレッドごとにしかまとめていないため、複数のスレッドにまたがる分をここでまとめる
+        if (coalescableCount > 1)
+        {
+            m_coalesceTable.Clear();
+
+            for (Producer* producer = head; producer; producer = producer->next)
+            {
+                for (SizeT lane = 0; lane < LANE_COUNT; ++lane)
+                {
+                    if (Lane* laneBuffers = producer->FindLane(lane))
+                    {
+                        laneBuffers->buffers[producer->readIndex].CoalesceInto(m_coalesceTable);
+                        laneBuffers->spills[producer->readIndex].CoalesceInto(m_coalesceTable);
+                    }
+                }
+            }
+        }
+
+        SizeT consumedCount = 0;
+
+        for (SizeT lane = 0; lane < LANE_COUNT; ++lane)
+        {
+            // 期限が来た時間指定のイベントは、同じ優先度の中では先に積まれていたものとして扱う
+            if (lane == static_cast<SizeT>(EVENT_PRIORITY::NORMAL) && m_scheduler)
+            {
+                m_scheduler->Deliver(visitor);
+            }
+
+            for (Producer* producer = head; producer; producer = producer->next)
+            {
+                Lane* laneBuffers = producer->FindLane(lane);
+
+                if (!laneBuffers)
+                {
+                    continue;
+                }
+
+                auto& buffer = laneBuffers->buffers[producer->readIndex];
+                auto& spill = laneBuffers->spills[producer->readIndex];
+
+                const SizeT count = buffer.GetCount();
+
+                if (count > 0)
+                {
+                    buffer.ForEach(visitor);
+                    buffer.Clear();
+
+                    if (m_capacity > 0)
+                    {
+                        m_pendingCount.fetch_sub(count, std::memory_order_release);
+                    }
+                }
+
+                // 溢れた分は容量の外なので、一時的な確保として解放する
+                if (!spill.IsEmpty())
+                {
+                    consumedCount += spill.GetCount();
+                    spill.ForEach(visitor);
+                    spill.Release();
+                }
+
+                consumedCount += count;
+            }
+        }
+
+        if (consumedCount > m_highWaterMark.load(std::memory_order_relaxed))
+        {
+            m_highWaterMark.store(consumedCount, std::memory_order_relaxed);
+        }
+    }
+
+    EventQueueStatistics GetStatistics() const
+    {
+        EventQueueStatistics statistics;
+        statistics.droppedCount = m_droppedCount.load(std::memory_order_relaxed);
+        statistics.droppedNewestCount = m_droppedNewestCount.load(std::memory_order_relaxed);
+        statistics.spilledCount = m_spilledCount.load(std::memory_order_relaxed);
+        statistics.blockedCount = m_blockedCount.load(std::memory_order_relaxed);
+        statistics.highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    Void ResetStatistics()
+    {
+        m_droppedCount.store(0, std::memory_order_relaxed);
+        m_droppedNewestCount.store(0, std::memory_order_relaxed);
+        m_spilledCount.store(0, std::memory_order_relaxed);
+        m_blockedCount.store(0, std::memory_order_relaxed);
+        m_highWaterMark.store(0, std::memory_order_relaxed);
+    }
+
+    SizeT GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    EVENT_OVERFLOW GetOverflow() const
+    {
+        return m_overflow;
+    }
+
+private:
+    typedef EventScheduler<AREA> SchedulerType;
+
+    static constexpr SizeT PRODUCER_CACHE_SIZE = 8;
+    static constexpr SizeT LANE_COUNT = static_cast<SizeT>(EVENT_PRIORITY::NUM);
+
+    // 時間指定のイベントは優先度の後ろのレーンに積む (spills は使わない)
+    static constexpr SizeT SCHEDULED_LANE = LANE_COUNT;
+
+    // 優先度 1 つ分
+    struct Lane : public BaseAllocator<AREA>
+    {
+        EventBuffer<AREA>       buffers[2];
+        EventBuffer<AREA>       spills[2];          // EVENT_OVERFLOW::SPILL で容量を超えた分
+    };
+
+    // 書き込むスレッド 1 つ分
+    struct alignas(64) Producer : public BaseAllocator<AREA, 64>
+    {
+        // 書き込みは所有スレッドのみ
+        UInt32 BeginWrite()
+        {
+            for (;;)
+            {
+                const UInt32 index = writeIndex.load(std::memory_order_seq_cst);
+                writing.store(index + 1, std::memory_order_seq_cst);
+
+                // 切り替えと行き違った場合はやり直す
+                if (writeIndex.load(std::memory_order_seq_cst) == index)
+                {
+                    return index;
+                }
+            }
+        }
+
+        Void EndWrite()
+        {
+            writing.store(0, std::memory_order_release);
+        }
+
+        // 取り出すスレッドのみ。取り出す側のインデックスを返す
+        UInt32 Swap()
+        {
+            const UInt32 index = writeIndex.load(std::memory_order_relaxed);
+            writeIndex.store(index ^ 1, std::memory_order_seq_cst);
+
+            while (writing.load(std::memory_order_acquire) == index + 1)
+            {
+                std::this_thread::yield();
+            }
+
+            return index;
+        }
+
+        ~Producer()
+        {
+            for (auto& lane : lanes)
+            {
+                CIDER_DELETE lane.load(std::memory_order_relaxed);
+            }
+        }
+
+        // 所有スレッドのみ。使っていない優先度の分は作らない (エンティティごとのバスなど、数が多い場合の使用量を抑える)
+        Lane& GetLane(SizeT lane)
+        {
+            Lane* laneBuffers = lanes[lane].load(std::memory_order_relaxed);
+
+            if (!laneBuffers)
+            {
+                laneBuffers = CIDER_NEW Lane;
+                lanes[lane].store(laneBuffers, std::memory_order_release);
+            }
+
+            return *laneBuffers;
+        }
+
+        // 取り出すスレッドのみ。まだ作られていなければ nullptr
+        Lane* FindLane(SizeT lane) const
+        {
+            return lanes[lane].load(std::memory_order_acquire);
+        }
+
+        std::atomic<Lane*>      lanes[LANE_COUNT + 1] = {};
+        EventBuffer<AREA>       scratch;            // EVENT_OVERFLOW::DROP_OLDEST で詰め直す作業用
+        std::atomic<UInt32>     writeIndex { 0 };
+        std::atomic<UInt32>     writing { 0 };      // 書き込み中のインデックス + 1 (0 は書き込んでいない)
+        UInt32                  readIndex = 0;
+        std::thread::id         owner;
+        Producer*               next = nullptr;
+    };
+
+    // 容量を確保する。BLOCK 以外で空きが無ければ false
+    Bool AcquireCapacity()
+    {
+        SizeT pendingCount = m_pendingCount.load(std::memory_order_relaxed);
+        Bool blocked = false;
+
+        for (;;)
+        {
+            if (pendingCount < m_capacity)
+            {
+                if (m_pendingCount.compare_exchange_weak(
+                        pendingCount,
+                        pendingCount + 1,
+                        std::memory_order_acquire,
+                        std::memory_order_relaxed))
+                {
+                    return true;
+                }
+                continue;
+            }
+
+            if (m_overflow != EVENT_OVERFLOW::BLOCK)
+            {
+                return false;
+            }
+
+            // 取り出すスレッドが待つと誰も取り出さなくなるため、容量を超えて積む
+            // まだ一度も取り出していない場合も、このスレッドが後で取り出すかもしれないため同じく扱う
+            const std::thread::id consumerThread = m_consumerThread.load(std::memory_order_relaxed);
+
+            if (consumerThread == std::this_thread::get_id() || consumerThread == std::thread::id())
+            {
+                m_pendingCount.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (!blocked)
+            {
+                blocked = true;
+                m_blockedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            std::this_thread::yield();
+            pendingCount = m_pendingCount.load(std::memory_order_relaxed);
+        }
+    }
+
+    Void ReleaseCapacity()
+    {
+        m_pendingCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 容量を確認してから writer(EventBuffer&) で書き込む
+    // writer は新しく積んだ場合に true、まとめた場合に false を返す
+    // BLOCK で待つのは書き込みの外 (Consume の切り替えを止めないため)
+    template<typename Writer>
+    Bool Admit(Producer& producer, SizeT lane, Writer&& writer)
+    {
+        const Bool acquired = AcquireCapacity();
+
+        Lane& laneBuffers = producer.GetLane(lane);
+
+        const UInt32 index = producer.BeginWrite();
+        auto& buffer = laneBuffers.buffers[index];
+        auto& spill = laneBuffers.spills[index];
+
+        Bool accepted = true;
+
+        // 一度溢れた後は、同じスレッドの順序を保つため配送されるまで溢れた側に積む
+        if (acquired && spill.IsEmpty())
+        {
+            if (!writer(buffer))
+            {
+                ReleaseCapacity();
+            }
+        }
+        else
+        {
+            if (acquired)
+            {
+                ReleaseCapacity();
+            }
+
+            switch (m_overflow)
+            {
+            case EVENT_OVERFLOW::SPILL:
+                if (writer(spill))
+                {
+                    m_spilledCount.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+
+            case EVENT_OVERFLOW::DROP_OLDEST:
+                m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+
+                // 捨てた分の容量をそのまま使う
+                if (DropOldest(producer, index, lane))
+                {
+                    if (!writer(buffer))
+                    {
+                        ReleaseCapacity();
+                    }
+                }
+                else
+                {
+                    m_droppedNewestCount.fetch_add(1, std::memory_order_relaxed);
+                    accepted = false;
+                }
+                break;
+
+            default:
+                m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+                accepted = false;
+                break;
+            }
+        }
+
+        producer.EndWrite();
+        return accepted;
+    }
+
+    // 優先度が lane 以下のうち、最も低い優先度の最も古いイベントを捨てる
+    // 探すのは producer が積んだものだけ (他のスレッドのバッファは書き込み中のことがある)
+    static Bool DropOldest(Producer& producer, UInt32 index, SizeT lane)
+    {
+        for (SizeT dropLane = LANE_COUNT; dropLane-- > lane;)
+        {
+            Lane* laneBuffers = producer.FindLane(dropLane);
+
+            if (laneBuffers && laneBuffers->buffers[index].DropOldest(producer.scratch))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    Void Schedule(EventClock clock, UInt64 expireTick, EventType&& eventValue)
+    {
+        Producer& producer = GetProducer();
+        Lane& laneBuffers = producer.GetLane(SCHEDULED_LANE);
+
+        const UInt32 index = producer.BeginWrite();
+        laneBuffers.buffers[index].template EmplaceNew<ScheduledEvent<AREA>>(std::move(eventValue), expireTick, clock);
+        producer.EndWrite();
+    }
+
+    Producer& GetProducer()
+    {
+        struct CacheEntry
+        {
+            UInt64      id;
+            Producer*   producer;
+        };
+
+        thread_local CacheEntry cache[PRODUCER_CACHE_SIZE] = {};
+        thread_local SizeT cacheCursor = 0;
+
+        for (auto& entry : cache)
+        {
+            if (entry.id == m_id)
+            {
+                return *entry.producer;
+            }
+        }
+
+        Producer* producer = FindOrCreateProducer();
+
+        cache[cacheCursor] = CacheEntry { m_id, producer };
+        cacheCursor = (cacheCursor + 1) % PRODUCER_CACHE_SIZE;
+
+        return *producer;
+    }
+
+    Producer* FindOrCreateProducer()
+    {
+        const auto threadId = std::this_thread::get_id();
+
+        for (Producer* producer = m_producers.load(std::memory_order_acquire); producer; producer = producer->next)
+        {
+            if (producer->owner == threadId)
+            {
+                return producer;
+            }
+        }
+
+        Producer* producer = CIDER_NEW Producer;
+        producer->owner = threadId;
+        producer->next = m_producers.load(std::memory_order_relaxed);
+
+        while (!m_producers.compare_exchange_weak(
+                    producer->next,
+                    producer,
+                    std::memory_order_release,
+                    std::memory_order_relaxed))
+        {}
+
+        return producer;
+    }
+
+private:
+    const UInt64                    m_id;
+    const SizeT                     m_capacity;
+    const EVENT_OVERFLOW            m_overflow;
+    std::atomic<Producer*>          m_producers { nullptr };
+
+    alignas(64) std::atomic<SizeT>  m_pendingCount { 0 };   // 容量を指定した場合のみ数える
+    std::atomic<std::thread::id>    m_consumerThread {};
+
+    std::atomic<UInt64>             m_droppedCount { 0 };
+    std::atomic<UInt64>             m_droppedNewestCount { 0 };
+    std::atomic<UInt64>             m_spilledCount { 0 };
+    std::atomic<UInt64>             m_blockedCount { 0 };
+    std::atomic<SizeT>              m_highWaterMark { 0 };
+
+    std::atomic<UInt64>             m_frame { 0 };
+    std::atomic<UInt64>             m_timeTick { 0 };
+
+    // 以下は Consume でのみ使用する
+    Double                          m_time = 0.0;
+    STL::unique_ptr<SchedulerType>  m_scheduler;        // 時間指定のイベントを積むまで作らない
+    EventCoalesceTable              m_coalesceTable;
+};
+
+
+} // namespace Detail
+
+
+template<MEMORY_AREA AREA = MEMORY_AREA::SYSTEM>
+class EventQueue final
+{
+public:
+    typedef Event<AREA> EventType;
+
+    EventQueue()
+        : m_signalBody(STL::make_shared<SignalBody>())
+    {}
+
+    // 取り出していないイベントを capacity 個までに制限する
+    EventQueue(SizeT capacity, EVENT_OVERFLOW overflow)
+        : m_events(capacity, overflow)
+        , m_signalBody(STL::make_shared<SignalBody>())
+    {
+        CIDER_ASSERT(capacity > 0, "");
+    }
+
+    EventQueue(const EventQueue&) = delete;
+    void operator=(const EventQueue&) = delete;
+
+    EventQueue(EventQueue&&) = delete;
+    void operator=(EventQueue&&) = delete;
+
+    Connection Connect(const Slot<void(const EventType&)>& slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_signalBody, "");
+        return Connection { m_signalBody->Connect(slot) };
+    }
+
+    Connection Connect(Slot<void(const EventType&)>&& slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_signalBody, "");
+        return Connection { m_signalBody->Connect(slot) };
+    }
+
+    // 任意のスレッドから呼べる (ロックしない)
+    // 容量を超えて捨てた場合は false
+    Bool Enqueue(EventType&& eventValue)
+    {
+        return m_events.Push(EVENT_PRIORITY::NORMAL, std::move(eventValue));
+    }
+
+    // イベントを作らずにキューの上に直接構築する
+    template<typename T, typename...Arguments>
+    Bool Enqueue(Arguments&&...arguments)
+    {
+        return m_events.template Emplace<T>(EVENT_PRIORITY::NORMAL, std::forward<Arguments>(arguments)...);
+    }
+
+    // 同じ Emit の中で、優先度の高いものから配送する
+    template<typename T, typename...Arguments>
+    Bool EnqueueWithPriority(EVENT_PRIORITY priority, Arguments&&...arguments)
+    {
+        return m_events.template Emplace<T>(priority, std::forward<Arguments>(arguments)...);
+    }
+
+    /*
+        時間指定のイベント (任意のスレッドから呼べる)
+        ・期限が来た Emit で、NORMAL の優先度の先頭で配送する
+        ・容量の対象外で、集約もしない
+        ・Emit と同時に積んだ場合、期限の基準は Emit の前後どちらかになる
+    */
+
+    // frameCount 回後の Emit で配送する (0 なら Enqueue と同じ Emit)
+    template<typename T, typename...Arguments>
+    Void EnqueueAfterFrames(UInt32 frameCount, Arguments&&...arguments)
+    {
+        m_events.template ScheduleAfterFrames<T>(frameCount, std::forward<Arguments>(arguments)...);
+    }
+
+    // Emit に渡した経過時間が delay 秒進んだ Emit で配送する
+    template<typename T, typename...Arguments>
+    Void EnqueueAfterTime(Double delay, Arguments&&...arguments)
+    {
+        m_events.template ScheduleAfterTime<T>(delay, std::forward<Arguments>(arguments)...);
+    }
+
+    // Emit に渡した経過時間の累計 (GetTime) が time 秒に達した Emit で配送する
+    template<typename T, typename...Arguments>
+    Void EnqueueAtTime(Double time, Arguments&&...arguments)
+    {
+        m_events.template ScheduleAtTime<T>(time, std::forward<Arguments>(arguments)...);
+    }
+
+    // 時間を進めずに配送する
+    void Emit()
+    {
+        Emit(0.0);
+    }
+
+    // 配送中に Enqueue されたイベントは次の Emit で配送する
+    // 順序は同じスレッドから同じ優先度で Enqueue したイベントの間でのみ保証する
+    // Emit を同時に呼べるのは 1 スレッドのみ (配送中の Emit も不可)
+    // deltaTime は前回の Emit からの経過時間 (秒)
+    void Emit(Double deltaTime)
+    {
+        CIDER_ASSERT(m_signalBody, "");
+#ifdef _DEBUG
+        CIDER_ASSERT(!m_emitting.exchange(true), "EventQueue::Emit is not reentrant.");
+#endif
+
+        m_events.Consume(deltaTime, [this](const EventType& notification) {
+            m_signalBody->operator()(notification);
+        });
+
+#ifdef _DEBUG
+        m_emitting.store(false);
+#endif
+    }
+
+    // Emit した回数
+    UInt64 GetFrame() const
+    {
+        return m_events.GetFrame();
+    }
+
+    // Emit に渡した経過時間の累計 (秒)。Emit するスレッドから呼ぶ
+    Double GetTime() const
+    {
+        return m_events.GetTime();
+    }
+
+    EventQueueStatistics GetStatistics() const
+    {
+        return m_events.GetStatistics();
+    }
+
+    Void ResetStatistics()
+    {
+        m_events.ResetStatistics();
+    }
+
+private:
+    typedef Detail::SignalBody<void(const EventType&)> SignalBody;
+    Detail::ConcurrentEventBuffer<AREA> m_events;
+    std::shared_ptr<SignalBody> m_signalBody;
+
+#ifdef _DEBUG
+    std::atomic<Bool> m_emitting { false };
+#endif
 };
 
 
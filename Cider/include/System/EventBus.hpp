@@ -0,0 +1,255 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/STL.hpp"
+#include "System/Assert.hpp"
+#include "System/Signals.hpp"
+#include "System/Event.hpp"
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+
+namespace Cider {
+namespace System {
+namespace Detail {
+
+
+template<MEMORY_AREA AREA>
+class EventChannelBase : public BaseAllocator<AREA>
+{
+public:
+    virtual ~EventChannelBase() = default;
+
+    // data は購読している型のデータ
+    virtual Void Dispatch(const Void* data) = 0;
+
+#ifdef _DEBUG
+    // 型ID が衝突していないかの確認用
+    SizeT dataSize = 0;
+    SizeT dataAlignment = 0;
+#endif
+};
+
+
+// 1 つのイベント型の購読者
+template<typename T, MEMORY_AREA AREA>
+class EventChannel final : public EventChannelBase<AREA>
+{
+public:
+    Void Dispatch(const Void* data) override
+    {
+        signal(*static_cast<const T*>(data));
+    }
+
+    Signal<Void(const T&)> signal;
+};
+
+
+} // namespace Detail
+
+
+/*
+    イベント型ごとに購読者を持つイベントバス
+    ・Subscribe<T> した購読者は T のイベントだけを受け取る (受け取り側で型を判定しない)
+    ・配送は型IDで購読者を引くだけで、購読者がいない型は何もしない
+    ・SubscribeAll は型を問わず全てのイベントを受け取る (EventQueue と同じ)
+    ・Enqueue は任意のスレッドから呼べる。Subscribe / Publish / Dispatch は配送するスレッドから呼ぶ
+    ・優先度と時間指定は EventQueue と同じ (Emit を Dispatch と読み替える)
+*/
+template<MEMORY_AREA AREA = MEMORY_AREA::SYSTEM>
+class EventBus final
+{
+public:
+    typedef Event<AREA> EventType;
+
+    EventBus() = default;
+
+    // 取り出していないイベントを capacity 個までに制限する
+    EventBus(SizeT capacity, EVENT_OVERFLOW overflow)
+        : m_events(capacity, overflow)
+    {
+        CIDER_ASSERT(capacity > 0, "");
+    }
+
+    EventBus(const EventBus&) = delete;
+    void operator=(const EventBus&) = delete;
+
+    EventBus(EventBus&&) = delete;
+    void operator=(EventBus&&) = delete;
+
+    template<typename T>
+    Connection Subscribe(Slot<Void(const T&)> slot)
+    {
+        static_assert(std::is_object_v<T>, "<T> is object type.");
+        static_assert(!std::is_pointer_v<T>, "pointer type is not supported.");
+
+        CIDER_ASSERT(slot, "");
+        return GetChannel<T>().signal.Connect(std::move(slot));
+    }
+
+    Connection SubscribeAll(Slot<Void(const EventType&)> slot)
+    {
+        CIDER_ASSERT(slot, "");
+        return m_anySignal.Connect(std::move(slot));
+    }
+
+    // キューを経由せずに T の購読者へ直ちに配送する (Event を作らない)
+    template<typename T>
+    Void Publish(const T& value)
+    {
+        if (auto channel = FindChannel(Detail::EventTypeIdOf<T>::Value))
+        {
+            channel->Dispatch(&value);
+        }
+    }
+
+    // 容量を超えて捨てた場合は false
+    Bool Enqueue(EventType&& eventValue)
+    {
+        return m_events.Push(EVENT_PRIORITY::NORMAL, std::move(eventValue));
+    }
+
+    // イベントを作らずにキューの上に直接構築する
+    template<typename T, typename...Arguments>
+    Bool Enqueue(Arguments&&...arguments)
+    {
+        return m_events.template Emplace<T>(EVENT_PRIORITY::NORMAL, std::forward<Arguments>(arguments)...);
+    }
+
+    template<typename T, typename...Arguments>
+    Bool EnqueueWithPriority(EVENT_PRIORITY priority, Arguments&&...arguments)
+    {
+        return m_events.template Emplace<T>(priority, std::forward<Arguments>(arguments)...);
+    }
+
+    template<typename T, typename...Arguments>
+    Void EnqueueAfterFrames(UInt32 frameCount, Arguments&&...arguments)
+    {
+        m_events.template ScheduleAfterFrames<T>(frameCount, std::forward<Arguments>(arguments)...);
+    }
+
+    template<typename T, typename...Arguments>
+    Void EnqueueAfterTime(Double delay, Arguments&&...arguments)
+    {
+        m_events.template ScheduleAfterTime<T>(delay, std::forward<Arguments>(arguments)...);
+    }
+
+    template<typename T, typename...Arguments>
+    Void EnqueueAtTime(Double time, Arguments&&...arguments)
+    {
+        m_events.template ScheduleAtTime<T>(time, std::forward<Arguments>(arguments)...);
+    }
+
+    // 積まれたイベントを配送する
+    // 配送中に Enqueue されたイベントは次の Dispatch で配送する (配送中の Dispatch() は不可)
+    // 順序は同じスレッドから同じ優先度で Enqueue したイベントの間でのみ保証する
+    Void Dispatch()
+    {
+        Dispatch(0.0);
+    }
+
+    // deltaTime は前回の Dispatch からの経過時間 (秒)
+    Void Dispatch(Double deltaTime)
+    {
+#ifdef _DEBUG
+        CIDER_ASSERT(!m_dispatching.exchange(true), "EventBus::Dispatch is not reentrant.");
+#endif
+
+        m_events.Consume(deltaTime, [this](const EventType& eventValue) {
+            Dispatch(eventValue);
+        });
+
+#ifdef _DEBUG
+        m_dispatching.store(false);
+#endif
+    }
+
+    Void Dispatch(const EventType& eventValue)
+    {
+        if (auto channel = FindChannel(eventValue.GetTypeId()))
+        {
+            channel->Dispatch(eventValue.GetData());
+        }
+
+        if (m_anySignal.InvocationCount() > 0)
+        {
+            m_anySignal(eventValue);
+        }
+    }
+
+    UInt64 GetFrame() const
+    {
+        return m_events.GetFrame();
+    }
+
+    Double GetTime() const
+    {
+        return m_events.GetTime();
+    }
+
+    EventQueueStatistics GetStatistics() const
+    {
+        return m_events.GetStatistics();
+    }
+
+    Void ResetStatistics()
+    {
+        m_events.ResetStatistics();
+    }
+
+private:
+    typedef Detail::EventChannelBase<AREA> ChannelBaseType;
+
+    template<typename T>
+    using ChannelType = Detail::EventChannel<T, AREA>;
+
+    ChannelBaseType* FindChannel(EventTypeId typeId) const
+    {
+        auto it = m_channels.find(typeId);
+        return it != std::end(m_channels) ? it->second.get() : nullptr;
+    }
+
+    template<typename T>
+    ChannelType<T>& GetChannel()
+    {
+        auto& channel = m_channels[Detail::EventTypeIdOf<T>::Value];
+
+        if (!channel)
+        {
+            channel = STL::make_unique<ChannelType<T>>();
+
+#ifdef _DEBUG
+            channel->dataSize = sizeof(T);
+            channel->dataAlignment = alignof(T);
+#endif
+        }
+
+#ifdef _DEBUG
+        // 型ID は型名から求めるため、別の翻訳単位の無名名前空間にある同名の型は同じ ID になる
+        CIDER_ASSERT(
+            channel->dataSize == sizeof(T) && channel->dataAlignment == alignof(T),
+            "event type id collision (distinct event types share a name).");
+#endif
+
+        return static_cast<ChannelType<T>&>(*channel);
+    }
+
+private:
+    STL::unordered_map<EventTypeId, STL::unique_ptr<ChannelBaseType>> m_channels;
+    Signal<Void(const EventType&)> m_anySignal;
+
+    Detail::ConcurrentEventBuffer<AREA> m_events;
+
+#ifdef _DEBUG
+    std::atomic<Bool> m_dispatching { false };
+#endif
+};
+
+
+typedef EventBus<MEMORY_AREA::SYSTEM> SystemEventBus;
+
+
+} // namespace System
+} // namespace Cider
@@ -0,0 +1,98 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include <type_traits>
+#include <utility>
+
+
+/*
+    イベント型ごとの集約方法
+
+    イベント型に以下を宣言すると、キューに積む時点で同じキーのイベントを 1 つにまとめる
+    ・static constexpr System::EVENT_COALESCE COALESCE = ...;
+    ・static UInt64 CoalesceKey(const T&)                 : 省略可。省略時は型ごとに 1 つ
+    ・static Void Merge(T& pending, const T& incoming)    : MERGE の場合のみ必要
+
+    まとめたイベントは最初に積んだ位置で配送する
+*/
+
+
+namespace Cider {
+namespace System {
+
+
+enum class EVENT_COALESCE
+{
+    NONE                // まとめない
+    , KEEP_LAST         // 後から積んだ値で置き換える
+    , MERGE             // T::Merge で後から積んだ値を合成する
+    , DROP_DUPLICATES   // 後から積んだ値を捨てる
+};
+
+
+namespace Detail {
+
+
+template<typename T, typename = Void>
+struct EventCoalesceOf final
+{
+    static constexpr EVENT_COALESCE Value = EVENT_COALESCE::NONE;
+};
+
+template<typename T>
+struct EventCoalesceOf<T, std::void_t<decltype(T::COALESCE)>> final
+{
+    static constexpr EVENT_COALESCE Value = T::COALESCE;
+};
+
+
+template<typename T, typename = Void>
+struct HasEventCoalesceKey : std::false_type {};
+
+template<typename T>
+struct HasEventCoalesceKey<T, std::void_t<decltype(T::CoalesceKey(std::declval<const T&>()))>> : std::true_type {};
+
+
+template<typename T>
+struct EventCoalescer final
+{
+    static constexpr EVENT_COALESCE POLICY = EventCoalesceOf<T>::Value;
+
+    static UInt64 GetKey(const T& value)
+    {
+        if constexpr (HasEventCoalesceKey<T>::value)
+        {
+            return static_cast<UInt64>(T::CoalesceKey(value));
+        }
+        else
+        {
+            (void)value;
+            return 0;
+        }
+    }
+
+    // 積まれている pending に incoming をまとめる
+    static Void Coalesce(T& pending, T&& incoming)
+    {
+        if constexpr (POLICY == EVENT_COALESCE::KEEP_LAST)
+        {
+            pending = std::move(incoming);
+        }
+        else if constexpr (POLICY == EVENT_COALESCE::MERGE)
+        {
+            T::Merge(pending, static_cast<const T&>(incoming));
+        }
+        else
+        {
+            static_assert(POLICY == EVENT_COALESCE::DROP_DUPLICATES, "<T> is not coalesced.");
+            (void)pending;
+            (void)incoming;
+        }
+    }
+};
+
+
+} // namespace Detail
+} // namespace System
+} // namespace Cider
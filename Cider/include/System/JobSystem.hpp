@@ -0,0 +1,198 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/STL.hpp"
+#include "System/Assert.hpp"
+#include "System/Delegate.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+
+namespace Cider {
+namespace System {
+
+
+class JobSystem;
+
+
+namespace Detail {
+
+
+struct Job;
+
+
+} // namespace Detail
+
+
+/*
+    ジョブの完了を数えるカウンタ
+    ・Submit で counter に渡したジョブの数を数え、全て完了すると 0 になる
+    ・Submit の dependency に渡すと、そのジョブは 0 になるまで積まれない
+      0 になる前に対象のジョブを全て積み終えること (途中で 0 になると、その時点で待っていたジョブが積まれる)
+    ・破棄と再利用は Wait が戻った後 (または IsCompleted が true になった後) に行う
+*/
+class JobCounter final
+{
+public:
+    JobCounter() = default;
+
+    ~JobCounter()
+    {
+        CIDER_ASSERT(m_count.load() == 0 && !m_waitingJobs, "JobCounter destroyed with pending jobs.");
+    }
+
+    JobCounter(const JobCounter&) = delete;
+    Void operator=(const JobCounter&) = delete;
+
+    Bool IsCompleted() const
+    {
+        if (m_count.load(std::memory_order_acquire) != 0)
+        {
+            return false;
+        }
+
+        // 最後のジョブを完了したスレッドがカウンタに触れ終わるのを待つ
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_count.load(std::memory_order_relaxed) == 0;
+    }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<SizeT>  m_count { 0 };
+    mutable std::mutex  m_lock;                     // 0 にする時と、待つジョブを追加する時に取る
+    Detail::Job*        m_waitingJobs = nullptr;    // 0 になるのを待っているジョブ
+};
+
+
+/*
+    ワークスティーリングのジョブシステム
+    ・ワーカースレッドごとに両端キューを持ち、自分のキューの末尾から取り出す。空なら他のワーカーのキューの先頭から盗む
+    ・ワーカー以外のスレッドが積んだジョブは共有のキューに積む
+    ・完了を待つスレッドも、待っている間はジョブを処理する (ジョブの中から待ってもデッドロックしない)
+    ・仕事が無いワーカーはしばらく探した後に眠り、ジョブが積まれると起きる
+    ・ジョブは MEMORY_AREA::JOB からまとめて確保したものを使い回す
+      ワーカーごとに空きを持ち、偏った分だけを共有の空きとまとめてやり取りする
+*/
+class JobSystem final
+{
+public:
+    static constexpr SizeT JOB_INLINE_SIZE = 48;
+    static constexpr SizeT DEQUE_CAPACITY = 4096;
+
+    typedef Delegate<Void(), JOB_INLINE_SIZE> JobFunction;
+    typedef Delegate<Void(SizeT, SizeT)> RangeFunction;
+
+    // ハードウェアスレッド数 - 1 のワーカーを持つ既定のジョブシステム
+    static JobSystem* Instance();
+
+    // workerCount は呼び出したスレッドを含まないワーカーの数
+    // 0 の場合は全てのジョブを待つスレッドで処理する
+    explicit JobSystem(SizeT workerCount);
+
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    Void operator=(const JobSystem&) = delete;
+
+    // function を積む (任意のスレッドから呼べる)
+    // counter は積んだ時点で増やし、完了時に減らす
+    // dependency を指定した場合は、それが 0 になってから積む
+    Void Submit(JobFunction&& function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    // counter が 0 になるまで、ジョブを処理しながら待つ
+    Void Wait(const JobCounter& counter);
+
+    // [0, count) を grainSize 個以下の範囲に分けて function(begin, end) を並列に呼び、全て終わるまで待つ
+    // 範囲は半分ずつに分けて積むため、大きな範囲から順に盗まれる
+    template<typename Function>
+    Void ParallelFor(SizeT count, SizeT grainSize, Function&& function)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (count <= grainSize || m_workerCount == 0)
+        {
+            function(static_cast<SizeT>(0), count);
+            return;
+        }
+
+        RangeFunction rangeFunction = [&function](SizeT begin, SizeT end) {
+            function(begin, end);
+        };
+
+        RunParallelFor(count, grainSize, rangeFunction);
+    }
+
+    SizeT GetWorkerCount() const
+    {
+        return m_workerCount;
+    }
+
+private:
+    typedef Detail::Job Job;
+
+    struct Worker;
+    class WorkStealingDeque;
+
+    // プールからまとめて移す数
+    static constexpr SizeT JOB_BATCH_SIZE = 64;
+    static constexpr SizeT JOB_CHUNK_SIZE = 1024;
+
+    Void RunParallelFor(SizeT count, SizeT grainSize, const RangeFunction& function);
+
+    Void RunRange(const RangeFunction& function, SizeT begin, SizeT end, SizeT grainSize, JobCounter& counter);
+
+    Void Push(Job* job);
+
+    Job* FindJob(Worker* self);
+
+    Void Execute(Job* job);
+
+    Void Complete(JobCounter& counter);
+
+    Job* AllocateJob(JobFunction&& function, JobCounter* counter);
+
+    Void FreeJob(Job* job);
+
+    // 共有の空きから最大 JOB_BATCH_SIZE 個を取り出す。無ければ確保する (m_poolLock を取って呼ぶ)
+    Job* TakeFreeJobs(SizeT& count);
+
+    // JOB_CHUNK_SIZE 個をまとめて確保して共有の空きに加える (m_poolLock を取って呼ぶ)
+    Void AllocateJobChunk();
+
+    Worker* GetCurrentWorker();
+
+    Void WorkerMain(SizeT index);
+
+private:
+    const SizeT                             m_workerCount;
+    STL::vector<STL::unique_ptr<Worker>>    m_workers;
+
+    // ワーカー以外のスレッドと、ワーカー間の偏りの調整に使う空き
+    std::mutex                              m_poolLock;
+    Job*                                    m_freeJobs;
+    STL::vector<Void*>                      m_jobChunks;
+
+    // 積まれて、まだ取り出されていないジョブの数 (眠る判定に使う)
+    alignas(64) std::atomic<SizeT>          m_queuedCount;
+
+    // ワーカー以外のスレッドから積んだジョブ
+    std::mutex                              m_injectedLock;
+    STL::deque<Job*>                        m_injectedJobs;
+    std::atomic<SizeT>                      m_injectedCount;
+
+    std::mutex                              m_sleepLock;
+    std::condition_variable                 m_wakeCondition;
+    std::atomic<SizeT>                      m_sleepingCount;
+    std::atomic<Bool>                       m_stop;
+};
+
+
+} // namespace System
+} // namespace Cider
@@ -2,12 +2,37 @@
 #pragma once
 
 #include "System/Types.hpp"
+#include "System/LogBinary.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 
 namespace Cider {
 namespace System {
 
 
+class LogSink;
+class LogCategory;
+
+namespace Detail {
+
+struct LogRecord;
+
+} // namespace Detail
+
+
+/*
+    ログ
+    呼び出し側は書式文字列のポインタと引数の値をリングバッファへ複製するだけで、
+    書式化と出力 (LogSink) はバックグラウンドスレッドで行う
+    (文字列引数は呼び出し時点の内容を複製する)
+*/
 class Log
 {
 public:
@@ -22,14 +47,733 @@ public:
         , Num
     };
 
-    static Void Format(Level level, const Char* format, ...);
-    static Void Message(Level level, const Char* message);
+    // リングバッファが満杯の場合の動作 (既定は Drop)
+    // レベル表記なしの出力 (ReportLeaks や PrintBackTrace などのレポート) と Error 以上はどちらでも待つ
+    enum class OverflowPolicy
+    {
+        Block       // 空くまで待つ
+        , Drop      // 破棄して件数を数える
+    };
+
+    static Void Initialize();
+
+    static Void Terminate();
+
+    // キューに積まれたログをすべて出力し終えるまで待機する
+    static Void Flush();
+
+    static Void SetOverflowPolicy(OverflowPolicy policy);
+
+    static OverflowPolicy GetOverflowPolicy();
+
+    // 満杯のため破棄されたログの件数
+    static UInt64 GetDroppedCount();
 
-    static Void Format(const Char* format, ...);
+    // ※ シンクは出力スレッドから呼ばれる。シンクの内部でログを出力しないこと
+    static Bool AddSink(LogSink* sink);
+
+    static Void RemoveSink(LogSink* sink);
+
+    static const Char* GetLevelName(Level level);
+
+    // categoryName が nullptr の場合はすべてのカテゴリに設定する
+    static Bool SetCategoryLevel(const Char* categoryName, Level level);
+
+    template<typename... Arguments>
+    static Void Format(Level level, const Char* format, const Arguments&... arguments);
+
+    template<typename... Arguments>
+    static Void Format(
+        const LogCategory& category,
+        Level level,
+        const Char* format,
+        const Arguments&... arguments
+    );
+
+    template<typename... Arguments>
+    static Void Format(const Char* format, const Arguments&... arguments);
+
+    static Void Message(Level level, const Char* message);
     static Void Message(const Char* message);
+
+    // 呼び出し箇所の書式を登録し、バイナリログの書式 ID を返す (CIDER_LOG_BINARY から使用する)
+    static UInt32 RegisterBinaryFormat(
+        Level level,
+        const Char* format,
+        const Char* file,
+        Int32 line,
+        const Char* signature
+    );
+
+    static const LogBinary::FormatInfo* GetBinaryFormat(UInt32 formatId);
+
+    // 書式化を行わず、書式 ID と引数のバイト列のみを記録する
+    template<typename... Arguments>
+    static Void FormatBinary(UInt32 formatId, const Arguments&... arguments);
+
+    // UTC 1970/1/1 からのマイクロ秒
+    static UInt64 GetTimestamp();
+
+    // バイナリログのタイムスタンプ (単調増加、ナノ秒)
+    static UInt64 GetBinaryTimestamp();
+
+private:
+    template<typename... Arguments>
+    static Void Post(
+        const LogCategory* category,
+        Int32 level,
+        const Char* format,
+        const Arguments&... arguments
+    );
+
+    static Void Post(const Detail::LogRecord& record);
+};
+
+
+/*
+    ログのカテゴリ
+    実行時に閾値を変更でき、CIDER_LOG_CATEGORY は書式化の前にこれを確認する
+    ※ 静的記憶域期間のオブジェクトとして定義すること (CIDER_LOG_DEFINE_CATEGORY)
+*/
+class LogCategory
+{
+public:
+    LogCategory(const Char* name, Log::Level level);
+
+    const Char* GetName() const { return m_name; }
+
+    Log::Level GetLevel() const
+    {
+        return static_cast<Log::Level>(m_level.load(std::memory_order_relaxed));
+    }
+
+    Void SetLevel(Log::Level level)
+    {
+        m_level.store(static_cast<Int32>(level), std::memory_order_relaxed);
+    }
+
+    Bool IsEnabled(Log::Level level) const
+    {
+        return static_cast<Int32>(level) >= m_level.load(std::memory_order_relaxed);
+    }
+
+    LogCategory* GetNext() const { return m_next; }
+
+    // CIDER_LOG で使用されるカテゴリ
+    static LogCategory& Default();
+
+    static LogCategory* Find(const Char* name);
+
+    static LogCategory* GetFirst();
+
+private:
+    LogCategory(const LogCategory&) = delete;
+    LogCategory& operator=(const LogCategory&) = delete;
+
+private:
+    const Char*         m_name;
+    std::atomic<Int32>  m_level;
+    LogCategory*        m_next;
+};
+
+
+namespace Detail {
+
+
+typedef SizeT (*LogFormatFunction)(
+    Char* buffer,
+    SizeT bufferSize,
+    const Char* format,
+    const UInt8* payload
+);
+
+
+// リングバッファの1要素分のログ
+struct LogRecord
+{
+    // テキストの 1 件の上限 (従来の書式化バッファと同じ)
+    static constexpr SizeT TEXT_CAPACITY = 1024;
+
+    // Log::Message の文字列 (終端を含めて TEXT_CAPACITY) と、その参照が切り詰めずに収まる大きさ
+    // 複製するのは使用している部分のみ
+    static constexpr SizeT PAYLOAD_CAPACITY = TEXT_CAPACITY + 8;
+
+    const Char*         format;
+    LogFormatFunction   formatFunction;
+    const LogCategory*  category;
+    UInt64              timestamp;      // バイナリログの場合は GetBinaryTimestamp
+    UInt32              formatId;       // バイナリログの書式 ID (テキストは INVALID_FORMAT_ID)
+    Int32               level;          // 負数はレベル表記なし
+    UInt32              payloadSize;
+    alignas(8) UInt8    payload[PAYLOAD_CAPACITY];
+};
+
+
+// 文字列引数は値の後ろに複製し、オフセットで参照する
+struct LogStringReference
+{
+    UInt32 offset;
 };
 
 
+template<typename T>
+struct LogArgument
+{
+    static_assert(
+        std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> || std::is_null_pointer_v<T>,
+        "log argument must be arithmetic, enum, pointer or string."
+    );
+
+    typedef T StoredType;
+
+    static StoredType Store(const T& value, LogRecord&)
+    {
+        return value;
+    }
+
+    static T Load(const StoredType& value, const UInt8*)
+    {
+        return value;
+    }
+};
+
+
+template<>
+struct LogArgument<const Char*>
+{
+    typedef LogStringReference StoredType;
+
+    static StoredType Store(const Char* value, LogRecord& record)
+    {
+        if (value == nullptr)
+        {
+            value = "(null)";
+        }
+
+        // 前の文字列で埋まっている場合は、その終端 (末尾の '\0') を空文字列として参照する
+        // (値の組は PAYLOAD_CAPACITY より小さいため、埋まるのは文字列を切り詰めた時だけ)
+        if (record.payloadSize >= LogRecord::PAYLOAD_CAPACITY)
+        {
+            return StoredType{ static_cast<UInt32>(LogRecord::PAYLOAD_CAPACITY - 1) };
+        }
+
+        // 収まらない場合は切り詰める
+        const SizeT remaining = LogRecord::PAYLOAD_CAPACITY - record.payloadSize;
+        SizeT length = std::strlen(value);
+
+        if (length + 1 > remaining)
+        {
+            length = remaining - 1;
+        }
+
+        StoredType reference = { record.payloadSize };
+        std::memcpy(&record.payload[record.payloadSize], value, length);
+        record.payload[record.payloadSize + length] = '\0';
+        record.payloadSize += static_cast<UInt32>(length + 1);
+
+        return reference;
+    }
+
+    static const Char* Load(const StoredType& value, const UInt8* payload)
+    {
+        return reinterpret_cast<const Char*>(payload + value.offset);
+    }
+};
+
+
+// 配列や Char* は const Char* として扱う
+template<typename T>
+using LogArgumentType = std::conditional_t<
+    std::is_same_v<std::decay_t<T>, Char*>,
+    const Char*,
+    std::decay_t<T>
+>;
+
+
+template<typename... Arguments>
+struct LogArgumentPack
+{
+    typedef std::tuple<typename LogArgument<Arguments>::StoredType...> StoredTuple;
+
+    static_assert(
+        (std::is_trivially_copyable_v<typename LogArgument<Arguments>::StoredType> && ...),
+        ""
+    );
+    static_assert(sizeof(StoredTuple) < LogRecord::PAYLOAD_CAPACITY, "too many log arguments.");
+    static_assert(alignof(StoredTuple) <= 8, "");
+
+    static Void Store(LogRecord& record, const Arguments&... arguments)
+    {
+        // 文字列は値の後ろに複製される
+        record.payloadSize = static_cast<UInt32>(sizeof(StoredTuple));
+
+        new (record.payload) StoredTuple(
+            LogArgument<Arguments>::Store(arguments, record)...
+        );
+    }
+
+    static SizeT Format(
+        Char* buffer,
+        SizeT bufferSize,
+        const Char* format,
+        const UInt8* payload
+    )
+    {
+        return FormatImpl(
+            buffer,
+            bufferSize,
+            format,
+            payload,
+            std::index_sequence_for<Arguments...>{}
+        );
+    }
+
+private:
+    template<SizeT... Indices>
+    static SizeT FormatImpl(
+        Char* buffer,
+        SizeT bufferSize,
+        const Char* format,
+        const UInt8* payload,
+        std::index_sequence<Indices...>
+    )
+    {
+        const StoredTuple& stored = *reinterpret_cast<const StoredTuple*>(payload);
+        (Void)stored;
+
+        const Int32 length = std::snprintf(
+            buffer,
+            bufferSize,
+            format,
+            LogArgument<Arguments>::Load(std::get<Indices>(stored), payload)...
+        );
+
+        if (length < 0) { return 0; }
+
+        return (static_cast<SizeT>(length) < bufferSize) ? static_cast<SizeT>(length) : bufferSize - 1;
+    }
+};
+
+
+/*
+    書式文字列と引数の型の検査 (コンパイル時)
+*/
+enum class LogArgumentKind : UInt8
+{
+    Integer
+    , Floating
+    , LongDouble
+    , String
+    , Pointer
+};
+
+
+struct LogArgumentInfo
+{
+    LogArgumentKind kind;
+    UInt8           size;
+};
+
+
+template<typename T>
+constexpr LogArgumentInfo GetLogArgumentInfo()
+{
+    if constexpr (std::is_same_v<T, const Char*>)
+    {
+        return { LogArgumentKind::String, sizeof(T) };
+    }
+    else if constexpr (std::is_same_v<T, long double>)
+    {
+        return { LogArgumentKind::LongDouble, sizeof(T) };
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        return { LogArgumentKind::Floating, sizeof(T) };
+    }
+    else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>)
+    {
+        return { LogArgumentKind::Pointer, sizeof(T) };
+    }
+    else
+    {
+        return { LogArgumentKind::Integer, sizeof(T) };
+    }
+}
+
+
+template<typename... Arguments>
+struct LogArgumentList
+{
+    static constexpr SizeT COUNT = sizeof...(Arguments);
+
+    static constexpr LogArgumentInfo INFOS[COUNT + 1] = {
+        GetLogArgumentInfo<Arguments>()...,
+        { LogArgumentKind::Integer, 0 }
+    };
+};
+
+
+// 呼び出しは行わず、decltype で引数の型の一覧を得るために使用する
+template<typename... Arguments>
+LogArgumentList<LogArgumentType<Arguments>...> MakeLogArgumentList(const Arguments&...);
+
+
+constexpr Bool IsLogFormatDigit(Char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+
+// 幅・精度の '*' は int の引数を消費する
+template<typename ArgumentList>
+constexpr Bool ConsumeLogFormatWidth(SizeT& argumentIndex)
+{
+    if (argumentIndex >= ArgumentList::COUNT) { return false; }
+
+    const LogArgumentInfo& info = ArgumentList::INFOS[argumentIndex++];
+    return info.kind == LogArgumentKind::Integer && info.size <= sizeof(Int32);
+}
+
+
+// printf 形式の変換指定子と引数の型・個数が一致するか
+template<typename ArgumentList>
+constexpr Bool ValidateLogFormat(const Char* format)
+{
+    SizeT argumentIndex = 0;
+
+    for (const Char* p = format; *p != '\0'; ++p)
+    {
+        if (*p != '%') { continue; }
+
+        ++p;
+
+        if (*p == '%') { continue; }
+
+        // フラグ
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') { ++p; }
+
+        // 幅
+        if (*p == '*')
+        {
+            if (!ConsumeLogFormatWidth<ArgumentList>(argumentIndex)) { return false; }
+            ++p;
+        }
+        while (IsLogFormatDigit(*p)) { ++p; }
+
+        // 精度
+        if (*p == '.')
+        {
+            ++p;
+
+            if (*p == '*')
+            {
+                if (!ConsumeLogFormatWidth<ArgumentList>(argumentIndex)) { return false; }
+                ++p;
+            }
+            while (IsLogFormatDigit(*p)) { ++p; }
+        }
+
+        // 長さ修飾子 (0 は修飾子なし)
+        SizeT integerSize = 0;
+        Bool longDouble = false;
+        Bool longModifier = false;
+
+        if (p[0] == 'h' && p[1] == 'h')      { integerSize = sizeof(Char); p += 2; }
+        else if (p[0] == 'h')                { integerSize = sizeof(Int16); p += 1; }
+        else if (p[0] == 'l' && p[1] == 'l') { integerSize = sizeof(long long); p += 2; }
+        else if (p[0] == 'l')                { integerSize = sizeof(long); longModifier = true; p += 1; }
+        else if (p[0] == 'j')                { integerSize = sizeof(Int64); p += 1; }
+        else if (p[0] == 'z')                { integerSize = sizeof(SizeT); p += 1; }
+        else if (p[0] == 't')                { integerSize = sizeof(PtrDiff); p += 1; }
+        else if (p[0] == 'L')                { longDouble = true; p += 1; }
+        else if (p[0] == 'I' && p[1] == '6' && p[2] == '4') { integerSize = sizeof(Int64); p += 3; }
+        else if (p[0] == 'I' && p[1] == '3' && p[2] == '2') { integerSize = sizeof(Int32); p += 3; }
+        else if (p[0] == 'I')                { integerSize = sizeof(SizeT); p += 1; }
+
+        if (argumentIndex >= ArgumentList::COUNT) { return false; }
+
+        const LogArgumentInfo& info = ArgumentList::INFOS[argumentIndex++];
+
+        switch (*p)
+        {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+        {
+            if (info.kind != LogArgumentKind::Integer || longDouble) { return false; }
+
+            // 可変長引数の既定の昇格後のサイズで比較する
+            const SizeT expectedSize = (integerSize < sizeof(Int32)) ? sizeof(Int32) : integerSize;
+            const SizeT promotedSize = (info.size < sizeof(Int32)) ? sizeof(Int32) : info.size;
+
+            if (promotedSize != expectedSize) { return false; }
+            break;
+        }
+
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if (longDouble)
+            {
+                if (info.kind != LogArgumentKind::LongDouble) { return false; }
+            }
+            else if (info.kind != LogArgumentKind::Floating || (integerSize != 0 && !longModifier))
+            {
+                return false;
+            }
+            break;
+
+        case 's':
+            if (info.kind != LogArgumentKind::String || integerSize != 0 || longDouble) { return false; }
+            break;
+
+        case 'p':
+            if (info.kind != LogArgumentKind::Pointer) { return false; }
+            break;
+
+        default:
+            // %n や不明な指定子
+            return false;
+        }
+    }
+
+    return argumentIndex == ArgumentList::COUNT;
+}
+
+
+/*
+    バイナリログの引数
+*/
+template<typename T>
+struct LogBinaryArgument
+{
+    static constexpr SizeT SIZE = LogBinary::GetTypeSize(LogBinary::GetTypeCode<T>());
+
+    // reserved は後ろの引数のために空けておく固定長の部分のバイト数
+    // 文字列がこれを残して切り詰めるため、固定長の値は常に収まる
+    static Void Write(LogRecord& record, const T& value, SizeT reserved)
+    {
+        (Void)reserved;
+
+        if constexpr (std::is_null_pointer_v<T>)
+        {
+            const UInt64 address = 0;
+            std::memcpy(&record.payload[record.payloadSize], &address, SIZE);
+        }
+        else if constexpr (std::is_pointer_v<T>)
+        {
+            const UInt64 address = static_cast<UInt64>(reinterpret_cast<std::uintptr_t>(value));
+            std::memcpy(&record.payload[record.payloadSize], &address, SIZE);
+        }
+        else
+        {
+            std::memcpy(&record.payload[record.payloadSize], &value, SIZE);
+        }
+
+        record.payloadSize += static_cast<UInt32>(SIZE);
+    }
+};
+
+
+template<>
+struct LogBinaryArgument<const Char*>
+{
+    static constexpr SizeT SIZE = sizeof(UInt16);
+
+    static Void Write(LogRecord& record, const Char* value, SizeT reserved)
+    {
+        if (value == nullptr)
+        {
+            value = "(null)";
+        }
+
+        // 収まらない場合は、後ろの引数の固定長の部分を残して切り詰める
+        const SizeT used = record.payloadSize + SIZE + reserved;
+        const SizeT remaining = (used < LogRecord::PAYLOAD_CAPACITY) ? LogRecord::PAYLOAD_CAPACITY - used : 0;
+        SizeT length = std::strlen(value);
+
+        if (length > remaining)
+        {
+            length = remaining;
+        }
+
+        const UInt16 length16 = static_cast<UInt16>(length);
+        std::memcpy(&record.payload[record.payloadSize], &length16, SIZE);
+        std::memcpy(&record.payload[record.payloadSize + SIZE], value, length);
+
+        record.payloadSize += static_cast<UInt32>(SIZE + length);
+    }
+};
+
+
+template<typename ArgumentList>
+struct LogBinarySignature;
+
+template<typename... Arguments>
+struct LogBinarySignature<LogArgumentList<Arguments...>>
+{
+    static constexpr Char VALUE[] = { LogBinary::GetTypeCode<Arguments>()..., '\0' };
+
+    // 文字列は長さのみ
+    static constexpr SizeT FIXED_SIZE = (LogBinaryArgument<Arguments>::SIZE + ... + 0);
+
+    static_assert(FIXED_SIZE < LogRecord::PAYLOAD_CAPACITY, "too many log arguments.");
+};
+
+
+} // namespace Detail
+
+
+template<typename... Arguments>
+inline Void Log::FormatBinary(UInt32 formatId, const Arguments&... arguments)
+{
+    const LogBinary::FormatInfo* info = GetBinaryFormat(formatId);
+
+    if (info == nullptr) { return; }
+
+    Detail::LogRecord record;
+    record.format = nullptr;
+    record.formatFunction = nullptr;
+    record.category = nullptr;
+    record.timestamp = GetBinaryTimestamp();
+    record.formatId = formatId;
+    record.level = info->level;         // 満杯時の破棄の判定に使う (出力には書式の側のレベルを使う)
+    record.payloadSize = 0;
+
+    // 先頭から順に書き、書くたびに残りの引数の固定長の部分を減らす
+    SizeT reserved = Detail::LogBinarySignature<Detail::LogArgumentList<Detail::LogArgumentType<Arguments>...>>::FIXED_SIZE;
+
+    ((reserved -= Detail::LogBinaryArgument<Detail::LogArgumentType<Arguments>>::SIZE,
+      Detail::LogBinaryArgument<Detail::LogArgumentType<Arguments>>::Write(record, arguments, reserved)), ...);
+
+    Post(record);
+}
+
+template<typename... Arguments>
+inline Void Log::Format(Level level, const Char* format, const Arguments&... arguments)
+{
+    Post<Detail::LogArgumentType<Arguments>...>(nullptr, static_cast<Int32>(level), format, arguments...);
+}
+
+template<typename... Arguments>
+inline Void Log::Format(
+    const LogCategory& category,
+    Level level,
+    const Char* format,
+    const Arguments&... arguments
+)
+{
+    Post<Detail::LogArgumentType<Arguments>...>(&category, static_cast<Int32>(level), format, arguments...);
+}
+
+template<typename... Arguments>
+inline Void Log::Format(const Char* format, const Arguments&... arguments)
+{
+    Post<Detail::LogArgumentType<Arguments>...>(nullptr, -1, format, arguments...);
+}
+
+template<typename... Arguments>
+inline Void Log::Post(
+    const LogCategory* category,
+    Int32 level,
+    const Char* format,
+    const Arguments&... arguments
+)
+{
+    if (format == nullptr || format[0] == '\0') { return; }
+
+    typedef Detail::LogArgumentPack<Arguments...> ArgumentPack;
+
+    Detail::LogRecord record;
+    record.format = format;
+    record.formatFunction = &ArgumentPack::Format;
+    record.category = category;
+    record.timestamp = GetTimestamp();
+    record.formatId = LogBinary::INVALID_FORMAT_ID;
+    record.level = level;
+
+    ArgumentPack::Store(record, arguments...);
+
+    Post(record);
+}
+
+
 } // namespace System
 } // namespace Cider
 
+
+/*
+    CIDER_LOG(Verbose, "deltaTime=%lf", deltaTime);
+
+    ・CIDER_LOG_MIN_LEVEL 未満のレベルは引数の評価を含めてコンパイル時に取り除かれる
+    ・書式化の前にカテゴリの閾値を確認する
+    ・書式文字列 (リテラルに限る) と引数の型はコンパイル時に検査される
+*/
+#define CIDER_LOG_LEVEL_VERBOSE 0
+#define CIDER_LOG_LEVEL_DEBUG   1
+#define CIDER_LOG_LEVEL_INFO    2
+#define CIDER_LOG_LEVEL_WARNING 3
+#define CIDER_LOG_LEVEL_ERROR   4
+#define CIDER_LOG_LEVEL_ASSERT  5
+#define CIDER_LOG_LEVEL_NONE    6
+
+#ifndef CIDER_LOG_MIN_LEVEL
+#   ifdef _DEBUG
+#       define CIDER_LOG_MIN_LEVEL CIDER_LOG_LEVEL_VERBOSE
+#   else
+#       define CIDER_LOG_MIN_LEVEL CIDER_LOG_LEVEL_INFO
+#   endif
+#endif
+
+#define CIDER_LOG_CATEGORY(category, level, format, ...) \
+    do \
+    { \
+        static_assert( \
+            Cider::System::Detail::ValidateLogFormat< \
+                decltype(Cider::System::Detail::MakeLogArgumentList(__VA_ARGS__))>(format), \
+            "log format does not match the arguments."); \
+        if constexpr (Cider::System::Log::level >= CIDER_LOG_MIN_LEVEL) \
+        { \
+            if ((category).IsEnabled(Cider::System::Log::level)) \
+            { \
+                Cider::System::Log::Format((category), Cider::System::Log::level, format, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (false)
+
+/*
+    CIDER_LOG_BINARY(Info, "frame=%u time=%lf", frame, time);
+
+    書式は呼び出し箇所ごとに 1 度だけ登録され、以降は書式 ID と引数のバイト列のみを記録する
+    出力は WriteBinary を実装したシンク (BinaryFileLogSink) にのみ渡され、
+    CiderLogDecoder でテキストに戻す
+*/
+#define CIDER_LOG_BINARY_CATEGORY(category, level, format, ...) \
+    do \
+    { \
+        typedef decltype(Cider::System::Detail::MakeLogArgumentList(__VA_ARGS__)) CiderLogArgumentList; \
+        static_assert( \
+            Cider::System::Detail::ValidateLogFormat<CiderLogArgumentList>(format), \
+            "log format does not match the arguments."); \
+        if constexpr (Cider::System::Log::level >= CIDER_LOG_MIN_LEVEL) \
+        { \
+            if ((category).IsEnabled(Cider::System::Log::level)) \
+            { \
+                static const Cider::UInt32 s_ciderLogFormatId = Cider::System::Log::RegisterBinaryFormat( \
+                    Cider::System::Log::level, \
+                    format, \
+                    __FILE__, \
+                    __LINE__, \
+                    Cider::System::Detail::LogBinarySignature<CiderLogArgumentList>::VALUE); \
+                Cider::System::Log::FormatBinary(s_ciderLogFormatId, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (false)
+
+#define CIDER_LOG_BINARY(level, format, ...) \
+    CIDER_LOG_BINARY_CATEGORY(Cider::System::LogCategory::Default(), level, format, ##__VA_ARGS__)
+
+#define CIDER_LOG(level, format, ...) \
+    CIDER_LOG_CATEGORY(Cider::System::LogCategory::Default(), level, format, ##__VA_ARGS__)
+
+#define CIDER_LOG_DECLARE_CATEGORY(name) \
+    extern Cider::System::LogCategory name
+
+#define CIDER_LOG_DEFINE_CATEGORY(name, level) \
+    Cider::System::LogCategory name(#name, Cider::System::Log::level)
@@ -0,0 +1,134 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include <type_traits>
+
+
+namespace Cider {
+namespace System {
+namespace LogBinary {
+
+
+/*
+    バイナリログのファイル形式 (リトルエンディアン)
+    ライブラリに依存しないため、デコーダからも単体で使用できる
+
+    ファイル   : FileHeader, Frame...
+    FRAME_FORMAT : type(1) formatId(4) level(1) line(4)
+                   fileLength(2) file formatLength(2) format signatureLength(1) signature
+    FRAME_EVENT  : type(1) formatId(4) timestamp(8) payloadSize(2) payload
+    FRAME_TEXT   : type(1) level(1) systemTime(8) textLength(4) text
+
+    FRAME_FORMAT は その書式の最初の FRAME_EVENT の直前に 1 度だけ書き込まれる
+    payload は signature の型コード順に引数を詰めたもの (文字列は長さ(2) + 文字列、終端文字なし)
+*/
+
+
+constexpr Char      MAGIC[8] = { 'C', 'I', 'D', 'E', 'R', 'L', 'O', 'G' };
+constexpr UInt32    VERSION = 1;
+
+constexpr UInt32    INVALID_FORMAT_ID = 0;
+constexpr UInt32    MAX_FORMAT_COUNT = 4096;
+constexpr UInt8     NO_LEVEL = 0xFF;
+
+
+struct FileHeader
+{
+    Char        magic[8];
+    UInt32      version;
+    UInt32      reserved;
+    UInt64      baseSystemTime;     // UTC 1970/1/1 からのマイクロ秒
+    UInt64      baseTimestamp;      // 同時刻の FRAME_EVENT のタイムスタンプ (ナノ秒)
+};
+
+static_assert(sizeof(FileHeader) == 32, "");
+
+
+enum FrameType : UInt8
+{
+    FRAME_FORMAT = 1
+    , FRAME_EVENT = 2
+    , FRAME_TEXT = 3
+};
+
+
+// 登録された書式 (呼び出し箇所ごとに 1 つ)
+struct FormatInfo
+{
+    const Char*     format;
+    const Char*     file;
+    const Char*     signature;
+    Int32           line;
+    Int32           level;
+};
+
+
+/*
+    引数の型コード (Python の struct モジュールに準拠)
+    b/B : 8bit, h/H : 16bit, i/I : 32bit, q/Q : 64bit (小文字は符号付き)
+    ? : Bool, f : Float, d : Double, s : 文字列, P : ポインタ (64bit で記録)
+*/
+template<typename T>
+constexpr Char GetTypeCode()
+{
+    static_assert(!std::is_same_v<T, long double>, "long double is not supported by binary log.");
+
+    if constexpr (std::is_same_v<T, const Char*>)
+    {
+        return 's';
+    }
+    else if constexpr (std::is_same_v<T, Bool>)
+    {
+        return '?';
+    }
+    else if constexpr (std::is_same_v<T, Float>)
+    {
+        return 'f';
+    }
+    else if constexpr (std::is_same_v<T, Double>)
+    {
+        return 'd';
+    }
+    else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>)
+    {
+        return 'P';
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        return GetTypeCode<std::underlying_type_t<T>>();
+    }
+    else
+    {
+        static_assert(std::is_integral_v<T>, "");
+
+        constexpr Bool isSigned = std::is_signed_v<T>;
+
+        switch (sizeof(T))
+        {
+        case 1: return isSigned ? 'b' : 'B';
+        case 2: return isSigned ? 'h' : 'H';
+        case 4: return isSigned ? 'i' : 'I';
+        default: return isSigned ? 'q' : 'Q';
+        }
+    }
+}
+
+
+// 固定長の型のサイズ (文字列は 0)
+constexpr SizeT GetTypeSize(Char code)
+{
+    switch (code)
+    {
+    case 'b': case 'B': case '?': return 1;
+    case 'h': case 'H': return 2;
+    case 'i': case 'I': case 'f': return 4;
+    case 'q': case 'Q': case 'd': case 'P': return 8;
+    default: return 0;
+    }
+}
+
+
+} // namespace LogBinary
+} // namespace System
+} // namespace Cider
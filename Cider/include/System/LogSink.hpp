@@ -0,0 +1,239 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/Log.hpp"
+#include "System/STL.hpp"
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+
+namespace Cider {
+namespace System {
+
+
+// 書式化済みのログ 1 件分
+struct LogEntry
+{
+    Log::Level      level;
+    Bool            hasLevel;       // false の場合 level は無効
+    UInt64          timestamp;      // UTC 1970/1/1 からのマイクロ秒
+    const Char*     category;       // カテゴリ名 (カテゴリ指定なしは nullptr)
+    const Char*     text;           // レベル表記を含む (終端文字あり)
+    SizeT           length;
+};
+
+
+// バイナリログ 1 件分 (書式化しない)
+struct LogBinaryEntry
+{
+    UInt32          formatId;
+    UInt64          timestamp;      // Log::GetBinaryTimestamp
+    const UInt8*    payload;        // 引数のバイト列 (LogBinary 参照)
+    SizeT           payloadSize;
+};
+
+
+/*
+    ログの出力先
+    Write / Flush はログの出力スレッド (パイプライン停止中は呼び出し元スレッド) から呼ばれる
+*/
+class LogSink
+{
+public:
+    virtual ~LogSink() = default;
+
+    virtual Void Write(const LogEntry& entry) = 0;
+
+    // バイナリログは対応するシンクのみが受け取る
+    virtual Void WriteBinary(const LogBinaryEntry&) {}
+
+    virtual Void Flush() {}
+
+    // 出力するログがない間、出力スレッドから定期的 (10ms 程度) に呼ばれる
+    virtual Void Idle() {}
+};
+
+
+// デバッガの出力ウィンドウ
+class DebuggerLogSink final : public LogSink
+{
+public:
+    Void Write(const LogEntry& entry) override;
+};
+
+
+// 標準出力
+class ConsoleLogSink final : public LogSink
+{
+public:
+    Void Write(const LogEntry& entry) override;
+
+    Void Flush() override;
+};
+
+
+// ファイル
+class FileLogSink final : public LogSink
+{
+public:
+    FileLogSink();
+
+    ~FileLogSink() override;
+
+    Bool Open(const Char* path, Bool append = false);
+
+    Void Close();
+
+    Bool IsOpen() const { return m_file != nullptr; }
+
+    Void Write(const LogEntry& entry) override;
+
+    Void Flush() override;
+
+private:
+    FileLogSink(const FileLogSink&) = delete;
+    FileLogSink& operator=(const FileLogSink&) = delete;
+
+private:
+    std::FILE*  m_file;
+};
+
+
+/*
+    ファイル (ローテーションあり)
+    書き込みはバッファにまとめ、満杯になるか一定時間が経過した時点でファイルへ書き出す
+    サイズまたは経過時間でローテーションし、古いファイルは <名前>.1.log, <名前>.2.log ... として残す
+*/
+class RotatingFileLogSink final : public LogSink
+{
+public:
+    struct Settings
+    {
+        const Char*     path = "Cider.log";
+        SizeT           bufferSize = 256 * 1024;
+        UInt32          flushIntervalMilliseconds = 1000;
+        UInt64          maxFileSize = 16 * 1024 * 1024;     // 0 の場合はサイズでローテーションしない
+        UInt32          rotationIntervalSeconds = 0;        // 0 の場合は時間でローテーションしない
+        UInt32          maxBackupCount = 5;
+    };
+
+    RotatingFileLogSink();
+
+    ~RotatingFileLogSink() override;
+
+    // 既存のファイルはローテーションしてから開く
+    Bool Open(const Settings& settings);
+
+    Void Close();
+
+    Bool IsOpen() const { return m_file != nullptr; }
+
+    Void Write(const LogEntry& entry) override;
+
+    Void Flush() override;
+
+    Void Idle() override;
+
+    // 出力スレッド以外からも呼べる
+    UInt64 GetWrittenBytes() const { return m_writtenBytes.load(std::memory_order_relaxed); }
+
+    UInt32 GetRotationCount() const { return m_rotationCount.load(std::memory_order_relaxed); }
+
+private:
+    RotatingFileLogSink(const RotatingFileLogSink&) = delete;
+    RotatingFileLogSink& operator=(const RotatingFileLogSink&) = delete;
+
+    Bool OpenFile();
+
+    Void WriteBuffer();
+
+    Void Rotate();
+
+    STL::string GetBackupPath(UInt32 index) const;
+
+    // 書き込むのは出力スレッドのみのため、読み出しと加算を分けてよい
+    Void AddWrittenBytes(UInt64 bytes)
+    {
+        m_writtenBytes.store(m_writtenBytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+private:
+    Settings            m_settings;
+    STL::string         m_path;
+    std::FILE*          m_file;
+    STL::vector<Char>   m_buffer;
+    SizeT               m_bufferUsed;
+    UInt64              m_fileSize;
+    UInt64              m_fileOpenTime;
+    UInt64              m_lastWriteTime;
+    std::atomic<UInt64> m_writtenBytes;     // 書き込むのは出力スレッドのみ
+    std::atomic<UInt32> m_rotationCount;
+};
+
+
+// バイナリ形式のファイル (CiderLogDecoder でテキストに変換する)
+class BinaryFileLogSink final : public LogSink
+{
+public:
+    BinaryFileLogSink();
+
+    ~BinaryFileLogSink() override;
+
+    Bool Open(const Char* path);
+
+    Void Close();
+
+    Bool IsOpen() const { return m_file != nullptr; }
+
+    Void Write(const LogEntry& entry) override;
+
+    Void WriteBinary(const LogBinaryEntry& entry) override;
+
+    Void Flush() override;
+
+private:
+    BinaryFileLogSink(const BinaryFileLogSink&) = delete;
+    BinaryFileLogSink& operator=(const BinaryFileLogSink&) = delete;
+
+    Bool WriteFormat(UInt32 formatId);
+
+    template<typename T>
+    Void WriteValue(const T& value)
+    {
+        std::fwrite(&value, sizeof(T), 1, m_file);
+    }
+
+private:
+    std::FILE*          m_file;
+    STL::vector<Bool>   m_writtenFormats;
+};
+
+
+// 直近 capacity バイト分のログをメモリに保持する
+class MemoryLogSink final : public LogSink
+{
+public:
+    explicit MemoryLogSink(SizeT capacity);
+
+    Void Write(const LogEntry& entry) override;
+
+    // 保持しているログを古い順にコピーする (終端文字を含む)
+    SizeT CopyTo(Char* buffer, SizeT bufferSize) const;
+
+    Void Clear();
+
+    UInt64 GetWrittenBytes() const;
+
+private:
+    mutable std::mutex  m_lock;
+    STL::vector<Char>   m_buffer;
+    SizeT               m_head;
+    SizeT               m_size;
+    UInt64              m_writtenBytes;
+};
+
+
+} // namespace System
+} // namespace Cider
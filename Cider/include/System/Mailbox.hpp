@@ -0,0 +1,94 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/STL.hpp"
+#include "System/Delegate.hpp"
+#include <atomic>
+#include <limits>
+#include <thread>
+
+
+namespace Cider {
+namespace System {
+
+
+/*
+    スレッド宛ての処理キュー (複数書き込み・単一読み込みのロックフリーリングバッファ)
+    ・Post は任意のスレッドから呼べる。満杯の場合は空くまで待つ
+      ただし受け取り側のスレッド (最後に Dispatch したスレッド) は待つと誰も取り出さなくなるため、
+      容量を超えた分を別の配列に溢れさせ、次の Dispatch でリングバッファの後に実行する
+    ・Dispatch は受け取り側のスレッドから呼び、積まれた処理をそのスレッドで実行する
+      受け取り側のスレッドは 1 つに固定する (溢れた処理はそのスレッドだけが積み、取り出す)
+    ・破棄時に未実行の処理は実行せずに捨てる
+*/
+class Mailbox final
+{
+public:
+    static constexpr SizeT TASK_INLINE_SIZE = 64;
+    static constexpr SizeT DEFAULT_CAPACITY = 1024;
+
+    typedef Delegate<Void(), TASK_INLINE_SIZE> Task;
+
+    // capacity は 2 の累乗
+    explicit Mailbox(SizeT capacity = DEFAULT_CAPACITY);
+
+    ~Mailbox();
+
+    Mailbox(const Mailbox&) = delete;
+    Void operator=(const Mailbox&) = delete;
+
+    Void Post(Task&& task);
+
+    // 実行した処理の数を返す
+    // 実行中の処理が Post したものも maxCount に達するまで続けて実行する
+    SizeT Dispatch(SizeT maxCount = std::numeric_limits<SizeT>::max());
+
+    Bool IsEmpty() const;
+
+    SizeT GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    // 満杯のため受け取り側のスレッドが溢れさせた処理の累計
+    UInt64 GetSpilledCount() const
+    {
+        return m_spilledCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    // sequence == 位置     : 書き込み可能
+    // sequence == 位置 + 1 : 読み込み可能
+    struct Cell
+    {
+        std::atomic<SizeT>  sequence;
+        Task                task;
+    };
+
+    // 受け取り側のスレッドのみ
+    Void Spill(Task&& task);
+
+private:
+    // 書き込み側と読み込み側の位置は別のキャッシュラインに置く
+    alignas(64) std::atomic<SizeT>  m_enqueuePosition;
+    alignas(64) std::atomic<SizeT>  m_dequeuePosition;
+
+    STL::unique_ptr<Cell[]>         m_cells;
+    SizeT                           m_capacity;
+    SizeT                           m_mask;
+
+    std::atomic<std::thread::id>    m_dispatchThread;           // 最後に Dispatch したスレッド
+    STL::vector<Task>               m_spill;                    // 受け取り側のスレッドのみ
+    SizeT                           m_spillIndex;               // m_spill の次に実行する位置
+    std::atomic<SizeT>              m_pendingSpillCount;        // 未実行の溢れた処理の数 (IsEmpty 用)
+    std::atomic<UInt64>             m_spilledCount;
+
+#ifdef _DEBUG
+    std::atomic<Bool>               m_dispatching;
+#endif
+};
+
+
+} // namespace System
+} // namespace Cider
@@ -3,6 +3,7 @@
 
 #include "dlmalloc/malloc.h"
 #include "System/Types.hpp"
+#include "System/StackTrace.hpp"
 #include <chrono>
 #include <mutex>
 #include <atomic>
@@ -29,6 +30,7 @@ enum class MEMORY_AREA
     , SYSTEM
     , GRAPHICS
     , APPLICATION
+    , JOB
     , NUM
 };
 
@@ -69,6 +71,7 @@ public:
         MEMORY_AREA     area;
         std::chrono::system_clock::time_point date;
         UInt64          stackTraceHash;
+        StackTrace::StackId stackTraceId;
         UInt64          bookmark;
 
         DebugInfo();
@@ -100,12 +103,18 @@ public:
 
 private:
     static DebugInfo * FindInfo(Void* address);
-    static Void SetInfo(const DebugInfo& info);
+    // 保持数を超えて記録できなかった場合は false
+    static Bool SetInfo(const DebugInfo& info);
+
+    static Void PrintReportInfo(SizeT count);
 
 
 public:
     static constexpr SizeT DEFAULT_ALIGNMENT_SIZE = sizeof(UInt64);
 
+    // 確保時に記録するスタックトレースの深さ
+    static constexpr UInt32 STACK_TRACE_DEPTH = 16;
+
 private:
     static constexpr SizeT MEMORY_TRAP_SIZE = sizeof(UInt32);
     static constexpr UInt32 MEMORY_TRAP = 0xCDCDCDCD;
@@ -116,8 +125,12 @@ private:
     static std::mutex m_infoLock;
     static std::array<DebugInfo, 1024> m_memoryInfo;
 
+    static std::mutex m_reportLock;
+    static std::array<DebugInfo, 1024> m_reportInfo;
+
     static std::atomic<UInt64> m_allocCount;
     static std::atomic<UInt64> m_instanceCount;
+    static std::atomic<UInt64> m_droppedInfoCount;  // 保持数を超えて記録しなかった確保の数
 
     static Bool m_initialized;
 };
@@ -0,0 +1,214 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/Assert.hpp"
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+/*
+    Signal の戻り値の合成方法
+
+    合成クラスは以下を満たすこと
+    ・ResultType    : 発行の戻り値の型
+    ・Bool operator()(Result value) : スロットの戻り値を受け取る。false を返すと残りのスロットを呼ばない
+    ・ResultType GetResult()        : 発行の最後に一度だけ呼ばれる
+*/
+
+
+namespace Cider {
+namespace System {
+
+
+// 全ての戻り値を配列に集める (既定)
+template<typename Result>
+class CollectCombiner final
+{
+public:
+    typedef std::vector<Result> ResultType;
+
+    Bool operator()(Result value)
+    {
+        m_results.push_back(std::move(value));
+        return true;
+    }
+
+    ResultType GetResult()
+    {
+        return std::move(m_results);
+    }
+
+private:
+    ResultType m_results;
+};
+
+
+// 最後に呼ばれたスロットの戻り値 (スロットが無ければ空)
+template<typename Result>
+class LastCombiner final
+{
+public:
+    typedef std::optional<Result> ResultType;
+
+    Bool operator()(Result value)
+    {
+        m_result = std::move(value);
+        return true;
+    }
+
+    ResultType GetResult()
+    {
+        return std::move(m_result);
+    }
+
+private:
+    ResultType m_result;
+};
+
+
+// 戻り値の総和
+template<typename Result>
+class SumCombiner final
+{
+public:
+    typedef Result ResultType;
+
+    Bool operator()(Result value)
+    {
+        m_sum += value;
+        return true;
+    }
+
+    ResultType GetResult()
+    {
+        return m_sum;
+    }
+
+private:
+    ResultType m_sum {};
+};
+
+
+// predicate を満たした最初の戻り値で打ち切る (満たすものが無ければ空)
+template<typename Result, typename Predicate>
+class ShortCircuitCombiner final
+{
+public:
+    typedef std::optional<Result> ResultType;
+
+    explicit ShortCircuitCombiner(Predicate predicate = Predicate())
+        : m_predicate(std::move(predicate))
+    {}
+
+    Bool operator()(Result value)
+    {
+        if (m_predicate(value))
+        {
+            m_result = std::move(value);
+            return false;
+        }
+        return true;
+    }
+
+    ResultType GetResult()
+    {
+        return std::move(m_result);
+    }
+
+private:
+    Predicate   m_predicate;
+    ResultType  m_result;
+};
+
+
+// true (非 null) に評価される最初の戻り値で打ち切る (拒否権付きの問い合わせなど)
+// 満たすものが無ければ値初期化した Result を返す
+template<typename Result>
+class FirstTrueCombiner final
+{
+public:
+    typedef Result ResultType;
+
+    Bool operator()(Result value)
+    {
+        if (static_cast<Bool>(value))
+        {
+            m_result = std::move(value);
+            return false;
+        }
+        return true;
+    }
+
+    ResultType GetResult()
+    {
+        return std::move(m_result);
+    }
+
+private:
+    ResultType m_result {};
+};
+
+
+// 呼び出し側のバッファに格納し、格納した個数を返す
+// 容量を超えた戻り値は捨てる (スロットは全て呼ばれる)
+template<typename Result>
+class BufferCombiner final
+{
+public:
+    typedef SizeT ResultType;
+
+    BufferCombiner(Result* buffer, SizeT capacity)
+        : m_buffer(buffer)
+        , m_capacity(capacity)
+    {
+        CIDER_ASSERT(buffer || capacity == 0, "");
+    }
+
+    Bool operator()(Result value)
+    {
+        if (m_count < m_capacity)
+        {
+            m_buffer[m_count++] = std::move(value);
+        }
+        return true;
+    }
+
+    ResultType GetResult()
+    {
+        return m_count;
+    }
+
+private:
+    Result* m_buffer;
+    SizeT   m_capacity;
+    SizeT   m_count = 0;
+};
+
+
+namespace Detail {
+
+
+template<typename Function>
+struct DefaultCombiner;
+
+template<typename Result, typename... Arguments>
+struct DefaultCombiner<Result(Arguments...)>
+{
+    typedef CollectCombiner<Result> Type;
+};
+
+// 戻り値 Void は合成しない
+template<typename... Arguments>
+struct DefaultCombiner<Void(Arguments...)>
+{
+    typedef Void Type;
+};
+
+
+} // namespace Detail
+
+
+} // namespace System
+} // namespace Cider
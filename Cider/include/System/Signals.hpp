@@ -5,8 +5,13 @@
 #include "System/Memory.hpp"
 #include "System/STL.hpp"
 #include "System/Assert.hpp"
+#include "System/Delegate.hpp"
+#include "System/Mailbox.hpp"
+#include "System/SignalCombiner.hpp"
+#include <atomic>
 #include <mutex>
 #include <algorithm>
+#include <tuple>
 
 
 
@@ -18,9 +23,17 @@ namespace System {
 
 
 template<typename Function>
-using Slot = std::function<Function>;
+using Slot = Delegate<Function>;
 
-template<typename Result, typename... Arguments>
+// スロットの実行順を決めるグループ (小さい順に呼ばれ、同じグループ内は接続順)
+typedef Int32 SlotGroup;
+
+constexpr SlotGroup DEFAULT_SLOT_GROUP = 0;
+
+template<
+    typename Function,
+    typename Combiner = typename Detail::DefaultCombiner<Function>::Type
+>
 class Signal;
 
 namespace Detail {
@@ -29,6 +42,13 @@ template<typename Result, typename... Arguments>
 class SignalBody;
 
 
+// 接続ごとの状態 (Connection はこれを弱参照して切断対象を特定する)
+struct SlotState final
+{
+    std::atomic<Bool> connected { true };
+};
+
+
 class ConnectionBody : public BaseAllocator<MEMORY_AREA::SYSTEM>
 {
 public:
@@ -46,8 +66,7 @@ template<typename Function>
 class ConnectionBodyOverride final : public ConnectionBody
 {
 private:
-    typedef Slot<Function> SlotType;
-    typedef STL::weak_ptr<SlotType> WeakSlot;
+    typedef STL::weak_ptr<SlotState> WeakSlot;
 
     typedef SignalBody<Function> SignalBodyType;
     typedef STL::weak_ptr<SignalBodyType> WeakSignalBody;
@@ -67,25 +86,28 @@ public:
 
     Void Disconnect() override
     {
-        if (!m_weakSlot.expired())
-        {
-            return;
-        }
-
         auto lockedSlot = m_weakSlot.lock();
+        auto lockedSignalBody = m_weakSignalBody.lock();
 
-        if (auto lockedSignalBody = m_weakSignalBody.lock())
+        if (lockedSlot && lockedSignalBody)
         {
             lockedSignalBody->Disconnect(lockedSlot.get());
-            m_weakSignalBody.reset();
         }
 
+        m_weakSignalBody.reset();
         m_weakSlot.reset();
     }
 
+    // 複製した Connection から切断された場合も無効になる
     Bool Valid() const override
     {
-        return !m_weakSlot.expired() && !m_weakSignalBody.expired();
+        if (m_weakSignalBody.expired())
+        {
+            return false;
+        }
+
+        auto lockedSlot = m_weakSlot.lock();
+        return lockedSlot && lockedSlot->connected.load(std::memory_order_relaxed);
     }
 
     STL::unique_ptr<ConnectionBody> DeepCopy() const override
@@ -99,196 +121,473 @@ private:
 };
 
 
-template<typename Result, typename... Arguments>
-class SignalBody<Result(Arguments...)> final
-    : public std::enable_shared_from_this< SignalBody<Result(Arguments...)>>
-    , public BaseAllocator<MEMORY_AREA::SYSTEM>
+// 接続中のスロット一覧
+// 発行側は公開済みのスナップショットを読むだけなので、ロックも確保もスロット単位の参照カウント操作も行わない
+// スナップショットはスロット (Delegate) を値で連続して持つため、発行は配列の線形走査になる
+// 接続は書き込みロック下でスナップショットを複製して差し替える (Copy-On-Write)
+// 切断は SlotState のフラグを落とすだけの O(1) で、切断済みが半数を超えたときにまとめて詰め直す
+// 差し替えで外れたスナップショットは、それを走査中の発行が無くなった時点で解放する (RCU)
+// エントリはグループ順に整列済みで、グループ単位の有効フラグは範囲ごとに一度だけ確認する
+template<typename Function>
+class SlotList final
 {
+public:
+    typedef Slot<Function> SlotType;
+
 private:
-    typedef Slot<Result(Arguments...)> SlotType;
-    typedef ConnectionBodyOverride<Result(Arguments...)> ConnectionBodyOverrideType;
+    struct Entry final
+    {
+        SlotType                    slot;
+        STL::shared_ptr<SlotState>  state;
+        SlotGroup                   group;
+    };
 
-    typedef std::vector<Result> ResultArray;
+    // 有効フラグはスナップショットを差し替えずに切り替える
+    struct GroupState final : public BaseAllocator<MEMORY_AREA::SYSTEM>
+    {
+        explicit GroupState(SlotGroup group)
+            : group(group)
+        {}
 
-public:
-    SignalBody() = default;
+        SlotGroup           group;
+        std::atomic<Bool>   enabled { true };
+    };
 
-    SignalBody(const SignalBody&) = delete;
-    Void operator=(const SignalBody&) = delete;
+    struct GroupRange final
+    {
+        const GroupState*   state;
+        SizeT               begin;
+        SizeT               end;
+    };
 
-    SignalBody(SignalBody&&) = delete;
-    Void operator=(SignalBody&&) = delete;
+    struct Snapshot final : public BaseAllocator<MEMORY_AREA::SYSTEM>
+    {
+        STL::vector<Entry>      entries;
+        STL::vector<GroupRange> groups;
+        std::atomic<UInt32>     readerCount { 0 };
 
-    template<typename Function>
-    STL::unique_ptr<ConnectionBodyOverrideType> Connect(Function&& slot)
+        // 切断済みのエントリを含む可能性がある (発行時にエントリごとの状態を確認する)
+        std::atomic<Bool>   stale { false };
+    };
+
+    // 走査中はスナップショットを解放させない
+    // m_loadingCount はポインタの読み込みからスナップショットの参照カウント加算までの間だけを保護する
+    class ReadScope final
     {
-        CIDER_ASSERT(slot, "");
+    public:
+        explicit ReadScope(SlotList& list)
+            : m_list(list)
+        {
+            m_list.m_loadingCount.fetch_add(1);
+
+            m_snapshot = m_list.m_snapshot.load();
+
+            if (m_snapshot)
+            {
+                m_snapshot->readerCount.fetch_add(1);
+            }
 
-        auto observer = STL::make_shared<SlotType, MEMORY_AREA::SYSTEM>(std::forward<Function>(slot));
+            m_list.m_loadingCount.fetch_sub(1);
+        }
+
+        ~ReadScope()
         {
-            std::lock_guard< std::recursive_mutex> lock(m_addingProtection);
+            if (m_snapshot &&
+                m_snapshot->readerCount.fetch_sub(1) == 1 &&
+                m_list.m_hasRetired.load(std::memory_order_relaxed))
+            {
+                m_list.TryReclaim();
+            }
+        }
 
-            CIDER_ASSERT(
-                std::end(m_addedObservers) ==
-                std::find(std::begin(m_addedObservers), std::end(m_addedObservers), observer),
-                ""
-            );
+        ReadScope(const ReadScope&) = delete;
+        Void operator=(const ReadScope&) = delete;
 
-            m_addedObservers.push_back(observer);
+        Snapshot* Get() const
+        {
+            return m_snapshot;
         }
 
-        STL::weak_ptr<SignalBody> weakSignal = this->shared_from_this();
+    private:
+        SlotList&   m_list;
+        Snapshot*   m_snapshot;
+    };
 
-        CIDER_ASSERT(!weakSignal.expired(), "");
+public:
+    SlotList() = default;
+
+    ~SlotList()
+    {
+        CIDER_ASSERT(m_loadingCount.load() == 0, "");
 
-        return STL::make_unique<ConnectionBodyOverrideType>(std::move(weakSignal), observer);
+        CIDER_DELETE m_snapshot.load();
+
+        for (auto retired : m_retired)
+        {
+            CIDER_DELETE retired;
+        }
     }
 
-    Void Disconnect(const SlotType* observer)
-    {
-        CIDER_ASSERT(observer, "");
+    SlotList(const SlotList&) = delete;
+    Void operator=(const SlotList&) = delete;
 
+    // state を省略した場合は新しく作る
+    STL::shared_ptr<SlotState> Add(SlotType&& slot, SlotGroup group, STL::shared_ptr<SlotState> state = nullptr)
+    {
+        if (!state)
         {
-            std::lock_guard<std::recursive_mutex> lock(m_addingProtection);
-
-            m_addedObservers.erase(
-                std::remove_if(
-                    std::begin(m_addedObservers),
-                    std::end(m_addedObservers),
-                    [observer](const STL::shared_ptr<SlotType>& slot) -> Bool {
-                return slot.get() == observer;
+            state = STL::make_shared<SlotState, MEMORY_AREA::SYSTEM>();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_writeLock);
+
+            auto snapshot = STL::make_unique<Snapshot>();
+
+            // 複製のついでに切断済みのものを取り除く
+            SizeT removedCount = 0;
+
+            if (const Snapshot* current = m_snapshot.load(std::memory_order_relaxed))
+            {
+                removedCount = CopyConnected(*current, *snapshot, 1);
             }
-                ),
-                std::end(m_addedObservers)
-                );
+
+            // 同じグループの末尾に挿入して整列を保つ
+            auto const position = std::upper_bound(
+                std::begin(snapshot->entries),
+                std::end(snapshot->entries),
+                group,
+                [](SlotGroup value, const Entry& entry) -> Bool {
+                    return value < entry.group;
+                }
+            );
+
+            snapshot->entries.insert(position, Entry { std::move(slot), state, group });
+
+            Publish(snapshot.release(), removedCount);
+        }
+
+        return state;
+    }
+
+    // 発行中でも呼べる。既に切断済みなら何もしない
+    Void Remove(SlotState* state)
+    {
+        CIDER_ASSERT(state, "");
+
+        if (!state->connected.exchange(false))
+        {
+            return;
         }
 
-        auto const it = std::find_if(
-            std::begin(m_observers),
-            std::end(m_observers),
-            [observer](const STL::shared_ptr<SlotType>& slot) -> Bool {
-            return slot.get() == observer;
+        // 走査中の発行が以降のエントリごとに切断を確認するようにする
+        {
+            ReadScope scope(*this);
+
+            if (Snapshot* snapshot = scope.Get())
+            {
+                snapshot->stale.store(true);
+            }
         }
-        );
 
-        if (it != std::end(m_observers))
+        const PtrDiff deadCount = m_deadCount.fetch_add(1) + 1;
+
+        if (deadCount * 2 > static_cast<PtrDiff>(m_entryCount.load(std::memory_order_relaxed)))
         {
-            it->reset();
+            Compact();
         }
     }
 
-    ResultArray operator()(Arguments&&... arguments)
+    // visitor が false を返したら打ち切る
+    template<typename Visitor>
+    Void ForEach(Visitor&& visitor)
     {
-        ResultArray resultArray;
+        ReadScope scope(*this);
 
-        if (m_nestedMethodCallCount <= 0)
-        {
-            PushBackAddedListeners();
-        }
+        const Snapshot* snapshot = scope.Get();
 
-        if (m_nestedMethodCallCount >= std::numeric_limits<std::int16_t>::max())
+        if (!snapshot)
         {
-            return resultArray;
+            return;
         }
 
-        CIDER_ASSERT(m_nestedMethodCallCount >= 0, "");
-        ++m_nestedMethodCallCount;
+        const Entry* entries = snapshot->entries.data();
 
-        try
+        for (const auto& range : snapshot->groups)
         {
-            for (auto& observer : m_observers)
+            if (!range.state->enabled.load(std::memory_order_relaxed))
             {
-                if (auto scoped = observer)
+                continue;
+            }
+
+            for (SizeT i = range.begin; i < range.end; ++i)
+            {
+                const Entry& entry = entries[i];
+
+                // 切断が無ければ状態を参照しない (連続したエントリだけを読む)
+                if (snapshot->stale.load(std::memory_order_acquire) &&
+                    !entry.state->connected.load(std::memory_order_acquire))
+                {
+                    continue;
+                }
+
+                if (!visitor(entry.slot))
                 {
-                    resultArray.push_back(
-                        scoped->operator()(std::forward<Arguments>(arguments)...)
-                    );
+                    return;
                 }
             }
         }
-        catch (const std::exception& e)
+    }
+
+    // 接続の有無にかかわらず設定でき、後から接続したスロットにも適用される
+    Void SetGroupEnabled(SlotGroup group, Bool enabled)
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+
+        FindOrAddGroup(group)->enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    Bool IsGroupEnabled(SlotGroup group) const
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+
+        for (const auto& state : m_groups)
         {
-            --m_nestedMethodCallCount;
-            throw e;
+            if (state->group == group)
+            {
+                return state->enabled.load(std::memory_order_relaxed);
+            }
         }
+        return true;
+    }
 
-        CIDER_ASSERT(m_nestedMethodCallCount > 0, "");
-        --m_nestedMethodCallCount;
+    SizeT Count() const
+    {
+        const PtrDiff count =
+            static_cast<PtrDiff>(m_entryCount.load(std::memory_order_relaxed)) -
+            m_deadCount.load(std::memory_order_relaxed);
+
+        return count > 0 ? static_cast<SizeT>(count) : 0;
+    }
 
-        if (m_nestedMethodCallCount <= 0)
+private:
+    // m_writeLock 下で呼ぶこと
+    // removedCount は current から取り除いた切断済みエントリの数
+    Void Publish(Snapshot* snapshot, SizeT removedCount)
+    {
+        BuildGroupRanges(*snapshot);
+
+        m_entryCount.store(snapshot->entries.size(), std::memory_order_relaxed);
+        m_deadCount.fetch_sub(static_cast<PtrDiff>(removedCount));
+
+        if (Snapshot* previous = m_snapshot.exchange(snapshot))
         {
-            EraseRemovedListeners();
+            m_retired.push_back(previous);
+            m_hasRetired.store(true, std::memory_order_relaxed);
         }
 
-        return resultArray;
+        // 複製後に切断されたものがあれば、公開したスナップショットにも印を付ける
+        // (Remove はフラグ→スナップショット、こちらはスナップショット→フラグの順に見るので取りこぼさない)
+        for (const auto& entry : snapshot->entries)
+        {
+            if (!entry.state->connected.load())
+            {
+                snapshot->stale.store(true);
+                break;
+            }
+        }
+
+        Reclaim();
     }
 
-    std::size_t InvocationCount() const
+    // m_writeLock 下で呼ぶこと
+    // 取り除いた切断済みエントリの数を返す
+    SizeT CopyConnected(const Snapshot& source, Snapshot& destination, SizeT extraCapacity)
     {
-        return m_observers.size();
+        destination.entries.reserve(source.entries.size() + extraCapacity);
+
+        SizeT removedCount = 0;
+
+        for (const auto& entry : source.entries)
+        {
+            if (entry.state->connected.load())
+            {
+                destination.entries.push_back(entry);
+            }
+            else
+            {
+                ++removedCount;
+            }
+        }
+
+        return removedCount;
     }
 
-private:
-    Void PushBackAddedListeners()
+    Void Compact()
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+
+        const Snapshot* current = m_snapshot.load(std::memory_order_relaxed);
+
+        if (!current)
+        {
+            return;
+        }
+
+        auto snapshot = STL::make_unique<Snapshot>();
+
+        const SizeT removedCount = CopyConnected(*current, *snapshot, 0);
+
+        // 他のスレッドが詰め直した直後
+        if (removedCount == 0)
+        {
+            return;
+        }
+
+        Publish(snapshot.release(), removedCount);
+    }
+
+    // m_writeLock 下で呼ぶこと
+    Void Reclaim()
     {
-        std::vector<STL::shared_ptr<SlotType>> temporarySlots;
+        // 外れたスナップショットを読み込み途中の発行があれば、参照カウントがまだ当てにならない
+        if (m_retired.empty() || m_loadingCount.load() != 0)
         {
-            std::lock_guard<std::recursive_mutex> lock(m_addingProtection);
-            std::swap(temporarySlots, m_addedObservers);
+            return;
         }
+
+        m_retired.erase(
+            std::remove_if(
+                std::begin(m_retired),
+                std::end(m_retired),
+                [](Snapshot* retired) -> Bool {
+                    if (retired->readerCount.load() != 0)
+                    {
+                        return false;
+                    }
+
+                    CIDER_DELETE retired;
+                    return true;
+                }
+            ),
+            std::end(m_retired)
+        );
+
+        m_hasRetired.store(!m_retired.empty(), std::memory_order_relaxed);
+    }
+
+    // m_writeLock 下で呼ぶこと
+    Void BuildGroupRanges(Snapshot& snapshot)
+    {
+        const SizeT count = snapshot.entries.size();
+
+        for (SizeT begin = 0; begin < count; )
         {
-            std::lock_guard<std::recursive_mutex> lock(m_slotsProtection);
+            const SlotGroup group = snapshot.entries[begin].group;
 
-            for (auto& slot : temporarySlots)
+            SizeT end = begin + 1;
+            while (end < count && snapshot.entries[end].group == group)
             {
-                CIDER_ASSERT(
-                    std::end(m_observers) ==
-                    std::find(std::begin(m_observers), std::end(m_observers), slot),
-                    ""
-                );
+                ++end;
+            }
 
-                m_observers.push_back(slot);
+            snapshot.groups.push_back(GroupRange { FindOrAddGroup(group), begin, end });
+            begin = end;
+        }
+    }
+
+    // m_writeLock 下で呼ぶこと
+    GroupState* FindOrAddGroup(SlotGroup group)
+    {
+        for (const auto& state : m_groups)
+        {
+            if (state->group == group)
+            {
+                return state.get();
             }
         }
+
+        m_groups.push_back(STL::make_unique<GroupState>(group));
+        return m_groups.back().get();
     }
 
-    Void EraseRemovedListeners()
+    Void TryReclaim()
     {
-        std::lock_guard<std::recursive_mutex> lock(m_slotsProtection);
+        std::unique_lock<std::mutex> lock(m_writeLock, std::try_to_lock);
 
-        m_observers.erase(
-            std::remove_if(
-                std::begin(m_observers),
-                std::end(m_observers),
-                [](const STL::shared_ptr<SlotType>& slot) -> Bool {
-            return !slot;
+        if (lock.owns_lock())
+        {
+            Reclaim();
         }
-            ),
-            std::end(m_observers)
-            );
     }
 
 private:
-    std::vector<STL::shared_ptr<SlotType>> m_observers;
-    std::vector<STL::shared_ptr<SlotType>> m_addedObservers;
+    std::atomic<Snapshot*>  m_snapshot { nullptr };
+    std::atomic<UInt32>     m_loadingCount { 0 };
+    std::atomic<Bool>       m_hasRetired { false };
+    std::atomic<SizeT>      m_entryCount { 0 };     // 現在のスナップショットのエントリ数 (切断済みを含む)
+    std::atomic<PtrDiff>    m_deadCount { 0 };      // そのうち切断済みの数 (一時的に負になり得る)
 
-    std::recursive_mutex m_addingProtection;
-    std::recursive_mutex m_slotsProtection;
+    mutable std::mutex      m_writeLock;
+    STL::vector<Snapshot*>  m_retired;
+
+    // スナップショットのグループ範囲から参照されるため、SlotList の破棄まで解放しない
+    STL::vector<STL::unique_ptr<GroupState>> m_groups;
+};
 
-    std::int32_t m_nestedMethodCallCount = 0;
 
+// 他スレッドへ配送する接続の受け取り側
+template<typename Function>
+struct QueuedSlot final
+{
+    Slot<Function>              slot;
+    STL::shared_ptr<SlotState>  state;
+    Mailbox*                    mailbox;
 };
 
 
-// 戻り値 Void 特殊化
+// Mailbox に積まれる 1 回分の呼び出し (引数は値で複製する)
+template<typename Function>
+struct QueuedInvocation;
+
 template<typename... Arguments>
-class SignalBody<Void(Arguments...)> final
-    : public std::enable_shared_from_this< SignalBody<Void(Arguments...)>>
+struct QueuedInvocation<Void(Arguments...)> final
+{
+    static_assert(
+        (std::is_copy_constructible_v<std::decay_t<Arguments>> && ...),
+        "queued connection requires copyable arguments."
+    );
+
+    Void operator()()
+    {
+        // 積まれた後に切断されたものは呼ばない
+        if (!target->state->connected.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        std::apply(
+            [this](auto&... values) {
+                target->slot(static_cast<Arguments>(values)...);
+            },
+            arguments
+        );
+    }
+
+    STL::shared_ptr<QueuedSlot<Void(Arguments...)>> target;
+    std::tuple<std::decay_t<Arguments>...>          arguments;
+};
+
+
+template<typename Result, typename... Arguments>
+class SignalBody<Result(Arguments...)> final
+    : public std::enable_shared_from_this< SignalBody<Result(Arguments...)>>
     , public BaseAllocator<MEMORY_AREA::SYSTEM>
 {
 private:
-    typedef Slot<Void(Arguments...)> SlotType;
-    typedef ConnectionBodyOverride<Void(Arguments...)> ConnectionBodyOverrideType;
+    typedef Slot<Result(Arguments...)> SlotType;
+    typedef ConnectionBodyOverride<Result(Arguments...)> ConnectionBodyOverrideType;
+
+    typedef std::vector<Result> ResultArray;
 
 public:
     SignalBody() = default;
@@ -300,157 +599,162 @@ public:
     Void operator=(SignalBody&&) = delete;
 
     template<typename Function>
-    STL::unique_ptr<ConnectionBodyOverrideType> Connect(Function&& slot)
+    STL::unique_ptr<ConnectionBodyOverrideType> Connect(Function&& slot, SlotGroup group = DEFAULT_SLOT_GROUP)
     {
         CIDER_ASSERT(slot, "");
 
-        auto observer = STL::make_shared<SlotType, MEMORY_AREA::SYSTEM>(std::forward<Function>(slot));
-        {
-            std::lock_guard< std::recursive_mutex> lock(m_addingProtection);
-
-            CIDER_ASSERT(
-                std::end(m_addedObservers) ==
-                std::find(std::begin(m_addedObservers), std::end(m_addedObservers), observer),
-                ""
-            );
-
-            m_addedObservers.push_back(observer);
-        }
+        auto state = m_slots.Add(SlotType(std::forward<Function>(slot)), group);
 
         STL::weak_ptr<SignalBody> weakSignal = this->shared_from_this();
 
         CIDER_ASSERT(!weakSignal.expired(), "");
 
-        return STL::make_unique<ConnectionBodyOverrideType>(std::move(weakSignal), observer);
+        return STL::make_unique<ConnectionBodyOverrideType>(std::move(weakSignal), state);
     }
 
-    Void Disconnect(const SlotType* observer)
+    Void Disconnect(SlotState* state)
     {
-        CIDER_ASSERT(observer, "");
+        CIDER_ASSERT(state, "");
 
-        {
-            std::lock_guard<std::recursive_mutex> lock(m_addingProtection);
-
-            m_addedObservers.erase(
-                std::remove_if(
-                    std::begin(m_addedObservers),
-                    std::end(m_addedObservers),
-                    [observer](const STL::shared_ptr<SlotType>& slot) -> Bool {
-                return slot.get() == observer;
-            }
-                ),
-                std::end(m_addedObservers)
-                );
-        }
+        m_slots.Remove(state);
+    }
 
-        auto const it = std::find_if(
-            std::begin(m_observers),
-            std::end(m_observers),
-            [observer](const STL::shared_ptr<SlotType>& slot) -> Bool {
-            return slot.get() == observer;
-        }
-        );
+    template<typename Combiner>
+    Void Combine(Combiner& combiner, Arguments&&... arguments)
+    {
+        m_slots.ForEach([&](const SlotType& slot) -> Bool {
+            return combiner(slot(std::forward<Arguments>(arguments)...));
+        });
+    }
 
-        if (it != std::end(m_observers))
-        {
-            it->reset();
-        }
+    // 結果を呼び出し側のバッファに格納する (容量が足りていれば確保しない)
+    Void Emit(ResultArray& resultArray, Arguments&&... arguments)
+    {
+        resultArray.clear();
+
+        m_slots.ForEach([&](const SlotType& slot) -> Bool {
+            resultArray.push_back(slot(std::forward<Arguments>(arguments)...));
+            return true;
+        });
     }
 
-    Void operator()(Arguments&&... arguments)
+    std::size_t InvocationCount() const
     {
-        if (m_nestedMethodCallCount <= 0)
-        {
-            PushBackAddedListeners();
-        }
+        return m_slots.Count();
+    }
 
-        if (m_nestedMethodCallCount >= std::numeric_limits<std::int16_t>::max())
-        {
-            return;
-        }
+    Void SetGroupEnabled(SlotGroup group, Bool enabled)
+    {
+        m_slots.SetGroupEnabled(group, enabled);
+    }
 
-        CIDER_ASSERT(m_nestedMethodCallCount >= 0, "");
-        ++m_nestedMethodCallCount;
+    Bool IsGroupEnabled(SlotGroup group) const
+    {
+        return m_slots.IsGroupEnabled(group);
+    }
 
-        try
-        {
-            for (auto& observer : m_observers)
-            {
-                if (auto scoped = observer)
-                {
-                    scoped->operator()(std::forward<Arguments>(arguments)...);
-                }
-            }
-        }
-        catch (const std::exception& e)
-        {
-            --m_nestedMethodCallCount;
-            throw e;
-        }
+private:
+    SlotList<Result(Arguments...)> m_slots;
+};
 
-        CIDER_ASSERT(m_nestedMethodCallCount > 0, "");
-        --m_nestedMethodCallCount;
 
-        if (m_nestedMethodCallCount <= 0)
-        {
-            EraseRemovedListeners();
-        }
-    }
+// 戻り値 Void 特殊化
+template<typename... Arguments>
+class SignalBody<Void(Arguments...)> final
+    : public std::enable_shared_from_this< SignalBody<Void(Arguments...)>>
+    , public BaseAllocator<MEMORY_AREA::SYSTEM>
+{
+private:
+    typedef Slot<Void(Arguments...)> SlotType;
+    typedef ConnectionBodyOverride<Void(Arguments...)> ConnectionBodyOverrideType;
 
-    std::size_t InvocationCount() const
+public:
+    SignalBody() = default;
+
+    SignalBody(const SignalBody&) = delete;
+    Void operator=(const SignalBody&) = delete;
+
+    SignalBody(SignalBody&&) = delete;
+    Void operator=(SignalBody&&) = delete;
+
+    template<typename Function>
+    STL::unique_ptr<ConnectionBodyOverrideType> Connect(Function&& slot, SlotGroup group = DEFAULT_SLOT_GROUP)
     {
-        return m_observers.size();
+        CIDER_ASSERT(slot, "");
+
+        auto state = m_slots.Add(SlotType(std::forward<Function>(slot)), group);
+
+        STL::weak_ptr<SignalBody> weakSignal = this->shared_from_this();
+
+        CIDER_ASSERT(!weakSignal.expired(), "");
+
+        return STL::make_unique<ConnectionBodyOverrideType>(std::move(weakSignal), state);
     }
 
-private:
-    Void PushBackAddedListeners()
+    // 発行スレッドでは引数を複製して mailbox に積むだけで、slot は mailbox を Dispatch したスレッドで呼ばれる
+    STL::unique_ptr<ConnectionBodyOverrideType> ConnectQueued(Mailbox& mailbox, SlotType&& slot, SlotGroup group)
     {
-        std::vector<STL::shared_ptr<SlotType>> temporarySlots;
-        {
-            std::lock_guard<std::recursive_mutex> lock(m_addingProtection);
-            std::swap(temporarySlots, m_addedObservers);
-        }
-        {
-            std::lock_guard<std::recursive_mutex> lock(m_slotsProtection);
+        typedef QueuedSlot<Void(Arguments...)> QueuedSlotType;
+        typedef QueuedInvocation<Void(Arguments...)> QueuedInvocationType;
 
-            for (auto& slot : temporarySlots)
-            {
-                CIDER_ASSERT(
-                    std::end(m_observers) ==
-                    std::find(std::begin(m_observers), std::end(m_observers), slot),
-                    ""
-                );
+        CIDER_ASSERT(slot, "");
 
-                m_observers.push_back(slot);
-            }
-        }
+        auto target = STL::make_shared<QueuedSlotType, MEMORY_AREA::SYSTEM>(QueuedSlotType {
+            std::move(slot),
+            STL::make_shared<SlotState, MEMORY_AREA::SYSTEM>(),
+            &mailbox
+        });
+
+        auto state = m_slots.Add(
+            SlotType([target](Arguments... arguments) {
+                target->mailbox->Post(QueuedInvocationType {
+                    target,
+                    std::tuple<std::decay_t<Arguments>...>(std::forward<Arguments>(arguments)...)
+                });
+            }),
+            group,
+            target->state
+        );
+
+        STL::weak_ptr<SignalBody> weakSignal = this->shared_from_this();
+
+        CIDER_ASSERT(!weakSignal.expired(), "");
+
+        return STL::make_unique<ConnectionBodyOverrideType>(std::move(weakSignal), state);
     }
 
-    Void EraseRemovedListeners()
+    Void Disconnect(SlotState* state)
     {
-        std::lock_guard<std::recursive_mutex> lock(m_slotsProtection);
+        CIDER_ASSERT(state, "");
 
-        m_observers.erase(
-            std::remove_if(
-                std::begin(m_observers),
-                std::end(m_observers),
-                [](const STL::shared_ptr<SlotType>& slot) -> Bool {
-            return !slot;
-        }
-            ),
-            std::end(m_observers)
-            );
+        m_slots.Remove(state);
     }
 
-private:
-    std::vector<STL::shared_ptr<SlotType>> m_observers;
-    std::vector<STL::shared_ptr<SlotType>> m_addedObservers;
+    Void operator()(Arguments&&... arguments)
+    {
+        m_slots.ForEach([&](const SlotType& slot) -> Bool {
+            slot(std::forward<Arguments>(arguments)...);
+            return true;
+        });
+    }
 
-    std::recursive_mutex m_addingProtection;
-    std::recursive_mutex m_slotsProtection;
+    std::size_t InvocationCount() const
+    {
+        return m_slots.Count();
+    }
+
+    Void SetGroupEnabled(SlotGroup group, Bool enabled)
+    {
+        m_slots.SetGroupEnabled(group, enabled);
+    }
 
-    std::int32_t m_nestedMethodCallCount = 0;
+    Bool IsGroupEnabled(SlotGroup group) const
+    {
+        return m_slots.IsGroupEnabled(group);
+    }
 
+private:
+    SlotList<Void(Arguments...)> m_slots;
 };
 
 
@@ -549,8 +853,9 @@ private:
 };
 
 
-template<typename Result, typename... Arguments>
-class Signal<Result(Arguments...)> final
+// Combiner で戻り値の合成方法を指定する (SignalCombiner.hpp)
+template<typename Result, typename... Arguments, typename Combiner>
+class Signal<Result(Arguments...), Combiner> final
 {
 private:
     typedef Detail::SignalBody<Result(Arguments...)> SignalBodyType;
@@ -558,6 +863,9 @@ private:
 public:
     typedef std::vector<Result> ResultArray;
 
+    typedef Combiner CombinerType;
+    typedef typename Combiner::ResultType CombinedResult;
+
 public:
     Signal()
         : m_body(STL::make_shared<SignalBodyType>())
@@ -583,10 +891,58 @@ public:
         return Connection { m_body->Connect(std::move(slot)) };
     }
 
-    ResultArray operator()(Arguments&&...arguments)
+    // group の小さい順に呼ばれる (物理 → 描画 のような順序付け)
+    Connection Connect(SlotGroup group, const Slot<Result(Arguments...)>& slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_body, "");
+        return Connection { m_body->Connect(slot, group) };
+    }
+
+    Connection Connect(SlotGroup group, Slot<Result(Arguments...)>&& slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_body, "");
+        return Connection { m_body->Connect(std::move(slot), group) };
+    }
+
+    // 無効にしたグループのスロットは発行時に丸ごと飛ばされる
+    Void SetGroupEnabled(SlotGroup group, Bool enabled)
+    {
+        CIDER_ASSERT(m_body, "");
+        m_body->SetGroupEnabled(group, enabled);
+    }
+
+    Bool IsGroupEnabled(SlotGroup group) const
+    {
+        CIDER_ASSERT(m_body, "");
+        return m_body->IsGroupEnabled(group);
+    }
+
+    CombinedResult operator()(Arguments&&...arguments)
+    {
+        CIDER_ASSERT(m_body, "");
+
+        Combiner combiner;
+        m_body->Combine(combiner, std::forward<Arguments>(arguments)...);
+        return combiner.GetResult();
+    }
+
+    // 既定以外の合成方法で発行する (BufferCombiner など状態を持つもの)
+    template<typename OtherCombiner>
+    typename std::decay_t<OtherCombiner>::ResultType Combine(OtherCombiner&& combiner, Arguments&&...arguments)
     {
         CIDER_ASSERT(m_body, "");
-        return m_body->operator()(std::forward<Arguments>(arguments)...);
+
+        m_body->Combine(combiner, std::forward<Arguments>(arguments)...);
+        return combiner.GetResult();
+    }
+
+    // 結果を呼び出し側のバッファに格納する (容量が足りていれば確保しない)
+    Void Emit(ResultArray& resultArray, Arguments&&...arguments)
+    {
+        CIDER_ASSERT(m_body, "");
+        m_body->Emit(resultArray, std::forward<Arguments>(arguments)...);
     }
 
     std::size_t InvocationCount() const
@@ -600,9 +956,9 @@ private:
 };
 
 
-// 戻り値 Void 特殊化
-template<typename... Arguments>
-class Signal<Void(Arguments...)> final
+// 戻り値 Void 特殊化 (Combiner は使用しない)
+template<typename... Arguments, typename Combiner>
+class Signal<Void(Arguments...), Combiner> final
 {
 private:
     typedef Detail::SignalBody<Void(Arguments...)> SignalBodyType;
@@ -632,6 +988,50 @@ public:
         return Connection { m_body->Connect(std::move(slot)) };
     }
 
+    // group の小さい順に呼ばれる (物理 → 描画 のような順序付け)
+    Connection Connect(SlotGroup group, const Slot<Void(Arguments...)>& slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_body, "");
+        return Connection { m_body->Connect(slot, group) };
+    }
+
+    Connection Connect(SlotGroup group, Slot<Void(Arguments...)>&& slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_body, "");
+        return Connection { m_body->Connect(std::move(slot), group) };
+    }
+
+    // slot を mailbox の受け取りスレッドで呼ぶ (発行は複製した引数を積むだけで待たない)
+    // mailbox は接続より長く生存させること
+    Connection Connect(Mailbox& mailbox, Slot<Void(Arguments...)> slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_body, "");
+        return Connection { m_body->ConnectQueued(mailbox, std::move(slot), DEFAULT_SLOT_GROUP) };
+    }
+
+    Connection Connect(SlotGroup group, Mailbox& mailbox, Slot<Void(Arguments...)> slot)
+    {
+        CIDER_ASSERT(slot, "");
+        CIDER_ASSERT(m_body, "");
+        return Connection { m_body->ConnectQueued(mailbox, std::move(slot), group) };
+    }
+
+    // 無効にしたグループのスロットは発行時に丸ごと飛ばされる
+    Void SetGroupEnabled(SlotGroup group, Bool enabled)
+    {
+        CIDER_ASSERT(m_body, "");
+        m_body->SetGroupEnabled(group, enabled);
+    }
+
+    Bool IsGroupEnabled(SlotGroup group) const
+    {
+        CIDER_ASSERT(m_body, "");
+        return m_body->IsGroupEnabled(group);
+    }
+
     Void operator()(Arguments&&...arguments)
     {
         CIDER_ASSERT(m_body, "");
@@ -27,16 +27,95 @@ public:
         Void Print();
     };
 
+    // シンボル解決結果 (文字列はキャッシュが保持し、Terminate まで有効)
+    struct SymbolInfo
+    {
+        const Char*     function;
+        const Char*     file;
+        const Char*     moduleName;
+        Int32           line;
+        Void*           lineAddress;
+        Void*           address;
+
+        Void Print() const;
+    };
+
+    // 重複排除されたスタックトレースのID (0 は無効)
+    typedef UInt32 StackId;
+
+    static constexpr UInt32  MAX_DEPTH = 62;
+    static constexpr StackId INVALID_STACK_ID = 0;
+
     static Void Initialize();
 
     static Void Terminate();
 
-    static UInt64 CaptureStackTraceHash();
+    // 呼び出し元から skipCount 個のフレームを飛ばし、最大 maxDepth 個のリターンアドレスを取得する
+    static UInt32 CaptureBackTrace(
+        Void** addressBuffer,
+        UInt32 skipCount,
+        UInt32 maxDepth
+    );
+
+    // リターンアドレス列の 64bit ハッシュ
+    static UInt64 HashBackTrace(
+        Void* const* addresses,
+        UInt32 count
+    );
+
+    static UInt64 CaptureStackTraceHash(
+        UInt32 skipCount = 0,
+        UInt32 maxDepth = MAX_DEPTH
+    );
+
+    // スタックトレースを取得してテーブルに登録し、そのIDを返す
+    static StackId CaptureStackTraceId(
+        UInt32 skipCount = 0,
+        UInt32 maxDepth = MAX_DEPTH
+    );
+
+    static StackId InternBackTrace(
+        Void* const* addresses,
+        UInt32 count
+    );
+
+    // 登録済みスタックトレースのアドレス列を取得する
+    static UInt32 GetBackTrace(
+        StackId stackId,
+        Void* const** outAddresses
+    );
+
+    static UInt64 GetBackTraceHash(StackId stackId);
 
     static UInt32 CaptureStackTrace(
         TraceInfo* infoBuffer,
         UInt32 bufferCount
     );
+
+    // アドレスのシンボルを解決する (アドレス単位でキャッシュされる)
+    static const SymbolInfo* Symbolize(Void* address);
+
+    // 複数のスタックトレースに含まれるアドレスをまとめて解決し、キャッシュしておく
+    static UInt32 SymbolizeStackTraces(
+        const StackId* stackIds,
+        UInt32 count
+    );
+
+    // 出力時にシンボルを解決する
+    static Void PrintBackTrace(
+        Void* const* addresses,
+        UInt32 count
+    );
+
+    static Void PrintStackTrace(StackId stackId);
+
+private:
+    // プラットフォーム依存のシンボル解決 (キャッシュを経由しない)
+    static Void ResolveTraceInfo(Void* address, TraceInfo& outInfo);
+
+    static const SymbolInfo* SymbolizeLocked(Void* address);
+
+    static Void ClearSymbolCache();
 };
 
 
@@ -44,4 +123,3 @@ public:
 
 } // namespace System
 } // namespace Cider
-
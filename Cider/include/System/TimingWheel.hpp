@@ -0,0 +1,196 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include "System/Assert.hpp"
+
+
+namespace Cider {
+namespace System {
+
+
+/*
+    階層化タイミングホイール
+    ・Node は UInt64 expireTick と Node* next を持つ (侵入型リスト)
+    ・挿入は O(1)。上位の階層から下位への移し替えは 1 要素あたり最大 LEVEL_COUNT - 1 回
+    ・2^32 tick を超える先の期限は、最上位の階層で移し替えを繰り返して待つ
+    ・スレッドセーフではない
+*/
+template<typename Node>
+class TimingWheel final
+{
+public:
+    static constexpr SizeT SLOT_BITS = 8;
+    static constexpr SizeT SLOT_COUNT = static_cast<SizeT>(1) << SLOT_BITS;
+    static constexpr SizeT LEVEL_COUNT = 4;
+
+    TimingWheel()
+    {
+        for (auto& level : m_slots)
+        {
+            for (auto& slot : level)
+            {
+                slot = nullptr;
+            }
+        }
+    }
+
+    TimingWheel(const TimingWheel&) = delete;
+    void operator=(const TimingWheel&) = delete;
+
+    // 期限が現在以前のものは次の Advance で取り出す
+    Void Insert(Node* node)
+    {
+        CIDER_ASSERT(node, "");
+
+        ++m_count;
+        Place(node);
+    }
+
+    // 現在の tick を tick まで進め、期限が来たものを expired(Node*) に渡す
+    // 取り出したものはホイールから外れているので、expired の中で破棄してよい
+    template<typename Function>
+    Void Advance(UInt64 tick, Function&& expired)
+    {
+        Expire(expired);
+
+        while (m_currentTick < tick)
+        {
+            // 空なら 1 tick ずつ進める必要は無い
+            if (m_count == 0)
+            {
+                m_currentTick = tick;
+                break;
+            }
+
+            ++m_currentTick;
+
+            Cascade();
+
+            const SizeT index = static_cast<SizeT>(m_currentTick) & SLOT_MASK;
+            m_dueList = Append(m_dueList, m_slots[0][index]);
+            m_slots[0][index] = nullptr;
+
+            Expire(expired);
+        }
+    }
+
+    // 残っているものを全て function(Node*) に渡して空にする (現在の tick はそのまま)
+    template<typename Function>
+    Void Clear(Function&& function)
+    {
+        for (auto& level : m_slots)
+        {
+            for (auto& slot : level)
+            {
+                m_dueList = Append(m_dueList, slot);
+                slot = nullptr;
+            }
+        }
+
+        Expire(function);
+    }
+
+    UInt64 GetCurrentTick() const
+    {
+        return m_currentTick;
+    }
+
+    SizeT GetCount() const
+    {
+        return m_count;
+    }
+
+private:
+    static constexpr SizeT SLOT_MASK = SLOT_COUNT - 1;
+    static constexpr UInt64 MAX_DELTA = (static_cast<UInt64>(1) << (SLOT_BITS * LEVEL_COUNT)) - 1;
+
+    Void Place(Node* node)
+    {
+        if (node->expireTick <= m_currentTick)
+        {
+            node->next = m_dueList;
+            m_dueList = node;
+            return;
+        }
+
+        const UInt64 delta = node->expireTick - m_currentTick;
+
+        // 範囲外は最上位の階層の届く所まで置き、移し替えの時に置き直す
+        const UInt64 slotTick = delta > MAX_DELTA ? m_currentTick + MAX_DELTA : node->expireTick;
+        const UInt64 slotDelta = slotTick - m_currentTick;
+
+        SizeT level = 0;
+        while (level + 1 < LEVEL_COUNT && slotDelta >= (static_cast<UInt64>(1) << (SLOT_BITS * (level + 1))))
+        {
+            ++level;
+        }
+
+        const SizeT index = static_cast<SizeT>(slotTick >> (SLOT_BITS * level)) & SLOT_MASK;
+
+        node->next = m_slots[level][index];
+        m_slots[level][index] = node;
+    }
+
+    static Node* Append(Node* list, Node* node)
+    {
+        while (node)
+        {
+            Node* next = node->next;
+            node->next = list;
+            list = node;
+            node = next;
+        }
+
+        return list;
+    }
+
+    // 下位の階層が一周したら、上位の階層の現在のスロットを置き直す
+    Void Cascade()
+    {
+        for (SizeT level = 1; level < LEVEL_COUNT; ++level)
+        {
+            const UInt64 mask = (static_cast<UInt64>(1) << (SLOT_BITS * level)) - 1;
+
+            if ((m_currentTick & mask) != 0)
+            {
+                break;
+            }
+
+            const SizeT index = static_cast<SizeT>(m_currentTick >> (SLOT_BITS * level)) & SLOT_MASK;
+            Node* node = m_slots[level][index];
+            m_slots[level][index] = nullptr;
+
+            while (node)
+            {
+                Node* next = node->next;
+                Place(node);
+                node = next;
+            }
+        }
+    }
+
+    template<typename Function>
+    Void Expire(Function& expired)
+    {
+        while (m_dueList)
+        {
+            Node* node = m_dueList;
+            m_dueList = node->next;
+            node->next = nullptr;
+
+            --m_count;
+            expired(node);
+        }
+    }
+
+private:
+    Node*   m_slots[LEVEL_COUNT][SLOT_COUNT];
+    Node*   m_dueList = nullptr;
+    UInt64  m_currentTick = 0;
+    SizeT   m_count = 0;
+};
+
+
+} // namespace System
+} // namespace Cider
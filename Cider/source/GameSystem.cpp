@@ -67,7 +67,7 @@ Void ComponentManager::DestroyComponent(const STL::shared_ptr<Component>& destro
 
 Entity::Entity()
 {
-    m_eventConnection = m_eventQueue.Connect(
+    m_eventConnection = m_eventBus.SubscribeAll(
         [this](const System::SystemEvent& eventObject) {
         for (auto& component : m_componentList)
         {
@@ -78,16 +78,18 @@ Entity::Entity()
     );
 }
 
-Void Entity::DispatchEvent()
+Void Entity::DispatchEvent(Double deltaTime)
 {
-    m_eventQueue.Emit();
+    m_eventBus.Dispatch(deltaTime);
 }
 
 Void Entity::RegisterComponent(const Char* componentName)
 {
-    m_componentList.push_back(
-        ComponentManager::Instance()->CreateComponent(componentName)
-    );
+    auto component = ComponentManager::Instance()->CreateComponent(componentName);
+
+    component->RegisterEventHandlers(m_eventBus);
+
+    m_componentList.push_back(component);
 }
 
 Void Entity::UnregisterComponent(const Char* componentName)
@@ -122,71 +124,109 @@ EntityManager* EntityManager::Instance()
 }
 
 EntityManager::EntityManager()
-    : m_nextEntityId(1)
+    : m_freeSlotIndex(INVALID_INDEX)
+    , m_dispatchMode(DISPATCH_MODE::SERIAL)
+    , m_jobSystem(nullptr)
 {}
 
-Void EntityManager::DispatchEvent()
+Void EntityManager::DispatchEvent(Double deltaTime)
 {
-    for (auto& entityPair : m_entityTable)
+    if (m_dispatchMode == DISPATCH_MODE::PARALLEL)
     {
-        CIDER_ASSERT(entityPair.second, "");
-        entityPair.second->DispatchEvent();
+        // Instance() は作業スレッドを起動するため、並列に配送する時まで解決しない
+        auto jobSystem = m_jobSystem ? m_jobSystem : System::JobSystem::Instance();
+
+        // 配送中はエンティティを生成しない約束なので、詰めた配列をそのまま分割する
+        jobSystem->ParallelFor(
+            m_entities.size(),
+            DISPATCH_GRAIN_SIZE,
+            [this, deltaTime](SizeT begin, SizeT end) {
+            for (SizeT i = begin; i < end; ++i)
+            {
+                CIDER_ASSERT(m_entities[i], "");
+                m_entities[i]->DispatchEvent(deltaTime);
+            }
+        }
+        );
+    }
+    else
+    {
+        // 配送中に生成されたエンティティで配列が伸びることがあるため、位置で参照する
+        for (SizeT i = 0; i < m_entities.size(); ++i)
+        {
+            CIDER_ASSERT(m_entities[i], "");
+            m_entities[i]->DispatchEvent(deltaTime);
+        }
     }
 
     ApplyDestroyEntityIds();
 }
 
+Void EntityManager::SetDispatchMode(DISPATCH_MODE dispatchMode, System::JobSystem* jobSystem)
+{
+    m_dispatchMode = dispatchMode;
+
+    // 借りている JobSystem は指定し直すたびに手放す (nullptr の場合は使う時に Instance() を解決する)
+    m_jobSystem = jobSystem;
+}
+
 UInt64 EntityManager::CreateEntity()
 {
-    UInt64 entityId = m_nextEntityId;
-    m_nextEntityId++;
+    UInt32 slotIndex = m_freeSlotIndex;
+
+    if (slotIndex != INVALID_INDEX)
+    {
+        m_freeSlotIndex = m_entitySlots[slotIndex].nextFreeIndex;
+    }
+    else
+    {
+        CIDER_ASSERT(m_entitySlots.size() < INVALID_INDEX, "too many entities.");
+
+        slotIndex = static_cast<UInt32>(m_entitySlots.size());
+
+        EntitySlot slot;
+        slot.generation = 1;
+        slot.entityIndex = 0;
+        m_entitySlots.push_back(slot);
+    }
 
     auto entity = STL::make_shared<Entity>();
 
-    m_entityTable.insert(
-        EntityTableType::value_type(
-            entityId,
-            entity
-        )
-    );
+    EntitySlot& slot = m_entitySlots[slotIndex];
+    slot.entityIndex = static_cast<UInt32>(m_entities.size());
+
+    m_entities.push_back(entity);
+    m_entitySlotIndices.push_back(slotIndex);
 
     entity->PostEvent(OnStart{});
 
-    return entityId;
+    return (static_cast<UInt64>(slot.generation) << 32) | slotIndex;
 }
 
 void EntityManager::DestroyEntity(UInt64 entityId)
 {
-    auto entityIt = m_entityTable.find(entityId);
-
-    if (entityIt != std::end(m_entityTable))
+    if (auto entity = FindEntity(entityId))
     {
-        CIDER_ASSERT((*entityIt).second, "");
-        (*entityIt).second->PostEvent(OnDestroy{});
+        entity->PostEvent(OnDestroy{});
 
-        m_destroyEntityIds.push_back((*entityIt).first);
+        std::lock_guard<std::mutex> lock(m_destroyLock);
+        m_destroyEntityIds.push_back(entityId);
     }
 }
 
 Void EntityManager::RegisterComponent(UInt64 entityId, const Char* componentName)
 {
-    auto entityIt = m_entityTable.find(entityId);
-
-    if (entityIt != std::end(m_entityTable))
+    if (auto entity = FindEntity(entityId))
     {
-        CIDER_ASSERT((*entityIt).second, "");
-        (*entityIt).second->RegisterComponent(componentName);
+        entity->RegisterComponent(componentName);
     }
 }
 
 Void EntityManager::UnregisterComponent(UInt64 entityId, const Char* componentName)
 {
-    auto entityIt = m_entityTable.find(entityId);
-
-    if (entityIt != std::end(m_entityTable))
+    if (auto entity = FindEntity(entityId))
     {
-        CIDER_ASSERT((*entityIt).second, "");
-        (*entityIt).second->UnregisterComponent(componentName);
+        entity->UnregisterComponent(componentName);
     }
 }
 
@@ -194,7 +234,42 @@ void EntityManager::ApplyDestroyEntityIds()
 {
     for (auto destroyEntityId : m_destroyEntityIds)
     {
-        m_entityTable.erase(destroyEntityId);
+        // 同じ ID を複数回 DestroyEntity した場合は 2 回目以降を無視する
+        if (!FindEntity(destroyEntityId))
+        {
+            continue;
+        }
+
+        m_dataComponents.RemoveEntity(destroyEntityId);
+
+        const UInt32 slotIndex = GetSlotIndex(destroyEntityId);
+        const UInt32 entityIndex = m_entitySlots[slotIndex].entityIndex;
+        const UInt32 lastIndex = static_cast<UInt32>(m_entities.size() - 1);
+
+        // 表を整えてから破棄する (コンポーネントの破棄から EntityManager が呼ばれても矛盾しない)
+        auto destroyEntity = std::move(m_entities[entityIndex]);
+
+        // 末尾のエンティティを空いた位置に移して詰める
+        if (entityIndex != lastIndex)
+        {
+            m_entities[entityIndex] = std::move(m_entities[lastIndex]);
+            m_entitySlotIndices[entityIndex] = m_entitySlotIndices[lastIndex];
+            m_entitySlots[m_entitySlotIndices[entityIndex]].entityIndex = entityIndex;
+        }
+
+        m_entities.pop_back();
+        m_entitySlotIndices.pop_back();
+
+        // 世代を進めて古い ID を無効にする (0 は無効な ID に使うため飛ばす)
+        EntitySlot& slot = m_entitySlots[slotIndex];
+
+        if (++slot.generation == 0)
+        {
+            slot.generation = 1;
+        }
+
+        slot.nextFreeIndex = m_freeSlotIndex;
+        m_freeSlotIndex = slotIndex;
     }
 
     m_destroyEntityIds.clear();
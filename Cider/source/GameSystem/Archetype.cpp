@@ -0,0 +1,335 @@
+﻿
+#include "GameSystem/Archetype.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+
+namespace Cider {
+namespace GameSystem {
+namespace Detail {
+
+
+namespace {
+
+
+std::mutex          s_dataComponentTypeLock;
+UInt32              s_dataComponentTypeCount = 0;
+DataComponentType   s_dataComponentTypes[MAX_DATA_COMPONENT_TYPES];
+
+
+} // namespace
+
+
+UInt32 RegisterDataComponentType(SizeT size, SizeT alignment)
+{
+    std::lock_guard<std::mutex> lock(s_dataComponentTypeLock);
+
+    // ビット位置がマスクに収まらないと別の型と区別できなくなるため、リリースビルドでも停止する
+    if (s_dataComponentTypeCount >= MAX_DATA_COMPONENT_TYPES)
+    {
+        System::AssertHandle("s_dataComponentTypeCount < MAX_DATA_COMPONENT_TYPES", "too many data component types.", __FILE__, __LINE__);
+        std::abort();
+    }
+
+    if (alignment > Archetype::CHUNK_ALIGNMENT)
+    {
+        System::AssertHandle("alignment <= Archetype::CHUNK_ALIGNMENT", "data component alignment is too large.", __FILE__, __LINE__);
+        std::abort();
+    }
+
+    s_dataComponentTypes[s_dataComponentTypeCount] = DataComponentType{ size, alignment };
+    return s_dataComponentTypeCount++;
+}
+
+
+DataComponentType GetDataComponentType(UInt32 typeIndex)
+{
+    std::lock_guard<std::mutex> lock(s_dataComponentTypeLock);
+
+    CIDER_ASSERT(typeIndex < s_dataComponentTypeCount, "");
+    return s_dataComponentTypes[typeIndex];
+}
+
+
+} // namespace Detail
+
+
+
+Archetype::Archetype(DataComponentMask mask)
+    : m_mask(mask)
+    , m_chunkCapacity(0)
+    , m_offsets()
+    , m_sizes()
+    , m_spareChunk(nullptr)
+{
+    CIDER_ASSERT(mask != 0, "");
+
+    Detail::DataComponentType types[Detail::MAX_DATA_COMPONENT_TYPES] = {};
+    SizeT rowSize = sizeof(UInt64);
+
+    for (UInt32 i = 0; i < Detail::MAX_DATA_COMPONENT_TYPES; ++i)
+    {
+        if (Contains(i))
+        {
+            types[i] = Detail::GetDataComponentType(i);
+            rowSize += types[i].size;
+        }
+    }
+
+    // 先頭にエンティティID、続けて型ごとの配列を置く
+    // 配列の境界の詰め物で溢れる場合は行を減らす
+    for (m_chunkCapacity = CHUNK_SIZE / rowSize; m_chunkCapacity > 0; --m_chunkCapacity)
+    {
+        SizeT offset = sizeof(UInt64) * m_chunkCapacity;
+
+        for (UInt32 i = 0; i < Detail::MAX_DATA_COMPONENT_TYPES; ++i)
+        {
+            if (Contains(i))
+            {
+                offset = (offset + types[i].alignment - 1) & ~(types[i].alignment - 1);
+
+                m_offsets[i] = static_cast<UInt32>(offset);
+                m_sizes[i] = static_cast<UInt32>(types[i].size);
+
+                offset += types[i].size * m_chunkCapacity;
+            }
+        }
+
+        if (offset <= CHUNK_SIZE)
+        {
+            break;
+        }
+    }
+
+    CIDER_ASSERT(m_chunkCapacity > 0, "data components are too large for a chunk.");
+}
+
+
+Archetype::~Archetype()
+{
+    for (auto& chunk : m_chunks)
+    {
+        System::MemoryManager::Free(System::MEMORY_AREA::SYSTEM, chunk.memory);
+    }
+
+    if (m_spareChunk)
+    {
+        System::MemoryManager::Free(System::MEMORY_AREA::SYSTEM, m_spareChunk);
+    }
+}
+
+
+Void Archetype::AddRow(UInt64 entityId, UInt32& chunkIndex, UInt32& row)
+{
+    if (m_chunks.empty() || m_chunks.back().rowCount == m_chunkCapacity)
+    {
+        m_chunks.push_back(Chunk{ AllocateChunk(), 0 });
+    }
+
+    Chunk& chunk = m_chunks.back();
+
+    chunkIndex = static_cast<UInt32>(m_chunks.size() - 1);
+    row = static_cast<UInt32>(chunk.rowCount);
+
+    reinterpret_cast<UInt64*>(chunk.memory)[row] = entityId;
+    ++chunk.rowCount;
+}
+
+
+UInt64 Archetype::RemoveRow(UInt32 chunkIndex, UInt32 row)
+{
+    CIDER_ASSERT(chunkIndex < m_chunks.size() && row < m_chunks[chunkIndex].rowCount, "");
+
+    Chunk& lastChunk = m_chunks.back();
+    const SizeT lastRow = lastChunk.rowCount - 1;
+
+    UInt64 movedEntityId = 0;
+
+    if (&m_chunks[chunkIndex] != &lastChunk || row != lastRow)
+    {
+        UInt8* destination = m_chunks[chunkIndex].memory;
+        UInt8* source = lastChunk.memory;
+
+        movedEntityId = reinterpret_cast<UInt64*>(source)[lastRow];
+        reinterpret_cast<UInt64*>(destination)[row] = movedEntityId;
+
+        for (UInt32 i = 0; i < Detail::MAX_DATA_COMPONENT_TYPES; ++i)
+        {
+            if (Contains(i))
+            {
+                std::memcpy(
+                    destination + m_offsets[i] + m_sizes[i] * row,
+                    source + m_offsets[i] + m_sizes[i] * lastRow,
+                    m_sizes[i]);
+            }
+        }
+    }
+
+    if (--lastChunk.rowCount == 0)
+    {
+        if (m_spareChunk)
+        {
+            System::MemoryManager::Free(System::MEMORY_AREA::SYSTEM, m_spareChunk);
+        }
+
+        m_spareChunk = lastChunk.memory;
+        m_chunks.pop_back();
+    }
+
+    return movedEntityId;
+}
+
+
+UInt8* Archetype::AllocateChunk()
+{
+    if (UInt8* chunk = m_spareChunk)
+    {
+        m_spareChunk = nullptr;
+        return chunk;
+    }
+
+    return static_cast<UInt8*>(System::MemoryManager::MallocDebug(
+        __FILE__, __LINE__, System::MEMORY_AREA::SYSTEM, CHUNK_SIZE, CHUNK_ALIGNMENT));
+}
+
+
+
+Void ArchetypeStorage::RemoveEntity(UInt64 entityId)
+{
+    if (EntityLocation* location = FindLocation(entityId))
+    {
+        MoveEntity(*location, 0);
+    }
+}
+
+
+ArchetypeStorage::EntityLocation* ArchetypeStorage::FindLocation(UInt64 entityId)
+{
+    const SizeT slotIndex = static_cast<UInt32>(entityId);
+
+    if (slotIndex >= m_locations.size())
+    {
+        return nullptr;
+    }
+
+    EntityLocation& location = m_locations[slotIndex];
+
+    return location.archetype && location.entityId == entityId ? &location : nullptr;
+}
+
+
+const ArchetypeStorage::EntityLocation* ArchetypeStorage::FindLocation(UInt64 entityId) const
+{
+    return const_cast<ArchetypeStorage*>(this)->FindLocation(entityId);
+}
+
+
+ArchetypeStorage::EntityLocation& ArchetypeStorage::GetLocation(UInt64 entityId)
+{
+    const SizeT slotIndex = static_cast<UInt32>(entityId);
+
+    if (slotIndex >= m_locations.size())
+    {
+        m_locations.resize(slotIndex + 1);
+    }
+
+    EntityLocation& location = m_locations[slotIndex];
+
+    // 同じスロットの古いエンティティが残っている場合は、RemoveEntity が呼ばれていない
+    CIDER_ASSERT(!location.archetype || location.entityId == entityId, "stale entity id.");
+
+    location.entityId = entityId;
+    return location;
+}
+
+
+Void ArchetypeStorage::MoveEntity(EntityLocation& location, DataComponentMask mask)
+{
+#ifdef _DEBUG
+    CIDER_ASSERT(m_iterationDepth == 0, "data components cannot be added or removed during ForEach.");
+#endif
+
+    Archetype* source = location.archetype;
+    Archetype* destination = mask != 0 ? GetOrCreateArchetype(mask) : nullptr;
+
+    UInt32 chunkIndex = 0;
+    UInt32 row = 0;
+
+    if (destination)
+    {
+        destination->AddRow(location.entityId, chunkIndex, row);
+
+        // 両方にある型だけを写す (新しく加わった型は呼び出し側で書く)
+        if (source)
+        {
+            DataComponentMask commonMask = source->GetMask() & mask;
+
+            for (UInt32 i = 0; commonMask != 0; ++i, commonMask >>= 1)
+            {
+                if (commonMask & 1)
+                {
+                    std::memcpy(
+                        destination->GetComponent(chunkIndex, row, i),
+                        source->GetComponent(location.chunkIndex, location.row, i),
+                        destination->GetComponentSize(i));
+                }
+            }
+        }
+    }
+
+    if (source)
+    {
+        // 詰めるために移されたエンティティの位置を直す
+        if (const UInt64 movedEntityId = source->RemoveRow(location.chunkIndex, location.row))
+        {
+            EntityLocation& movedLocation = m_locations[static_cast<UInt32>(movedEntityId)];
+
+            movedLocation.chunkIndex = location.chunkIndex;
+            movedLocation.row = location.row;
+        }
+    }
+
+    location.archetype = destination;
+    location.chunkIndex = chunkIndex;
+    location.row = row;
+}
+
+
+Archetype* ArchetypeStorage::GetOrCreateArchetype(DataComponentMask mask)
+{
+    auto archetypeIt = m_archetypeTable.find(mask);
+
+    if (archetypeIt != std::end(m_archetypeTable))
+    {
+        return archetypeIt->second;
+    }
+
+    m_archetypes.push_back(STL::make_unique<Archetype>(mask));
+
+    Archetype* archetype = m_archetypes.back().get();
+    m_archetypeTable.emplace(mask, archetype);
+
+    return archetype;
+}
+
+
+Void ArchetypeStorage::CollectChunks(DataComponentMask mask, STL::vector<ParallelChunk>& chunks) const
+{
+    for (auto& archetype : m_archetypes)
+    {
+        if ((archetype->GetMask() & mask) != mask)
+        {
+            continue;
+        }
+
+        for (SizeT chunkIndex = 0; chunkIndex < archetype->GetChunkCount(); ++chunkIndex)
+        {
+            chunks.push_back(ParallelChunk{ archetype.get(), chunkIndex });
+        }
+    }
+}
+
+
+} // namespace GameSystem
+} // namespace Cider
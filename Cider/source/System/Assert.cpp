@@ -19,13 +19,13 @@ Void AssertHandle(const Char* expression, const Char* message, const Char* file,
         message
     );
 
-    constexpr UInt32 TRACE_INFO_BUFFER_COUNT = 62;
+    // アドレスのみ取得し、シンボルは出力時に解決する
+    Void* backTrace[StackTrace::MAX_DEPTH];
 
-    static StackTrace::TraceInfo s_traceInfo[TRACE_INFO_BUFFER_COUNT];
-
-    UInt32 captureCount = StackTrace::CaptureStackTrace(
-        s_traceInfo,
-        TRACE_INFO_BUFFER_COUNT
+    UInt32 captureCount = StackTrace::CaptureBackTrace(
+        backTrace,
+        0,
+        StackTrace::MAX_DEPTH
     );
 
     if (captureCount > 0)
@@ -34,15 +34,15 @@ Void AssertHandle(const Char* expression, const Char* message, const Char* file,
             "========================================\n"
         );
 
-        for (UInt32 i = 0; i < captureCount; ++i)
-        {
-            s_traceInfo[i].Print();
-        }
+        StackTrace::PrintBackTrace(backTrace, captureCount);
 
         Log::Message(
             "========================================\n"
         );
     }
+
+    // 直後に停止するため、ここまでのログを出力し終えておく
+    Log::Flush();
 }
 
 
@@ -0,0 +1,600 @@
+﻿
+#include "System/JobSystem.hpp"
+#include "System/Memory.hpp"
+#include <new>
+#include <thread>
+
+
+namespace Cider {
+namespace System {
+
+
+namespace {
+
+
+// 仕事が見つからない場合に眠るまでに探す回数
+constexpr SizeT SPIN_COUNT = 64;
+
+
+} // namespace
+
+
+namespace Detail {
+
+
+// プールの要素。確保したまま使い回し、破棄はジョブシステムの破棄時のみ
+struct Job
+{
+    JobSystem::JobFunction  function;
+    JobCounter*             counter = nullptr;  // 完了時に減らす
+    Job*                    next = nullptr;     // 空きのリスト、または依存先の完了を待つリスト
+};
+
+
+} // namespace Detail
+
+
+/*
+    Chase-Lev の両端キュー (容量は固定)
+    ・Push / Pop は所有するワーカーのみ、Steal は任意のスレッドから呼べる
+    ・top と bottom の読み書きは seq_cst にして、所有者と盗む側が同じ最後の 1 つを取り合う場合を CAS で決める
+*/
+class JobSystem::WorkStealingDeque final
+{
+public:
+    typedef Job* JobPointer;
+
+    WorkStealingDeque()
+    {
+        for (auto& job : m_jobs)
+        {
+            job.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // 満杯なら false
+    Bool Push(JobPointer job)
+    {
+        const Int64 bottom = m_bottom.load(std::memory_order_relaxed);
+        const Int64 top = m_top.load(std::memory_order_acquire);
+
+        if (bottom - top >= static_cast<Int64>(DEQUE_CAPACITY))
+        {
+            return false;
+        }
+
+        m_jobs[bottom & MASK].store(job, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    JobPointer Pop()
+    {
+        const Int64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_seq_cst);
+
+        Int64 top = m_top.load(std::memory_order_seq_cst);
+
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        JobPointer job = m_jobs[bottom & MASK].load(std::memory_order_relaxed);
+
+        // 最後の 1 つは盗む側と取り合う
+        if (top == bottom)
+        {
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                job = nullptr;
+            }
+
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    JobPointer Steal()
+    {
+        Int64 top = m_top.load(std::memory_order_seq_cst);
+        const Int64 bottom = m_bottom.load(std::memory_order_seq_cst);
+
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        JobPointer job = m_jobs[top & MASK].load(std::memory_order_relaxed);
+
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+
+        return job;
+    }
+
+private:
+    static constexpr Int64 MASK = static_cast<Int64>(DEQUE_CAPACITY) - 1;
+
+    static_assert((DEQUE_CAPACITY & (DEQUE_CAPACITY - 1)) == 0, "DEQUE_CAPACITY must be a power of two.");
+
+    // 盗む側と所有者の位置は別のキャッシュラインに置く
+    alignas(64) std::atomic<Int64>  m_top { 0 };
+    alignas(64) std::atomic<Int64>  m_bottom { 0 };
+    std::atomic<JobPointer>         m_jobs[DEQUE_CAPACITY];
+};
+
+
+struct alignas(64) JobSystem::Worker : public BaseAllocator<MEMORY_AREA::SYSTEM, 64>
+{
+    WorkStealingDeque   deque;
+    std::thread         thread;
+
+    // 自分だけが使う空き (ロックを取らずに確保と解放をする)
+    Job*                freeJobs = nullptr;
+    SizeT               freeCount = 0;
+};
+
+
+namespace {
+
+
+thread_local JobSystem*         t_jobSystem = nullptr;
+thread_local Void*              t_worker = nullptr;
+
+// 盗む相手を選ぶ乱数 (xorshift)。スレッドごとに異なる値から始める
+thread_local UInt32             t_randomState = 0;
+
+
+UInt32 NextRandom()
+{
+    static std::atomic<UInt32> seed { 0 };
+
+    UInt32 random = t_randomState;
+
+    if (random == 0)
+    {
+        random = (seed.fetch_add(1, std::memory_order_relaxed) + 1) * 2654435761u;
+    }
+
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+
+    t_randomState = random;
+    return random;
+}
+
+
+} // namespace
+
+
+JobSystem* JobSystem::Instance()
+{
+    static JobSystem instance(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+    return &instance;
+}
+
+
+JobSystem::JobSystem(SizeT workerCount)
+    : m_workerCount(workerCount)
+    , m_freeJobs(nullptr)
+    , m_queuedCount(0)
+    , m_injectedCount(0)
+    , m_sleepingCount(0)
+    , m_stop(false)
+{
+    m_workers.reserve(workerCount);
+
+    for (SizeT i = 0; i < workerCount; ++i)
+    {
+        m_workers.push_back(STL::make_unique<Worker>());
+    }
+
+    // 全てのワーカーを作ってから起動する (盗む相手の一覧を変更しないため)
+    for (SizeT i = 0; i < workerCount; ++i)
+    {
+        m_workers[i]->thread = std::thread([this, i] {
+            WorkerMain(i);
+        });
+    }
+}
+
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepLock);
+        m_stop.store(true, std::memory_order_release);
+    }
+    m_wakeCondition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker->thread.join();
+    }
+
+    CIDER_ASSERT(m_queuedCount.load() == 0, "JobSystem destroyed with pending jobs.");
+
+    for (Void* chunk : m_jobChunks)
+    {
+        Job* jobs = static_cast<Job*>(chunk);
+
+        for (SizeT i = 0; i < JOB_CHUNK_SIZE; ++i)
+        {
+            jobs[i].~Job();
+        }
+
+        MemoryManager::Free(MEMORY_AREA::JOB, chunk);
+    }
+}
+
+
+Void JobSystem::Submit(JobFunction&& function, JobCounter* counter, JobCounter* dependency)
+{
+    CIDER_ASSERT(function, "");
+    CIDER_ASSERT(!dependency || dependency != counter, "a job cannot depend on its own counter.");
+
+    Job* job = AllocateJob(std::move(function), counter);
+
+    if (counter)
+    {
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (dependency)
+    {
+        std::lock_guard<std::mutex> lock(dependency->m_lock);
+
+        // 完了していなければ、最後のジョブを完了したスレッドが積む
+        if (dependency->m_count.load(std::memory_order_acquire) > 0)
+        {
+            job->next = dependency->m_waitingJobs;
+            dependency->m_waitingJobs = job;
+            return;
+        }
+    }
+
+    Push(job);
+}
+
+
+Void JobSystem::RunParallelFor(SizeT count, SizeT grainSize, const RangeFunction& function)
+{
+    CIDER_ASSERT(grainSize > 0, "");
+
+    JobCounter counter;
+
+    RunRange(function, 0, count, grainSize, counter);
+
+    Wait(counter);
+}
+
+
+Void JobSystem::RunRange(const RangeFunction& function, SizeT begin, SizeT end, SizeT grainSize, JobCounter& counter)
+{
+    // 後半を積んで残りを自分で続ける。積んだものが盗まれなければ自分で取り出す
+    while (end - begin > grainSize)
+    {
+        const SizeT middle = begin + (end - begin) / 2;
+
+        Submit([this, &function, &counter, middle, end, grainSize] {
+            RunRange(function, middle, end, grainSize, counter);
+        }, &counter);
+
+        end = middle;
+    }
+
+    function(begin, end);
+}
+
+
+Void JobSystem::Push(Job* job)
+{
+    // 見える前に数えておく (起きたワーカーが見つけられずに眠り直すだけで済む)
+    m_queuedCount.fetch_add(1, std::memory_order_seq_cst);
+
+    Worker* self = GetCurrentWorker();
+
+    if (!self || !self->deque.Push(job))
+    {
+        std::lock_guard<std::mutex> lock(m_injectedLock);
+        m_injectedJobs.push_back(job);
+        m_injectedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    if (m_sleepingCount.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepLock);
+        m_wakeCondition.notify_one();
+    }
+}
+
+
+Void JobSystem::Wait(const JobCounter& counter)
+{
+    Worker* self = GetCurrentWorker();
+
+    while (!counter.IsCompleted())
+    {
+        if (Job* job = FindJob(self))
+        {
+            Execute(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+JobSystem::Job* JobSystem::FindJob(Worker* self)
+{
+    Job* job = self ? self->deque.Pop() : nullptr;
+
+    if (!job && m_injectedCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_injectedLock);
+
+        if (!m_injectedJobs.empty())
+        {
+            job = m_injectedJobs.front();
+            m_injectedJobs.pop_front();
+            m_injectedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!job && m_workerCount > 0)
+    {
+        const SizeT start = NextRandom() % m_workerCount;
+
+        for (SizeT i = 0; i < m_workerCount && !job; ++i)
+        {
+            Worker* victim = m_workers[(start + i) % m_workerCount].get();
+
+            if (victim != self)
+            {
+                job = victim->deque.Steal();
+            }
+        }
+    }
+
+    if (job)
+    {
+        m_queuedCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+
+Void JobSystem::Execute(Job* job)
+{
+    JobCounter* counter = job->counter;
+
+    job->function();
+    FreeJob(job);
+
+    if (counter)
+    {
+        Complete(*counter);
+    }
+}
+
+
+Void JobSystem::Complete(JobCounter& counter)
+{
+    SizeT count = counter.m_count.load(std::memory_order_relaxed);
+
+    while (count > 1)
+    {
+        if (counter.m_count.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+
+    // 最後の 1 つかもしれない場合はロックを取ってから減らす
+    // 待つ側はロックを取ってから戻るため、ロックを外すまでカウンタが破棄されない
+    Job* waitingJobs = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_lock);
+
+        if (counter.m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            waitingJobs = counter.m_waitingJobs;
+            counter.m_waitingJobs = nullptr;
+        }
+    }
+
+    while (waitingJobs)
+    {
+        Job* job = waitingJobs;
+        waitingJobs = job->next;
+
+        job->next = nullptr;
+        Push(job);
+    }
+}
+
+
+JobSystem::Job* JobSystem::AllocateJob(JobFunction&& function, JobCounter* counter)
+{
+    Worker* self = GetCurrentWorker();
+    Job* job = nullptr;
+
+    if (self)
+    {
+        if (!self->freeJobs)
+        {
+            std::lock_guard<std::mutex> lock(m_poolLock);
+            self->freeJobs = TakeFreeJobs(self->freeCount);
+        }
+
+        job = self->freeJobs;
+        self->freeJobs = job->next;
+        --self->freeCount;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_poolLock);
+
+        if (!m_freeJobs)
+        {
+            AllocateJobChunk();
+        }
+
+        job = m_freeJobs;
+        m_freeJobs = job->next;
+    }
+
+    job->function = std::move(function);
+    job->counter = counter;
+    job->next = nullptr;
+
+    return job;
+}
+
+
+Void JobSystem::FreeJob(Job* job)
+{
+    // キャプチャを解放しておく
+    job->function = nullptr;
+    job->counter = nullptr;
+
+    Worker* self = GetCurrentWorker();
+
+    if (!self)
+    {
+        std::lock_guard<std::mutex> lock(m_poolLock);
+
+        job->next = m_freeJobs;
+        m_freeJobs = job;
+        return;
+    }
+
+    job->next = self->freeJobs;
+    self->freeJobs = job;
+
+    // 他のワーカーが確保したジョブばかり処理すると空きが偏るため、多すぎる分を共有の空きに戻す
+    if (++self->freeCount < JOB_BATCH_SIZE * 2)
+    {
+        return;
+    }
+
+    Job* first = self->freeJobs;
+    Job* last = first;
+
+    for (SizeT i = 1; i < JOB_BATCH_SIZE; ++i)
+    {
+        last = last->next;
+    }
+
+    self->freeJobs = last->next;
+    self->freeCount -= JOB_BATCH_SIZE;
+
+    std::lock_guard<std::mutex> lock(m_poolLock);
+
+    last->next = m_freeJobs;
+    m_freeJobs = first;
+}
+
+
+JobSystem::Job* JobSystem::TakeFreeJobs(SizeT& count)
+{
+    if (!m_freeJobs)
+    {
+        AllocateJobChunk();
+    }
+
+    Job* first = m_freeJobs;
+    Job* last = first;
+    count = 1;
+
+    while (count < JOB_BATCH_SIZE && last->next)
+    {
+        last = last->next;
+        ++count;
+    }
+
+    m_freeJobs = last->next;
+    last->next = nullptr;
+
+    return first;
+}
+
+
+Void JobSystem::AllocateJobChunk()
+{
+    constexpr SizeT alignment = alignof(Job) > MemoryManager::DEFAULT_ALIGNMENT_SIZE ? alignof(Job) : MemoryManager::DEFAULT_ALIGNMENT_SIZE;
+
+    Void* chunk = MemoryManager::MallocDebug(
+        __FILE__, __LINE__, MEMORY_AREA::JOB, sizeof(Job) * JOB_CHUNK_SIZE, alignment);
+
+    m_jobChunks.push_back(chunk);
+
+    Job* jobs = static_cast<Job*>(chunk);
+
+    for (SizeT i = 0; i < JOB_CHUNK_SIZE; ++i)
+    {
+        new(&jobs[i]) Job();
+        jobs[i].next = i + 1 < JOB_CHUNK_SIZE ? &jobs[i + 1] : m_freeJobs;
+    }
+
+    m_freeJobs = jobs;
+}
+
+
+JobSystem::Worker* JobSystem::GetCurrentWorker()
+{
+    return t_jobSystem == this ? static_cast<Worker*>(t_worker) : nullptr;
+}
+
+
+Void JobSystem::WorkerMain(SizeT index)
+{
+    Worker* self = m_workers[index].get();
+
+    t_jobSystem = this;
+    t_worker = self;
+
+    SizeT idleCount = 0;
+
+    while (!m_stop.load(std::memory_order_acquire))
+    {
+        if (Job* job = FindJob(self))
+        {
+            Execute(job);
+            idleCount = 0;
+            continue;
+        }
+
+        if (++idleCount < SPIN_COUNT)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepLock);
+
+        m_sleepingCount.fetch_add(1, std::memory_order_seq_cst);
+        m_wakeCondition.wait(lock, [this] {
+            return m_stop.load(std::memory_order_acquire) || m_queuedCount.load(std::memory_order_seq_cst) > 0;
+        });
+        m_sleepingCount.fetch_sub(1, std::memory_order_relaxed);
+
+        idleCount = 0;
+    }
+
+    t_jobSystem = nullptr;
+    t_worker = nullptr;
+}
+
+
+} // namespace System
+} // namespace Cider
@@ -0,0 +1,710 @@
+﻿
+#include "System/Log.hpp"
+#include "System/LogSink.hpp"
+#include "System/Assert.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+
+namespace Cider {
+namespace System {
+
+
+namespace {
+
+constexpr SizeT RING_CAPACITY = 2048;       // 2 の累乗
+constexpr SizeT RING_MASK = RING_CAPACITY - 1;
+constexpr SizeT MAX_SINK_COUNT = 8;
+constexpr SizeT FORMAT_BUFFER_SIZE = Detail::LogRecord::TEXT_CAPACITY;
+
+static_assert((RING_CAPACITY & RING_MASK) == 0, "RING_CAPACITY must be a power of two.");
+
+
+// sequence == 位置     : 書き込み可能
+// sequence == 位置 + 1 : 読み込み可能
+struct alignas(64) LogCell
+{
+    std::atomic<SizeT>  sequence;
+    Detail::LogRecord   record;
+};
+
+
+struct LogContext
+{
+    // 書き込み側と読み込み側の位置は別のキャッシュラインに置く
+    alignas(64) std::atomic<SizeT>  enqueuePosition;
+    alignas(64) std::atomic<SizeT>  dequeuePosition;
+    LogCell                         cells[RING_CAPACITY];
+
+    std::mutex                      sinkLock;
+    LogSink*                        sinks[MAX_SINK_COUNT];
+    SizeT                           sinkCount;
+    Char                            formatBuffer[FORMAT_BUFFER_SIZE];
+    Char                            outputBuffer[FORMAT_BUFFER_SIZE + 64];
+
+    std::mutex                      wakeLock;
+    std::condition_variable         wakeCondition;
+    std::atomic<Bool>               sleeping;
+    Bool                            stopRequested;
+
+    std::mutex                      flushLock;
+    std::condition_variable         flushCondition;
+    std::atomic<SizeT>              flushRequest;
+    std::atomic<SizeT>              flushedPosition;
+
+    std::thread                     thread;
+    DebuggerLogSink                 debuggerSink;
+    UInt64                          reportedDroppedCount;
+
+    LogContext()
+        : enqueuePosition(0)
+        , dequeuePosition(0)
+        , sinkCount(0)
+        , sleeping(false)
+        , stopRequested(false)
+        , flushRequest(0)
+        , flushedPosition(0)
+        , reportedDroppedCount(0)
+    {
+        for (SizeT i = 0; i < RING_CAPACITY; ++i)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // 従来どおりデバッガへは常に出力する
+        sinks[sinkCount++] = &debuggerSink;
+    }
+};
+
+
+std::atomic<Bool> g_Running{ false };
+
+std::atomic<Int32>  g_OverflowPolicy{ static_cast<Int32>(Log::OverflowPolicy::Drop) };
+std::atomic<UInt64> g_DroppedCount{ 0 };
+
+// 登録済みカテゴリの単方向リスト (追加のみ)
+std::atomic<LogCategory*> g_FirstCategory{ nullptr };
+
+// バイナリログの書式 (ID - 1 で参照する)
+LogBinary::FormatInfo   g_BinaryFormats[LogBinary::MAX_FORMAT_COUNT];
+std::atomic<Bool>       g_BinaryFormatReady[LogBinary::MAX_FORMAT_COUNT];
+std::atomic<UInt32>     g_BinaryFormatCount{ 0 };
+
+
+// 静的初期化の順序に依存しないよう、初回使用時に構築する
+LogContext& GetContext()
+{
+    static LogContext s_context;
+    return s_context;
+}
+
+
+// sinkLock を取得した状態で呼ぶこと
+Void WriteBinaryRecord(LogContext& context, const Detail::LogRecord& record)
+{
+    LogBinaryEntry entry;
+    entry.formatId = record.formatId;
+    entry.timestamp = record.timestamp;
+    entry.payload = record.payload;
+    entry.payloadSize = record.payloadSize;
+
+    for (SizeT i = 0; i < context.sinkCount; ++i)
+    {
+        context.sinks[i]->WriteBinary(entry);
+    }
+}
+
+
+// sinkLock を取得した状態で呼ぶこと
+Void WriteRecord(LogContext& context, const Detail::LogRecord& record)
+{
+    if (record.formatId != LogBinary::INVALID_FORMAT_ID)
+    {
+        WriteBinaryRecord(context, record);
+        return;
+    }
+
+    SizeT length = record.formatFunction(
+        context.formatBuffer,
+        FORMAT_BUFFER_SIZE,
+        record.format,
+        record.payload
+    );
+
+    LogEntry entry;
+    entry.hasLevel = (record.level >= 0 && record.level < Log::Num);
+    entry.level = entry.hasLevel ? static_cast<Log::Level>(record.level) : Log::Verbose;
+    entry.timestamp = record.timestamp;
+    entry.category = (record.category != nullptr) ? record.category->GetName() : nullptr;
+    entry.text = context.formatBuffer;
+    entry.length = length;
+
+    if (entry.hasLevel)
+    {
+        const Int32 outputLength = std::snprintf(
+            context.outputBuffer,
+            sizeof(context.outputBuffer),
+            "【%s】\n%s\n",
+            Log::GetLevelName(entry.level),
+            context.formatBuffer
+        );
+
+        length = (outputLength < 0) ? 0 : static_cast<SizeT>(outputLength);
+
+        entry.text = context.outputBuffer;
+        entry.length = (length < sizeof(context.outputBuffer)) ? length : sizeof(context.outputBuffer) - 1;
+    }
+
+    for (SizeT i = 0; i < context.sinkCount; ++i)
+    {
+        context.sinks[i]->Write(entry);
+    }
+}
+
+
+// 破棄されたログがあれば、その件数を出力する
+Void ReportDroppedCount(LogContext& context)
+{
+    const UInt64 droppedCount = g_DroppedCount.load(std::memory_order_relaxed);
+    if (droppedCount == context.reportedDroppedCount) { return; }
+
+    std::lock_guard<std::mutex> lock(context.sinkLock);
+
+    LogEntry entry;
+    entry.level = Log::Warning;
+    entry.hasLevel = true;
+    entry.timestamp = Log::GetTimestamp();
+    entry.category = nullptr;
+    entry.text = context.outputBuffer;
+
+    const Int32 length = std::snprintf(
+        context.outputBuffer,
+        sizeof(context.outputBuffer),
+        "【%s】\n%llu 件のログを破棄しました\n",
+        Log::GetLevelName(Log::Warning),
+        static_cast<unsigned long long>(droppedCount - context.reportedDroppedCount)
+    );
+
+    entry.length = (length < 0) ? 0 : static_cast<SizeT>(length);
+
+    for (SizeT i = 0; i < context.sinkCount; ++i)
+    {
+        context.sinks[i]->Write(entry);
+    }
+
+    context.reportedDroppedCount = droppedCount;
+}
+
+
+Void IdleSinks(LogContext& context)
+{
+    std::lock_guard<std::mutex> lock(context.sinkLock);
+
+    for (SizeT i = 0; i < context.sinkCount; ++i)
+    {
+        context.sinks[i]->Idle();
+    }
+}
+
+
+Void FlushSinks(LogContext& context)
+{
+    for (SizeT i = 0; i < context.sinkCount; ++i)
+    {
+        context.sinks[i]->Flush();
+    }
+}
+
+
+Bool HasRecord(LogContext& context)
+{
+    const SizeT position = context.dequeuePosition.load(std::memory_order_relaxed);
+
+    return context.cells[position & RING_MASK].sequence.load(std::memory_order_acquire) == position + 1;
+}
+
+
+// 読み込み側は 1 スレッドのみ (出力スレッド、または停止後の Terminate)
+Void DrainRecords(LogContext& context)
+{
+    if (!HasRecord(context)) { return; }
+
+    std::lock_guard<std::mutex> lock(context.sinkLock);
+
+    for (;;)
+    {
+        const SizeT position = context.dequeuePosition.load(std::memory_order_relaxed);
+        LogCell& cell = context.cells[position & RING_MASK];
+
+        if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+        {
+            break;
+        }
+
+        WriteRecord(context, cell.record);
+
+        cell.sequence.store(position + RING_CAPACITY, std::memory_order_release);
+        context.dequeuePosition.store(position + 1, std::memory_order_release);
+    }
+}
+
+
+Void CompleteFlush(LogContext& context)
+{
+    const SizeT request = context.flushRequest.load(std::memory_order_acquire);
+    const SizeT position = context.dequeuePosition.load(std::memory_order_relaxed);
+
+    if (request <= context.flushedPosition.load(std::memory_order_relaxed)) { return; }
+
+    // 要求時点までのログを出力し終えていない
+    if (position < request) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(context.sinkLock);
+        FlushSinks(context);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(context.flushLock);
+        context.flushedPosition.store(position, std::memory_order_release);
+    }
+
+    context.flushCondition.notify_all();
+}
+
+
+Void WakeConsumer(LogContext& context)
+{
+    std::lock_guard<std::mutex> lock(context.wakeLock);
+    context.wakeCondition.notify_one();
+}
+
+
+Void ConsumerThread()
+{
+    LogContext& context = GetContext();
+
+    for (;;)
+    {
+        DrainRecords(context);
+        ReportDroppedCount(context);
+        CompleteFlush(context);
+        IdleSinks(context);
+
+        std::unique_lock<std::mutex> lock(context.wakeLock);
+
+        if (context.stopRequested)
+        {
+            break;
+        }
+
+        context.sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // 起床通知の取りこぼしに備え、一定時間ごとにも確認する
+        context.wakeCondition.wait_for(
+            lock,
+            std::chrono::milliseconds(10),
+            [&context]()
+            {
+                return context.stopRequested
+                    || HasRecord(context)
+                    || context.flushRequest.load() > context.flushedPosition.load();
+            }
+        );
+
+        context.sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    DrainRecords(context);
+    ReportDroppedCount(context);
+    CompleteFlush(context);
+}
+
+} // namespace /* unnamed */
+
+
+Void Log::Initialize()
+{
+    LogContext& context = GetContext();
+
+    if (g_Running.load(std::memory_order_acquire)) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(context.wakeLock);
+        context.stopRequested = false;
+    }
+
+    g_Running.store(true, std::memory_order_release);
+
+    context.thread = std::thread(&ConsumerThread);
+}
+
+
+Void Log::Terminate()
+{
+    LogContext& context = GetContext();
+
+    if (!g_Running.exchange(false)) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(context.wakeLock);
+        context.stopRequested = true;
+        context.wakeCondition.notify_one();
+    }
+
+    context.thread.join();
+
+    // 停止直前に確保された要素が書き込まれるのを待って出力する
+    while (context.dequeuePosition.load() != context.enqueuePosition.load())
+    {
+        DrainRecords(context);
+        std::this_thread::yield();
+    }
+
+    ReportDroppedCount(context);
+
+    {
+        std::lock_guard<std::mutex> lock(context.sinkLock);
+        FlushSinks(context);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(context.flushLock);
+        context.flushedPosition.store(context.dequeuePosition.load());
+    }
+
+    context.flushCondition.notify_all();
+}
+
+
+Void Log::Flush()
+{
+    LogContext& context = GetContext();
+
+    if (!g_Running.load(std::memory_order_acquire)
+        || std::this_thread::get_id() == context.thread.get_id())
+    {
+        std::lock_guard<std::mutex> lock(context.sinkLock);
+        FlushSinks(context);
+        return;
+    }
+
+    const SizeT target = context.enqueuePosition.load(std::memory_order_acquire);
+
+    SizeT request = context.flushRequest.load();
+    while (request < target && !context.flushRequest.compare_exchange_weak(request, target))
+    {
+    }
+
+    WakeConsumer(context);
+
+    std::unique_lock<std::mutex> lock(context.flushLock);
+
+    context.flushCondition.wait(
+        lock,
+        [&context, target]()
+        {
+            return context.flushedPosition.load() >= target
+                || !g_Running.load();
+        }
+    );
+}
+
+
+Void Log::SetOverflowPolicy(OverflowPolicy policy)
+{
+    g_OverflowPolicy.store(static_cast<Int32>(policy), std::memory_order_relaxed);
+}
+
+
+Log::OverflowPolicy Log::GetOverflowPolicy()
+{
+    return static_cast<OverflowPolicy>(g_OverflowPolicy.load(std::memory_order_relaxed));
+}
+
+
+UInt64 Log::GetDroppedCount()
+{
+    return g_DroppedCount.load(std::memory_order_relaxed);
+}
+
+
+Bool Log::AddSink(LogSink* sink)
+{
+    CIDER_ASSERT(sink != nullptr, "シンクが null です。");
+
+    LogContext& context = GetContext();
+    std::lock_guard<std::mutex> lock(context.sinkLock);
+
+    for (SizeT i = 0; i < context.sinkCount; ++i)
+    {
+        if (context.sinks[i] == sink) { return true; }
+    }
+
+    if (context.sinkCount >= MAX_SINK_COUNT) { return false; }
+
+    context.sinks[context.sinkCount++] = sink;
+    return true;
+}
+
+
+Void Log::RemoveSink(LogSink* sink)
+{
+    LogContext& context = GetContext();
+    std::lock_guard<std::mutex> lock(context.sinkLock);
+
+    for (SizeT i = 0; i < context.sinkCount; ++i)
+    {
+        if (context.sinks[i] != sink) { continue; }
+
+        for (SizeT j = i + 1; j < context.sinkCount; ++j)
+        {
+            context.sinks[j - 1] = context.sinks[j];
+        }
+
+        --context.sinkCount;
+        return;
+    }
+}
+
+
+const Char* Log::GetLevelName(Level level)
+{
+    static const Char* const s_levelNames[Num] = {
+        "Verbose",
+        "Debug",
+        "Info",
+        "Warning",
+        "Error",
+        "Assert",
+    };
+
+    return (level >= 0 && level < Num) ? s_levelNames[level] : "";
+}
+
+
+Bool Log::SetCategoryLevel(const Char* categoryName, Level level)
+{
+    Bool found = false;
+
+    for (LogCategory* category = LogCategory::GetFirst(); category != nullptr; category = category->GetNext())
+    {
+        if (categoryName == nullptr || std::strcmp(category->GetName(), categoryName) == 0)
+        {
+            category->SetLevel(level);
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+
+Void Log::Message(Level level, const Char* message)
+{
+    Format(level, "%s", message);
+}
+
+
+Void Log::Message(const Char* message)
+{
+    Format("%s", message);
+}
+
+
+Void Log::Post(const Detail::LogRecord& record)
+{
+    LogContext& context = GetContext();
+
+    if (g_Running.load(std::memory_order_acquire))
+    {
+        SizeT position = context.enqueuePosition.load(std::memory_order_relaxed);
+        LogCell* cell = nullptr;
+
+        for (;;)
+        {
+            cell = &context.cells[position & RING_MASK];
+
+            const SizeT sequence = cell->sequence.load(std::memory_order_acquire);
+            const PtrDiff difference = static_cast<PtrDiff>(sequence - position);
+
+            if (difference == 0)
+            {
+                if (context.enqueuePosition.compare_exchange_weak(
+                        position,
+                        position + 1,
+                        std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // 満杯。停止していれば直接出力し、そうでなければ空くまで待つ
+                if (!g_Running.load(std::memory_order_acquire))
+                {
+                    cell = nullptr;
+                    break;
+                }
+
+                // 呼び出し元を待たせず破棄する
+                // レベル表記なし (Log::Message などのレポート出力) は破棄しない
+                if (record.level >= 0
+                    && record.level < Log::Error
+                    && g_OverflowPolicy.load(std::memory_order_relaxed) == static_cast<Int32>(OverflowPolicy::Drop))
+                {
+                    g_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                WakeConsumer(context);
+                std::this_thread::yield();
+                position = context.enqueuePosition.load(std::memory_order_relaxed);
+            }
+            else
+            {
+                position = context.enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (cell != nullptr)
+        {
+            // 使用している部分のみ複製する
+            std::memcpy(
+                &cell->record,
+                &record,
+                offsetof(Detail::LogRecord, payload) + record.payloadSize
+            );
+
+            cell->sequence.store(position + 1, std::memory_order_release);
+
+            // 起床通知は 1 スレッドのみが行う
+            // (取りこぼした場合も出力スレッドは一定時間で起床する)
+            if (context.sleeping.load(std::memory_order_relaxed)
+                && context.sleeping.exchange(false, std::memory_order_relaxed))
+            {
+                context.wakeCondition.notify_one();
+            }
+
+            return;
+        }
+    }
+
+    // パイプライン停止中は呼び出し元スレッドで出力する
+    std::lock_guard<std::mutex> lock(context.sinkLock);
+    WriteRecord(context, record);
+}
+
+
+LogCategory::LogCategory(const Char* name, Log::Level level)
+    : m_name(name)
+    , m_level(static_cast<Int32>(level))
+    , m_next(g_FirstCategory.load(std::memory_order_relaxed))
+{
+    while (!g_FirstCategory.compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+
+LogCategory& LogCategory::Default()
+{
+    static LogCategory s_default("Default", Log::Verbose);
+    return s_default;
+}
+
+
+LogCategory* LogCategory::Find(const Char* name)
+{
+    for (LogCategory* category = GetFirst(); category != nullptr; category = category->m_next)
+    {
+        if (std::strcmp(category->m_name, name) == 0) { return category; }
+    }
+
+    return nullptr;
+}
+
+
+LogCategory* LogCategory::GetFirst()
+{
+    // 既定のカテゴリは常に登録しておく
+    Default();
+
+    return g_FirstCategory.load(std::memory_order_acquire);
+}
+
+
+UInt32 Log::RegisterBinaryFormat(
+    Level level,
+    const Char* format,
+    const Char* file,
+    Int32 line,
+    const Char* signature
+)
+{
+    const UInt32 index = g_BinaryFormatCount.fetch_add(1);
+
+    if (index >= LogBinary::MAX_FORMAT_COUNT)
+    {
+        CIDER_ASSERT(false, "バイナリログの書式が多すぎます。");
+        return LogBinary::INVALID_FORMAT_ID;
+    }
+
+    LogBinary::FormatInfo& info = g_BinaryFormats[index];
+    info.format = format;
+    info.file = file;
+    info.signature = signature;
+    info.line = line;
+    info.level = static_cast<Int32>(level);
+
+    g_BinaryFormatReady[index].store(true, std::memory_order_release);
+
+    return index + 1;
+}
+
+
+const LogBinary::FormatInfo* Log::GetBinaryFormat(UInt32 formatId)
+{
+    if (formatId == LogBinary::INVALID_FORMAT_ID || formatId > LogBinary::MAX_FORMAT_COUNT)
+    {
+        return nullptr;
+    }
+
+    const UInt32 index = formatId - 1;
+
+    if (!g_BinaryFormatReady[index].load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+
+    return &g_BinaryFormats[index];
+}
+
+
+UInt64 Log::GetBinaryTimestamp()
+{
+    return static_cast<UInt64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count()
+    );
+}
+
+
+UInt64 Log::GetTimestamp()
+{
+    return static_cast<UInt64>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count()
+    );
+}
+
+
+} // namespace System
+} // namespace Cider
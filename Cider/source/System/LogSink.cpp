@@ -0,0 +1,458 @@
+﻿
+#include "System/LogSink.hpp"
+#include "System/Assert.hpp"
+#include <algorithm>
+
+
+namespace Cider {
+namespace System {
+
+
+Void ConsoleLogSink::Write(const LogEntry& entry)
+{
+    std::fwrite(entry.text, 1, entry.length, stdout);
+}
+
+
+Void ConsoleLogSink::Flush()
+{
+    std::fflush(stdout);
+}
+
+
+FileLogSink::FileLogSink()
+    : m_file(nullptr)
+{
+
+}
+
+FileLogSink::~FileLogSink()
+{
+    Close();
+}
+
+Bool FileLogSink::Open(const Char* path, Bool append)
+{
+    Close();
+
+    if (fopen_s(&m_file, path, append ? "ab" : "wb") != 0)
+    {
+        m_file = nullptr;
+    }
+
+    return m_file != nullptr;
+}
+
+Void FileLogSink::Close()
+{
+    if (m_file == nullptr) { return; }
+
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+Void FileLogSink::Write(const LogEntry& entry)
+{
+    if (m_file == nullptr) { return; }
+
+    std::fwrite(entry.text, 1, entry.length, m_file);
+}
+
+Void FileLogSink::Flush()
+{
+    if (m_file == nullptr) { return; }
+
+    std::fflush(m_file);
+}
+
+
+RotatingFileLogSink::RotatingFileLogSink()
+    : m_file(nullptr)
+    , m_bufferUsed(0)
+    , m_fileSize(0)
+    , m_fileOpenTime(0)
+    , m_lastWriteTime(0)
+    , m_writtenBytes(0)
+    , m_rotationCount(0)
+{
+
+}
+
+RotatingFileLogSink::~RotatingFileLogSink()
+{
+    Close();
+}
+
+Bool RotatingFileLogSink::Open(const Settings& settings)
+{
+    Close();
+
+    CIDER_ASSERT(settings.path != nullptr, "ファイル名が指定されていません。");
+
+    m_settings = settings;
+    m_path = settings.path;
+    m_settings.path = m_path.c_str();
+    m_buffer.resize(std::max<SizeT>(settings.bufferSize, 1));
+    m_bufferUsed = 0;
+
+    // 前回のログは残しておく
+    std::FILE* existing = nullptr;
+    if (fopen_s(&existing, m_path.c_str(), "rb") == 0 && existing != nullptr)
+    {
+        std::fclose(existing);
+        Rotate();
+        return m_file != nullptr;
+    }
+
+    return OpenFile();
+}
+
+Void RotatingFileLogSink::Close()
+{
+    if (m_file == nullptr) { return; }
+
+    WriteBuffer();
+
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+Void RotatingFileLogSink::Write(const LogEntry& entry)
+{
+    if (m_file == nullptr) { return; }
+
+    const UInt64 pendingSize = m_fileSize + m_bufferUsed;
+
+    // 空のファイルはローテーションしない
+    if (pendingSize > 0)
+    {
+        const Bool sizeExceeded = m_settings.maxFileSize > 0
+            && pendingSize + entry.length > m_settings.maxFileSize;
+
+        const Bool timeExceeded = m_settings.rotationIntervalSeconds > 0
+            && entry.timestamp >= m_fileOpenTime + m_settings.rotationIntervalSeconds * 1000000ull;
+
+        if (sizeExceeded || timeExceeded)
+        {
+            Rotate();
+            if (m_file == nullptr) { return; }
+        }
+    }
+
+    if (m_bufferUsed + entry.length > m_buffer.size())
+    {
+        WriteBuffer();
+    }
+
+    // バッファより大きいものは直接書き込む
+    if (entry.length > m_buffer.size())
+    {
+        std::fwrite(entry.text, 1, entry.length, m_file);
+        m_fileSize += entry.length;
+        AddWrittenBytes(entry.length);
+        return;
+    }
+
+    std::memcpy(&m_buffer[m_bufferUsed], entry.text, entry.length);
+    m_bufferUsed += entry.length;
+}
+
+Void RotatingFileLogSink::Flush()
+{
+    if (m_file == nullptr) { return; }
+
+    WriteBuffer();
+    std::fflush(m_file);
+}
+
+Void RotatingFileLogSink::Idle()
+{
+    if (m_file == nullptr || m_bufferUsed == 0) { return; }
+
+    const UInt64 now = Log::GetTimestamp();
+
+    if (now >= m_lastWriteTime + m_settings.flushIntervalMilliseconds * 1000ull)
+    {
+        WriteBuffer();
+    }
+}
+
+Bool RotatingFileLogSink::OpenFile()
+{
+    if (fopen_s(&m_file, m_path.c_str(), "wb") != 0)
+    {
+        m_file = nullptr;
+        return false;
+    }
+
+    // バッファリングはこちらで行う
+    std::setvbuf(m_file, nullptr, _IONBF, 0);
+
+    m_fileSize = 0;
+    m_fileOpenTime = Log::GetTimestamp();
+    m_lastWriteTime = m_fileOpenTime;
+
+    return true;
+}
+
+Void RotatingFileLogSink::WriteBuffer()
+{
+    m_lastWriteTime = Log::GetTimestamp();
+
+    if (m_bufferUsed == 0) { return; }
+
+    std::fwrite(m_buffer.data(), 1, m_bufferUsed, m_file);
+
+    m_fileSize += m_bufferUsed;
+    AddWrittenBytes(m_bufferUsed);
+    m_bufferUsed = 0;
+}
+
+Void RotatingFileLogSink::Rotate()
+{
+    if (m_file != nullptr)
+    {
+        WriteBuffer();
+
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+
+    if (m_settings.maxBackupCount == 0)
+    {
+        std::remove(m_path.c_str());
+    }
+    else
+    {
+        std::remove(GetBackupPath(m_settings.maxBackupCount).c_str());
+
+        for (UInt32 i = m_settings.maxBackupCount - 1; i > 0; --i)
+        {
+            std::rename(GetBackupPath(i).c_str(), GetBackupPath(i + 1).c_str());
+        }
+
+        std::rename(m_path.c_str(), GetBackupPath(1).c_str());
+    }
+
+    m_rotationCount.store(m_rotationCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    OpenFile();
+}
+
+STL::string RotatingFileLogSink::GetBackupPath(UInt32 index) const
+{
+    // "Log/Cider.log" => "Log/Cider.1.log"
+    const SizeT separator = m_path.find_last_of("/\\");
+    SizeT extension = m_path.find_last_of('.');
+
+    if (extension == STL::string::npos
+        || (separator != STL::string::npos && extension < separator))
+    {
+        extension = m_path.size();
+    }
+
+    Char number[16];
+    std::snprintf(number, sizeof(number), ".%u", index);
+
+    STL::string backupPath = m_path.substr(0, extension);
+    backupPath += number;
+    backupPath += m_path.substr(extension);
+
+    return backupPath;
+}
+
+
+BinaryFileLogSink::BinaryFileLogSink()
+    : m_file(nullptr)
+{
+
+}
+
+BinaryFileLogSink::~BinaryFileLogSink()
+{
+    Close();
+}
+
+Bool BinaryFileLogSink::Open(const Char* path)
+{
+    Close();
+
+    if (fopen_s(&m_file, path, "wb") != 0)
+    {
+        m_file = nullptr;
+        return false;
+    }
+
+    LogBinary::FileHeader header = {};
+    std::memcpy(header.magic, LogBinary::MAGIC, sizeof(header.magic));
+    header.version = LogBinary::VERSION;
+    header.baseSystemTime = Log::GetTimestamp();
+    header.baseTimestamp = Log::GetBinaryTimestamp();
+
+    WriteValue(header);
+
+    // 書式はファイルごとに書き込み直す
+    m_writtenFormats.assign(LogBinary::MAX_FORMAT_COUNT + 1, false);
+
+    return true;
+}
+
+Void BinaryFileLogSink::Close()
+{
+    if (m_file == nullptr) { return; }
+
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+Void BinaryFileLogSink::Write(const LogEntry& entry)
+{
+    if (m_file == nullptr) { return; }
+
+    const UInt32 length = static_cast<UInt32>(entry.length);
+
+    WriteValue(static_cast<UInt8>(LogBinary::FRAME_TEXT));
+    WriteValue(entry.hasLevel ? static_cast<UInt8>(entry.level) : LogBinary::NO_LEVEL);
+    WriteValue(entry.timestamp);
+    WriteValue(length);
+    std::fwrite(entry.text, 1, length, m_file);
+}
+
+Void BinaryFileLogSink::WriteBinary(const LogBinaryEntry& entry)
+{
+    if (m_file == nullptr) { return; }
+
+    if (!WriteFormat(entry.formatId)) { return; }
+
+    WriteValue(static_cast<UInt8>(LogBinary::FRAME_EVENT));
+    WriteValue(entry.formatId);
+    WriteValue(entry.timestamp);
+    WriteValue(static_cast<UInt16>(entry.payloadSize));
+    std::fwrite(entry.payload, 1, entry.payloadSize, m_file);
+}
+
+Void BinaryFileLogSink::Flush()
+{
+    if (m_file == nullptr) { return; }
+
+    std::fflush(m_file);
+}
+
+Bool BinaryFileLogSink::WriteFormat(UInt32 formatId)
+{
+    if (m_writtenFormats[formatId]) { return true; }
+
+    const LogBinary::FormatInfo* info = Log::GetBinaryFormat(formatId);
+    if (info == nullptr) { return false; }
+
+    const UInt16 fileLength = static_cast<UInt16>(std::strlen(info->file));
+    const UInt16 formatLength = static_cast<UInt16>(std::strlen(info->format));
+    const UInt8 signatureLength = static_cast<UInt8>(std::strlen(info->signature));
+
+    WriteValue(static_cast<UInt8>(LogBinary::FRAME_FORMAT));
+    WriteValue(formatId);
+    WriteValue(static_cast<UInt8>(info->level));
+    WriteValue(info->line);
+    WriteValue(fileLength);
+    std::fwrite(info->file, 1, fileLength, m_file);
+    WriteValue(formatLength);
+    std::fwrite(info->format, 1, formatLength, m_file);
+    WriteValue(signatureLength);
+    std::fwrite(info->signature, 1, signatureLength, m_file);
+
+    m_writtenFormats[formatId] = true;
+    return true;
+}
+
+
+MemoryLogSink::MemoryLogSink(SizeT capacity)
+    : m_buffer(capacity)
+    , m_head(0)
+    , m_size(0)
+    , m_writtenBytes(0)
+{
+
+}
+
+Void MemoryLogSink::Write(const LogEntry& entry)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const SizeT capacity = m_buffer.size();
+    if (capacity == 0) { return; }
+
+    m_writtenBytes += entry.length;
+
+    // 容量を超える分は先頭を捨てる
+    const Char* text = entry.text;
+    SizeT length = entry.length;
+
+    if (length > capacity)
+    {
+        text += length - capacity;
+        length = capacity;
+    }
+
+    SizeT tail = (m_head + m_size) % capacity;
+
+    while (length > 0)
+    {
+        const SizeT count = std::min(length, capacity - tail);
+        std::memcpy(&m_buffer[tail], text, count);
+
+        text += count;
+        length -= count;
+        tail = (tail + count) % capacity;
+        m_size += count;
+    }
+
+    if (m_size > capacity)
+    {
+        m_head = (m_head + m_size - capacity) % capacity;
+        m_size = capacity;
+    }
+}
+
+SizeT MemoryLogSink::CopyTo(Char* buffer, SizeT bufferSize) const
+{
+    if (buffer == nullptr || bufferSize == 0) { return 0; }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const SizeT capacity = m_buffer.size();
+    const SizeT size = std::min(m_size, bufferSize - 1);
+
+    // 収まらない場合は新しい方を残す
+    SizeT read = (m_head + (m_size - size)) % std::max<SizeT>(capacity, 1);
+
+    for (SizeT copied = 0; copied < size;)
+    {
+        const SizeT count = std::min(size - copied, capacity - read);
+        std::memcpy(buffer + copied, &m_buffer[read], count);
+
+        copied += count;
+        read = (read + count) % capacity;
+    }
+
+    buffer[size] = '\0';
+    return size;
+}
+
+Void MemoryLogSink::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    m_head = 0;
+    m_size = 0;
+}
+
+UInt64 MemoryLogSink::GetWrittenBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    return m_writtenBytes;
+}
+
+
+} // namespace System
+} // namespace Cider
@@ -0,0 +1,178 @@
+﻿
+#include "System/Mailbox.hpp"
+#include "System/Assert.hpp"
+#include <thread>
+
+
+namespace Cider {
+namespace System {
+
+
+Mailbox::Mailbox(SizeT capacity)
+    : m_enqueuePosition(0)
+    , m_dequeuePosition(0)
+    , m_cells(STL::make_unique<Cell[]>(capacity))
+    , m_capacity(capacity)
+    , m_mask(capacity - 1)
+    , m_dispatchThread()
+    , m_spill()
+    , m_spillIndex(0)
+    , m_pendingSpillCount(0)
+    , m_spilledCount(0)
+#ifdef _DEBUG
+    , m_dispatching(false)
+#endif
+{
+    CIDER_ASSERT(capacity > 0 && (capacity & m_mask) == 0, "capacity must be a power of two.");
+
+    for (SizeT i = 0; i < m_capacity; ++i)
+    {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+
+Mailbox::~Mailbox()
+{
+#ifdef _DEBUG
+    CIDER_ASSERT(!m_dispatching.load(), "Mailbox destroyed while dispatching.");
+#endif
+}
+
+
+Void Mailbox::Post(Task&& task)
+{
+    CIDER_ASSERT(task, "");
+
+    const Bool isDispatchThread = m_dispatchThread.load(std::memory_order_relaxed) == std::this_thread::get_id();
+
+    // 一度溢れた後は、同じスレッドの順序を保つため実行されるまで溢れた側に積む
+    if (isDispatchThread && m_pendingSpillCount.load(std::memory_order_relaxed) > 0)
+    {
+        Spill(std::move(task));
+        return;
+    }
+
+    SizeT position = m_enqueuePosition.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+
+    for (;;)
+    {
+        cell = &m_cells[position & m_mask];
+
+        const SizeT sequence = cell->sequence.load(std::memory_order_acquire);
+        const PtrDiff difference = static_cast<PtrDiff>(sequence - position);
+
+        if (difference == 0)
+        {
+            if (m_enqueuePosition.compare_exchange_weak(
+                    position,
+                    position + 1,
+                    std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // 満杯。受け取り側のスレッドが待つと誰も取り出さなくなるため溢れさせる
+            if (isDispatchThread)
+            {
+                Spill(std::move(task));
+                return;
+            }
+
+            // 受け取り側が Dispatch するまで待つ
+            std::this_thread::yield();
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->task = std::move(task);
+    cell->sequence.store(position + 1, std::memory_order_release);
+}
+
+
+SizeT Mailbox::Dispatch(SizeT maxCount)
+{
+#ifdef _DEBUG
+    CIDER_ASSERT(!m_dispatching.exchange(true), "Mailbox::Dispatch called from multiple threads.");
+#endif
+
+    m_dispatchThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+    SizeT count = 0;
+
+    while (count < maxCount)
+    {
+        const SizeT position = m_dequeuePosition.load(std::memory_order_relaxed);
+        Cell& cell = m_cells[position & m_mask];
+
+        Task task;
+
+        if (cell.sequence.load(std::memory_order_acquire) == position + 1)
+        {
+            // 実行前にセルを返却し、処理の中から Post しても詰まらないようにする
+            task = std::move(cell.task);
+
+            cell.sequence.store(position + m_capacity, std::memory_order_release);
+            m_dequeuePosition.store(position + 1, std::memory_order_relaxed);
+        }
+        else if (m_spillIndex < m_spill.size())
+        {
+            // 溢れた処理はリングバッファが空の時だけ実行する (受け取り側のスレッドの Post の順序を保つ)
+            // 処理の中から Post すると m_spill が伸びるため、取り出してから実行する
+            task = std::move(m_spill[m_spillIndex++]);
+
+            if (m_spillIndex == m_spill.size())
+            {
+                m_spill.clear();
+                m_spillIndex = 0;
+            }
+
+            m_pendingSpillCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            break;
+        }
+
+        task();
+        ++count;
+    }
+
+#ifdef _DEBUG
+    m_dispatching.store(false);
+#endif
+
+    return count;
+}
+
+
+Bool Mailbox::IsEmpty() const
+{
+    if (m_pendingSpillCount.load(std::memory_order_relaxed) > 0)
+    {
+        return false;
+    }
+
+    const SizeT position = m_dequeuePosition.load(std::memory_order_relaxed);
+
+    return m_cells[position & m_mask].sequence.load(std::memory_order_acquire) != position + 1;
+}
+
+
+Void Mailbox::Spill(Task&& task)
+{
+    m_spill.push_back(std::move(task));
+    m_pendingSpillCount.fetch_add(1, std::memory_order_relaxed);
+    m_spilledCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+} // namespace System
+} // namespace Cider
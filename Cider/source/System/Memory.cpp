@@ -36,8 +36,11 @@ MemorySpace         MemoryManager::m_memorySpace[static_cast<Int32>(MEMORY_AREA:
 std::mutex          MemoryManager::m_infoLock;
 Bool                MemoryManager::m_initialized = false;
 std::array<MemoryManager::DebugInfo, 1024> MemoryManager::m_memoryInfo;
+std::mutex          MemoryManager::m_reportLock;
+std::array<MemoryManager::DebugInfo, 1024> MemoryManager::m_reportInfo;
 std::atomic<UInt64>  MemoryManager::m_allocCount = 0;
 std::atomic<UInt64>  MemoryManager::m_instanceCount = 0;
+std::atomic<UInt64>  MemoryManager::m_droppedInfoCount = 0;
 
 class Initialize
 {
@@ -46,10 +49,13 @@ public:
     {
         MemoryManager::Initialize();
         StackTrace::Initialize();
+        Log::Initialize();
     }
 
     ~Initialize()
     {
+        // 以降のログは呼び出し元スレッドで出力される
+        Log::Terminate();
         StackTrace::Terminate();
         MemoryManager::Terminate();
     }
@@ -123,6 +129,7 @@ Bool MemoryManager::Initialize()
         { "SYSTEM",         10 * KB },
         { "GRAPHICS",       10 * KB },
         { "APPLICATION",    10 * KB },
+        { "JOB",            128 * KB },
     };
 
     for (Int32 i = 0; i < static_cast<Int32>(MEMORY_AREA::NUM); ++i)
@@ -156,7 +163,12 @@ Void* MemoryManager::MallocDebug(const Char* file, Int32 line, MEMORY_AREA area,
         UInt32* trap = (UInt32*)((PtrDiff)address + bytes);
         (*trap) = MEMORY_TRAP;
 
-        std::lock_guard<std::mutex> lock(m_infoLock);
+        // スタックトレースはロック外で取得し、テーブルに登録する
+        Void* backTrace[STACK_TRACE_DEPTH];
+        UInt32 backTraceCount = StackTrace::CaptureBackTrace(backTrace, 0, STACK_TRACE_DEPTH);
+        StackTrace::StackId stackTraceId = StackTrace::InternBackTrace(backTrace, backTraceCount);
+
+        std::unique_lock<std::mutex> lock(m_infoLock);
 
         DebugInfo info;
         info.address = address;
@@ -165,10 +177,21 @@ Void* MemoryManager::MallocDebug(const Char* file, Int32 line, MEMORY_AREA area,
         info.line = line;
         info.bytes = bytes;
         info.date = std::chrono::system_clock::now();
-        info.stackTraceHash = StackTrace::CaptureStackTraceHash();
+        info.stackTraceHash = StackTrace::HashBackTrace(backTrace, backTraceCount);
+        info.stackTraceId = stackTraceId;
         info.bookmark = m_allocCount;
 
-        SetInfo(info);
+        if (!SetInfo(info))
+        {
+            lock.unlock();
+
+            // 警告は最初の 1 回だけ出し、以降は数だけ数える
+            if (m_droppedInfoCount++ == 0)
+            {
+                Log::Format("【 警告 】メモリデバッグ情報の保持数 (%d件) を超えました。以降の確保は記録されないことがあります (%s:%d)\n",
+                    static_cast<Int32>(m_memoryInfo.size()), file, line);
+            }
+        }
     }
 
     m_instanceCount++;
@@ -247,32 +270,40 @@ Void MemoryManager::ReportLeaks(UInt64 bookmark)
 
 Void MemoryManager::ReportLeaks(UInt64 bookmark1, UInt64 bookmark2)
 {
-    std::lock_guard<std::mutex> lock(m_infoLock);
+    std::lock_guard<std::mutex> reportLock(m_reportLock);
 
-    Int32 leakCount = 0;
-
-    Log::Message("========================================\n");
-
-    Log::Format("【 メモリリークチェック [%llX - %llX] 】\n", bookmark1, bookmark2);
-
-    for (auto& info : m_memoryInfo)
+    // 対象の情報を複製してからロックを解放し、シンボル解決と出力はロック外で行う
+    SizeT leakCount = 0;
     {
-        if (info.address == nullptr) { continue; }
+        std::lock_guard<std::mutex> lock(m_infoLock);
 
-        if (info.bookmark >= bookmark1 && info.bookmark < bookmark2)
+        for (auto& info : m_memoryInfo)
         {
-            Log::Message("----------------------------------------\n");
-            info.PrintInfo(true);
+            if (info.address == nullptr) { continue; }
 
-            leakCount++;
+            if (info.bookmark >= bookmark1 && info.bookmark < bookmark2)
+            {
+                m_reportInfo[leakCount++] = info;
+            }
         }
     }
 
+    Log::Message("========================================\n");
+
+    Log::Format("【 メモリリークチェック [%llX - %llX] 】\n", bookmark1, bookmark2);
+
+    PrintReportInfo(leakCount);
+
     Log::Message("----------------------------------------\n");
 
+    if (const UInt64 droppedCount = m_droppedInfoCount)
+    {
+        Log::Format("【 %llu件の確保はデバッグ情報の保持数を超えたため検査されていません 】\n", droppedCount);
+    }
+
     if (leakCount > 0)
     {
-        Log::Format("【 %d件のメモリリークが検出されました 】\n", leakCount);
+        Log::Format("【 %d件のメモリリークが検出されました 】\n", static_cast<Int32>(leakCount));
     }
     else
     {
@@ -289,38 +320,39 @@ Void MemoryManager::CheckTrap(UInt64 bookmark)
 
 Void MemoryManager::CheckTrap(UInt64 bookmark1, UInt64 bookmark2)
 {
-    std::lock_guard<std::mutex> lock(m_infoLock);
-
-    Int32 brokenCount = 0;
-
-    Log::Message("========================================\n");
-
-    Log::Format("【 メモリ破壊チェック [%llX - %llX] 】\n", bookmark1, bookmark2);
+    std::lock_guard<std::mutex> reportLock(m_reportLock);
 
-    for (auto& info : m_memoryInfo)
+    SizeT brokenCount = 0;
     {
-        if (info.address == nullptr) { continue; }
+        std::lock_guard<std::mutex> lock(m_infoLock);
 
-        if (info.bookmark >= bookmark1 && info.bookmark < bookmark2)
+        for (auto& info : m_memoryInfo)
         {
-            UInt32* trap = (UInt32*)((PtrDiff)info.address + info.bytes);
+            if (info.address == nullptr) { continue; }
 
-            if ((*trap) != MEMORY_TRAP)
+            if (info.bookmark >= bookmark1 && info.bookmark < bookmark2)
             {
-                Log::Message("----------------------------------------\n");
-
-                info.PrintInfo(true);
+                UInt32* trap = (UInt32*)((PtrDiff)info.address + info.bytes);
 
-                brokenCount++;
+                if ((*trap) != MEMORY_TRAP)
+                {
+                    m_reportInfo[brokenCount++] = info;
+                }
             }
         }
     }
 
+    Log::Message("========================================\n");
+
+    Log::Format("【 メモリ破壊チェック [%llX - %llX] 】\n", bookmark1, bookmark2);
+
+    PrintReportInfo(brokenCount);
+
     Log::Message("----------------------------------------\n");
 
     if (brokenCount > 0)
     {
-        Log::Format("【 %d件のメモリ破壊を検出しました 】\n", brokenCount);
+        Log::Format("【 %d件のメモリ破壊を検出しました 】\n", static_cast<Int32>(brokenCount));
     }
     else
     {
@@ -330,6 +362,29 @@ Void MemoryManager::CheckTrap(UInt64 bookmark1, UInt64 bookmark2)
     Log::Message("========================================\n");
 }
 
+Void MemoryManager::PrintReportInfo(SizeT count)
+{
+    // スタックトレースのシンボルをまとめて解決しておく
+    std::array<StackTrace::StackId, std::tuple_size<decltype(m_reportInfo)>::value> stackIds;
+    UInt32 stackIdCount = 0;
+
+    for (SizeT i = 0; i < count; ++i)
+    {
+        if (m_reportInfo[i].stackTraceId != StackTrace::INVALID_STACK_ID)
+        {
+            stackIds[stackIdCount++] = m_reportInfo[i].stackTraceId;
+        }
+    }
+
+    StackTrace::SymbolizeStackTraces(stackIds.data(), stackIdCount);
+
+    for (SizeT i = 0; i < count; ++i)
+    {
+        Log::Message("----------------------------------------\n");
+        m_reportInfo[i].PrintInfo(true);
+    }
+}
+
 MemoryManager::DebugInfo * MemoryManager::FindInfo(Void* address)
 {
     auto result = std::find_if(
@@ -348,28 +403,32 @@ MemoryManager::DebugInfo * MemoryManager::FindInfo(Void* address)
     return nullptr;
 }
 
-Void MemoryManager::SetInfo(const DebugInfo& info)
+Bool MemoryManager::SetInfo(const DebugInfo& info)
 {
     auto p = FindInfo(info.address);
 
     if (p)
     {
         (*p) = info;
+        return true;
     }
-    else
-    {
-        auto it = std::find_if(
-            m_memoryInfo.begin(),
-            m_memoryInfo.end(),
-            [](const DebugInfo& v) -> Bool {
-            return v.address == nullptr;
-        }
-        );
 
-        CIDER_ASSERT(it != m_memoryInfo.end(), "メモリデバッグ情報の保持数が限界です。");
+    auto it = std::find_if(
+        m_memoryInfo.begin(),
+        m_memoryInfo.end(),
+        [](const DebugInfo& v) -> Bool {
+        return v.address == nullptr;
+    }
+    );
 
-        (*it) = info;
+    // 保持数を超えた確保はデバッグ情報を記録しない
+    if (it == m_memoryInfo.end())
+    {
+        return false;
     }
+
+    (*it) = info;
+    return true;
 }
 
 
@@ -387,6 +446,7 @@ Void MemoryManager::DebugInfo::Clear()
     area = MEMORY_AREA::UNKNOWN;
     date = std::chrono::system_clock::time_point();
     stackTraceHash = 0;
+    stackTraceId = StackTrace::INVALID_STACK_ID;
     bookmark = 0;
 }
 
@@ -403,6 +463,7 @@ Void MemoryManager::DebugInfo::PrintInfo(Bool newLine)
         "SYSTEM",
         "GRAPHICS",
         "APPLICATION",
+        "JOB",
     };
 
     static Char dateBuffer[256];
@@ -415,8 +476,8 @@ Void MemoryManager::DebugInfo::PrintInfo(Bool newLine)
 
     Log::Format(
         newLine ?
-        "%s(%d)\n{ area=\"%s\" address=0x%p size=%zubyte time=%s backTraceHash=0x%016llX }\n[ %08X ]\n" :
-        "%s(%d) : { area=\"%s\" address=0x%p size=%zubyte time=%s backTraceHash=0x%016llX } [ %08X ]\n",
+        "%s(%d)\n{ area=\"%s\" address=0x%p size=%zubyte time=%s backTraceHash=0x%016llX stackId=%u }\n[ %08X ]\n" :
+        "%s(%d) : { area=\"%s\" address=0x%p size=%zubyte time=%s backTraceHash=0x%016llX stackId=%u } [ %08X ]\n",
         file,
         line,
         s_memoryAreaName[static_cast<Int32>(area)],
@@ -424,8 +485,15 @@ Void MemoryManager::DebugInfo::PrintInfo(Bool newLine)
         bytes,
         dateBuffer,
         stackTraceHash,
+        stackTraceId,
         (*trap)
     );
+
+    // 詳細表示ではスタックトレースも出力する
+    if (newLine && stackTraceId != StackTrace::INVALID_STACK_ID)
+    {
+        StackTrace::PrintStackTrace(stackTraceId);
+    }
 }
 
 
@@ -0,0 +1,511 @@
+﻿
+#include "System/StackTrace.hpp"
+#include "System/Api.hpp"
+#include "System/Memory.hpp"
+#include "System/Log.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+
+namespace {
+
+
+using namespace Cider;
+
+
+/*
+    スタックトレーステーブル
+    同一のスタックトレースは一度だけ保存し、IDで参照する
+    (メモリ確保の内部から呼ばれるため、固定長の静的領域のみを使用する)
+*/
+constexpr UInt32 STACK_RECORD_CAPACITY = 4096;
+constexpr UInt32 STACK_BUCKET_COUNT = STACK_RECORD_CAPACITY * 2;
+constexpr UInt32 STACK_ADDRESS_CAPACITY = STACK_RECORD_CAPACITY * 16;
+
+static_assert((STACK_BUCKET_COUNT & (STACK_BUCKET_COUNT - 1)) == 0, "bucket count must be power of two.");
+
+
+struct StackRecord
+{
+    UInt64 hash;
+    UInt32 offset;
+    UInt32 depth;
+};
+
+
+#pragma warning(push)
+#pragma warning(disable: 4074)
+#pragma init_seg(compiler)
+
+static std::mutex   g_StackTableLock;
+static StackRecord  g_StackRecords[STACK_RECORD_CAPACITY];    // [0] は未使用
+static UInt32       g_StackRecordCount = 1;
+static UInt32       g_StackBuckets[STACK_BUCKET_COUNT];       // 0 は空
+static Void*        g_StackAddresses[STACK_ADDRESS_CAPACITY];
+static UInt32       g_StackAddressCount = 0;
+
+#pragma warning(pop)
+
+
+/*
+    シンボルキャッシュ
+    アドレスをキーにシンボル解決結果を保持する
+    (DbgHelp はスレッドセーフではないため、解決処理もロック内で行う)
+    メモリは DEBUG 領域から直接確保し、メモリデバッグ情報には記録しない
+*/
+typedef System::StackTrace::SymbolInfo SymbolInfo;
+
+constexpr SizeT SYMBOL_CHUNK_SIZE = 64 * 1024;
+constexpr SizeT SYMBOL_TABLE_INITIAL_CAPACITY = 1024;
+
+
+struct SymbolChunk
+{
+    SymbolChunk*    next;
+    SizeT           used;
+    // 以降にデータが続く
+};
+
+
+#pragma warning(push)
+#pragma warning(disable: 4074)
+#pragma init_seg(compiler)
+
+static std::mutex       g_SymbolCacheLock;
+static SymbolChunk*     g_SymbolChunks = nullptr;
+static SymbolInfo**     g_SymbolTable = nullptr;
+static SizeT            g_SymbolTableCapacity = 0;
+static SizeT            g_SymbolCount = 0;
+
+#pragma warning(pop)
+
+
+static SizeT HashAddress(Void* address)
+{
+    UInt64 value = static_cast<UInt64>(reinterpret_cast<std::uintptr_t>(address));
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    return static_cast<SizeT>(value);
+}
+
+static Void* AllocateSymbolMemory(SizeT bytes)
+{
+    constexpr SizeT HEADER_SIZE = (sizeof(SymbolChunk) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    bytes = (bytes + sizeof(Void*) - 1) & ~(sizeof(Void*) - 1);
+
+    if (g_SymbolChunks == nullptr || g_SymbolChunks->used + bytes > SYMBOL_CHUNK_SIZE)
+    {
+        const SizeT chunkSize = std::max(bytes, SYMBOL_CHUNK_SIZE);
+
+        auto chunk = static_cast<SymbolChunk*>(
+            System::MemoryManager::Malloc(System::MEMORY_AREA::DEBUG, HEADER_SIZE + chunkSize)
+        );
+
+        if (chunk == nullptr) { return nullptr; }
+
+        chunk->next = g_SymbolChunks;
+        chunk->used = 0;
+        g_SymbolChunks = chunk;
+    }
+
+    Void* memory = reinterpret_cast<UInt8*>(g_SymbolChunks) + HEADER_SIZE + g_SymbolChunks->used;
+    g_SymbolChunks->used += bytes;
+    return memory;
+}
+
+static const Char* CopySymbolString(const Char* text)
+{
+    const SizeT length = std::strlen(text) + 1;
+
+    auto copy = static_cast<Char*>(AllocateSymbolMemory(length));
+    if (copy == nullptr) { return "???"; }
+
+    std::memcpy(copy, text, length);
+    return copy;
+}
+
+static SymbolInfo** FindSymbolSlot(Void* address)
+{
+    const SizeT mask = g_SymbolTableCapacity - 1;
+    SizeT index = HashAddress(address) & mask;
+
+    while (g_SymbolTable[index] != nullptr && g_SymbolTable[index]->address != address)
+    {
+        index = (index + 1) & mask;
+    }
+
+    return &g_SymbolTable[index];
+}
+
+static Bool ReserveSymbolTable(SizeT count)
+{
+    // 負荷率 50% 以下を保つ
+    if (g_SymbolTable != nullptr && count * 2 <= g_SymbolTableCapacity)
+    {
+        return true;
+    }
+
+    SizeT capacity = std::max(g_SymbolTableCapacity, SYMBOL_TABLE_INITIAL_CAPACITY);
+    while (count * 2 > capacity)
+    {
+        capacity *= 2;
+    }
+
+    auto table = static_cast<SymbolInfo**>(
+        System::MemoryManager::Malloc(System::MEMORY_AREA::DEBUG, sizeof(SymbolInfo*) * capacity)
+    );
+
+    if (table == nullptr) { return false; }
+
+    std::fill(table, table + capacity, nullptr);
+
+    SymbolInfo** oldTable = g_SymbolTable;
+    const SizeT oldCapacity = g_SymbolTableCapacity;
+
+    g_SymbolTable = table;
+    g_SymbolTableCapacity = capacity;
+
+    for (SizeT i = 0; i < oldCapacity; ++i)
+    {
+        if (oldTable[i] != nullptr)
+        {
+            (*FindSymbolSlot(oldTable[i]->address)) = oldTable[i];
+        }
+    }
+
+    if (oldTable != nullptr)
+    {
+        System::MemoryManager::Free(System::MEMORY_AREA::DEBUG, oldTable);
+    }
+
+    return true;
+}
+
+
+static Bool IsSameBackTrace(const StackRecord& record, UInt64 hash, Void* const* addresses, UInt32 count)
+{
+    return record.hash == hash
+        && record.depth == count
+        && std::memcmp(&g_StackAddresses[record.offset], addresses, sizeof(Void*) * count) == 0;
+}
+
+
+} // namespace /* unnamed */
+
+
+namespace Cider {
+namespace System {
+
+
+Void StackTrace::SymbolInfo::Print() const
+{
+    if (line == -1)
+    {
+        Log::Format(
+            "0x%p @ %s @ %s\n",
+            address,
+            moduleName,
+            function
+        );
+    }
+    else
+    {
+        Log::Format(
+            "0x%p @ %s @ %s @ %s(%d)\n",
+            address,
+            moduleName,
+            function,
+            file,
+            line
+        );
+    }
+}
+
+
+UInt64 StackTrace::HashBackTrace(
+    Void* const* addresses,
+    UInt32 count
+)
+{
+    UInt64 hash = 0xCBF29CE484222325ULL;
+
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        UInt64 value = static_cast<UInt64>(reinterpret_cast<std::uintptr_t>(addresses[i]));
+        value *= 0x9E3779B97F4A7C15ULL;
+        value ^= value >> 29;
+
+        hash = (hash ^ value) * 0x100000001B3ULL;
+    }
+
+    // 最終ミックス (fmix64)
+    hash ^= count;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+CIDER_NOINLINE UInt64 StackTrace::CaptureStackTraceHash(
+    UInt32 skipCount,
+    UInt32 maxDepth
+)
+{
+    Void* buffer[MAX_DEPTH] = { nullptr };
+
+    UInt32 count = CaptureBackTrace(buffer, skipCount + 1, maxDepth);
+
+    return HashBackTrace(buffer, count);
+}
+
+CIDER_NOINLINE StackTrace::StackId StackTrace::CaptureStackTraceId(
+    UInt32 skipCount,
+    UInt32 maxDepth
+)
+{
+    Void* buffer[MAX_DEPTH] = { nullptr };
+
+    UInt32 count = CaptureBackTrace(buffer, skipCount + 1, maxDepth);
+
+    return InternBackTrace(buffer, count);
+}
+
+StackTrace::StackId StackTrace::InternBackTrace(
+    Void* const* addresses,
+    UInt32 count
+)
+{
+    if (count == 0) { return INVALID_STACK_ID; }
+
+    const UInt64 hash = HashBackTrace(addresses, count);
+
+    std::lock_guard<std::mutex> lock(g_StackTableLock);
+
+    UInt32 bucket = static_cast<UInt32>(hash) & (STACK_BUCKET_COUNT - 1);
+
+    // オープンアドレス法 (線形探索)
+    while (g_StackBuckets[bucket] != 0)
+    {
+        const UInt32 index = g_StackBuckets[bucket];
+
+        if (IsSameBackTrace(g_StackRecords[index], hash, addresses, count))
+        {
+            return static_cast<StackId>(index);
+        }
+
+        bucket = (bucket + 1) & (STACK_BUCKET_COUNT - 1);
+    }
+
+    // テーブルが一杯の場合は登録しない
+    if (g_StackRecordCount >= STACK_RECORD_CAPACITY ||
+        g_StackAddressCount + count > STACK_ADDRESS_CAPACITY)
+    {
+        return INVALID_STACK_ID;
+    }
+
+    const UInt32 index = g_StackRecordCount++;
+
+    StackRecord& record = g_StackRecords[index];
+    record.hash = hash;
+    record.offset = g_StackAddressCount;
+    record.depth = count;
+
+    std::memcpy(&g_StackAddresses[record.offset], addresses, sizeof(Void*) * count);
+    g_StackAddressCount += count;
+
+    g_StackBuckets[bucket] = index;
+
+    return static_cast<StackId>(index);
+}
+
+UInt32 StackTrace::GetBackTrace(
+    StackId stackId,
+    Void* const** outAddresses
+)
+{
+    std::lock_guard<std::mutex> lock(g_StackTableLock);
+
+    if (stackId == INVALID_STACK_ID || stackId >= g_StackRecordCount)
+    {
+        (*outAddresses) = nullptr;
+        return 0;
+    }
+
+    // 登録済みのレコードは変更されないため、ロック外で参照してよい
+    const StackRecord& record = g_StackRecords[stackId];
+    (*outAddresses) = &g_StackAddresses[record.offset];
+    return record.depth;
+}
+
+UInt64 StackTrace::GetBackTraceHash(StackId stackId)
+{
+    std::lock_guard<std::mutex> lock(g_StackTableLock);
+
+    if (stackId == INVALID_STACK_ID || stackId >= g_StackRecordCount)
+    {
+        return 0;
+    }
+
+    return g_StackRecords[stackId].hash;
+}
+
+
+const StackTrace::SymbolInfo* StackTrace::Symbolize(Void* address)
+{
+    std::lock_guard<std::mutex> lock(g_SymbolCacheLock);
+
+    return SymbolizeLocked(address);
+}
+
+UInt32 StackTrace::SymbolizeStackTraces(
+    const StackId* stackIds,
+    UInt32 count
+)
+{
+    // 登録済みのスタックトレースは変更されないため、アドレス列はロック外で参照してよい
+    SizeT addressCount = 0;
+
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        Void* const* backTrace = nullptr;
+        addressCount += GetBackTrace(stackIds[i], &backTrace);
+    }
+
+    if (addressCount == 0) { return 0; }
+
+    // メモリデバッグ情報のロック内から呼ばれても良いように、追跡しない確保を使う
+    auto addresses = static_cast<Void**>(
+        MemoryManager::Malloc(MEMORY_AREA::DEBUG, sizeof(Void*) * addressCount)
+    );
+
+    if (addresses == nullptr) { return 0; }
+
+    SizeT uniqueCount = 0;
+
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        Void* const* backTrace = nullptr;
+        const UInt32 depth = GetBackTrace(stackIds[i], &backTrace);
+
+        std::copy(backTrace, backTrace + depth, addresses + uniqueCount);
+        uniqueCount += depth;
+    }
+
+    // アドレス順に解決すると同じモジュールのシンボル情報を続けて参照できる
+    std::sort(addresses, addresses + uniqueCount);
+    uniqueCount = static_cast<SizeT>(std::unique(addresses, addresses + uniqueCount) - addresses);
+
+    UInt32 resolvedCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_SymbolCacheLock);
+
+        if (ReserveSymbolTable(g_SymbolCount + uniqueCount))
+        {
+            for (SizeT i = 0; i < uniqueCount; ++i)
+            {
+                if (SymbolizeLocked(addresses[i]))
+                {
+                    resolvedCount++;
+                }
+            }
+        }
+    }
+
+    MemoryManager::Free(MEMORY_AREA::DEBUG, addresses);
+
+    return resolvedCount;
+}
+
+Void StackTrace::PrintBackTrace(
+    Void* const* addresses,
+    UInt32 count
+)
+{
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        if (auto symbol = Symbolize(addresses[i]))
+        {
+            symbol->Print();
+        }
+        else
+        {
+            Log::Format("0x%p @ ??? @ ???\n", addresses[i]);
+        }
+    }
+}
+
+Void StackTrace::PrintStackTrace(StackId stackId)
+{
+    Void* const* backTrace = nullptr;
+    const UInt32 depth = GetBackTrace(stackId, &backTrace);
+
+    PrintBackTrace(backTrace, depth);
+}
+
+const StackTrace::SymbolInfo* StackTrace::SymbolizeLocked(Void* address)
+{
+    if (!ReserveSymbolTable(g_SymbolCount + 1))
+    {
+        return nullptr;
+    }
+
+    SymbolInfo** slot = FindSymbolSlot(address);
+
+    if ((*slot) != nullptr)
+    {
+        return (*slot);
+    }
+
+    auto symbol = static_cast<SymbolInfo*>(AllocateSymbolMemory(sizeof(SymbolInfo)));
+    if (symbol == nullptr)
+    {
+        return nullptr;
+    }
+
+    // 一時バッファに解決してから文字列を複製する (ロック内でのみ使用)
+    static TraceInfo s_resolveBuffer;
+    ResolveTraceInfo(address, s_resolveBuffer);
+
+    symbol->function = CopySymbolString(s_resolveBuffer.function);
+    symbol->file = CopySymbolString(s_resolveBuffer.file);
+    symbol->moduleName = CopySymbolString(s_resolveBuffer.moduleName);
+    symbol->line = s_resolveBuffer.line;
+    symbol->lineAddress = s_resolveBuffer.lineAddress;
+    symbol->address = address;
+
+    (*slot) = symbol;
+    g_SymbolCount++;
+
+    return symbol;
+}
+
+Void StackTrace::ClearSymbolCache()
+{
+    std::lock_guard<std::mutex> lock(g_SymbolCacheLock);
+
+    while (g_SymbolChunks != nullptr)
+    {
+        SymbolChunk* next = g_SymbolChunks->next;
+        MemoryManager::Free(MEMORY_AREA::DEBUG, g_SymbolChunks);
+        g_SymbolChunks = next;
+    }
+
+    if (g_SymbolTable != nullptr)
+    {
+        MemoryManager::Free(MEMORY_AREA::DEBUG, g_SymbolTable);
+        g_SymbolTable = nullptr;
+    }
+
+    g_SymbolTableCapacity = 0;
+    g_SymbolCount = 0;
+}
+
+
+} // namespace System
+} // namespace Cider
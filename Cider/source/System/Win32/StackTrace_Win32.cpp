@@ -1,11 +1,13 @@
 ﻿
 
 #include "System/StackTrace.hpp"
+#include "System/Api.hpp"
 #include "System/Log.hpp"
 
 #include <Windows.h>
 #include <dbghelp.h>
 #include <mutex>
+#include <intrin.h>
 
 #pragma comment(lib, "imagehlp.lib")
 #pragma comment(lib, "Kernel32.lib")
@@ -86,6 +88,63 @@ static Void AddressToTraceInfo(Void* address, Cider::System::StackTrace::TraceIn
 }
 
 
+#if defined(_M_IX86)
+static UInt32 WalkFramePointers(
+    Void** frame,
+    Void** addressBuffer,
+    UInt32 skipCount,
+    UInt32 maxDepth
+)
+{
+    // 現在のスレッドのスタック範囲外を指すフレームは辿らない
+    const NT_TIB* tib = reinterpret_cast<const NT_TIB*>(::NtCurrentTeb());
+    const ULONG_PTR stackLow = reinterpret_cast<ULONG_PTR>(tib->StackLimit);
+    const ULONG_PTR stackHigh = reinterpret_cast<ULONG_PTR>(tib->StackBase);
+
+    UInt32 count = 0;
+
+    while (count < maxDepth)
+    {
+        const ULONG_PTR current = reinterpret_cast<ULONG_PTR>(frame);
+
+        if (current < stackLow ||
+            current + sizeof(Void*) * 2 > stackHigh ||
+            (current & (sizeof(Void*) - 1)) != 0)
+        {
+            break;
+        }
+
+        Void* returnAddress = frame[1];
+        if (returnAddress == nullptr)
+        {
+            break;
+        }
+
+        if (skipCount > 0)
+        {
+            --skipCount;
+        }
+        else
+        {
+            addressBuffer[count++] = returnAddress;
+        }
+
+        Void** next = reinterpret_cast<Void**>(frame[0]);
+
+        // スタックは上位アドレスへ向かって巻き戻る
+        if (next <= frame)
+        {
+            break;
+        }
+
+        frame = next;
+    }
+
+    return count;
+}
+#endif
+
+
 } // namespace /* unnamed */
 
 
@@ -149,6 +208,8 @@ Void StackTrace::Initialize()
 
 Void StackTrace::Terminate()
 {
+    ClearSymbolCache();
+
     if (g_IsSymbolEngineReady)
     {
         ::SymCleanup(g_Process);
@@ -156,15 +217,46 @@ Void StackTrace::Terminate()
     }
 }
 
-UInt64 StackTrace::CaptureStackTraceHash()
+CIDER_NOINLINE UInt32 StackTrace::CaptureBackTrace(
+    Void** addressBuffer,
+    UInt32 skipCount,
+    UInt32 maxDepth
+)
 {
-    const ULONG bufferCount = 62;
-    Void* buffer[bufferCount] = { nullptr };
+    if (addressBuffer == nullptr || maxDepth == 0)
+    {
+        return 0;
+    }
 
-    ULONG h = 0;
-    ::RtlCaptureStackBackTrace(0, (ULONG)bufferCount, buffer, &h);
+    if (maxDepth > MAX_DEPTH)
+    {
+        maxDepth = MAX_DEPTH;
+    }
 
-    return (UInt64)h;
+#if defined(_M_IX86)
+    // フレームポインタ (EBP) チェーンを直接たどる高速パス
+    // ※ /Oy- (フレームポインタ省略なし) でビルドされていること
+    UInt32 count = ::WalkFramePointers(
+        reinterpret_cast<Void**>(_AddressOfReturnAddress()) - 1,
+        addressBuffer,
+        skipCount,
+        maxDepth
+    );
+
+    if (count > 0)
+    {
+        return count;
+    }
+#endif
+
+    // x64 はフレームポインタが保証されないため、アンワインド情報を使用する
+    // (自身のフレームを飛ばす)
+    return (UInt32)::RtlCaptureStackBackTrace(
+        (ULONG)(skipCount + 1),
+        (ULONG)maxDepth,
+        addressBuffer,
+        nullptr
+    );
 }
 
 UInt32 StackTrace::CaptureStackTrace(
@@ -172,26 +264,34 @@ UInt32 StackTrace::CaptureStackTrace(
     UInt32 bufferCount
 )
 {
-    if (bufferCount >= 63)
-    {
-        bufferCount = 62;
-    }
-
-    Void* buffer[62] = { nullptr };
+    Void* buffer[MAX_DEPTH] = { nullptr };
 
-    ULONG h = 0;
-    UInt32 captureCount = (UInt32)::RtlCaptureStackBackTrace(0, (ULONG)bufferCount, buffer, &h);
+    UInt32 captureCount = CaptureBackTrace(buffer, 0, bufferCount);
 
     for (UInt32 i = 0; i < captureCount; ++i)
     {
-        if (i > bufferCount) { break; }
+        TraceInfo& info = infoBuffer[i];
+        info.Clear();
+        info.address = buffer[i];
 
-        ::AddressToTraceInfo(buffer[i], infoBuffer[i]);
+        if (auto symbol = Symbolize(buffer[i]))
+        {
+            strcpy_s(info.function, symbol->function);
+            strcpy_s(info.file, symbol->file);
+            strcpy_s(info.moduleName, symbol->moduleName);
+            info.line = symbol->line;
+            info.lineAddress = symbol->lineAddress;
+        }
     }
 
     return captureCount;
 }
 
+Void StackTrace::ResolveTraceInfo(Void* address, TraceInfo& outInfo)
+{
+    ::AddressToTraceInfo(address, outInfo);
+}
+
 
 } // namespace System
 } // namespace Cider
@@ -0,0 +1,516 @@
+﻿
+#include "System/LogBinary.hpp"
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+
+/*
+    CiderLogDecoder
+    BinaryFileLogSink が出力したバイナリログをテキストに変換する
+
+    CiderLogDecoder <input> [output] [--source]
+        output を省略した場合は標準出力に書き込む
+        --source を指定すると呼び出し箇所 (ファイル名と行番号) を付加する
+*/
+
+
+namespace {
+
+
+using namespace Cider;
+using namespace Cider::System;
+
+
+const Char* const g_LevelNames[] = {
+    "Verbose",
+    "Debug",
+    "Info",
+    "Warning",
+    "Error",
+    "Assert",
+};
+
+
+struct FormatDefinition
+{
+    Bool            valid = false;
+    Int32           level = 0;
+    Int32           line = 0;
+    std::string     file;
+    std::string     format;
+    std::string     signature;
+};
+
+
+struct Argument
+{
+    Char            code = '\0';
+    Int64           integer = 0;
+    UInt64          unsignedInteger = 0;
+    Double          floating = 0.0;
+    std::string     string;
+};
+
+
+class Reader
+{
+public:
+    explicit Reader(std::FILE* file)
+        : m_file(file)
+    {}
+
+    template<typename T>
+    Bool Read(T& value)
+    {
+        return std::fread(&value, sizeof(T), 1, m_file) == 1;
+    }
+
+    Bool ReadString(std::string& value, SizeT length)
+    {
+        value.resize(length);
+        return length == 0 || std::fread(&value[0], 1, length, m_file) == length;
+    }
+
+private:
+    std::FILE*  m_file;
+};
+
+
+const Char* GetLevelName(Int32 level)
+{
+    const Int32 count = static_cast<Int32>(sizeof(g_LevelNames) / sizeof(g_LevelNames[0]));
+    return (level >= 0 && level < count) ? g_LevelNames[level] : nullptr;
+}
+
+
+Void AppendTime(std::string& output, UInt64 systemTime)
+{
+    const std::time_t seconds = static_cast<std::time_t>(systemTime / 1000000);
+    const UInt32 microseconds = static_cast<UInt32>(systemTime % 1000000);
+
+    std::tm localTime = {};
+    localtime_s(&localTime, &seconds);
+
+    Char buffer[64];
+    const SizeT length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &localTime);
+    output.append(buffer, length);
+
+    std::snprintf(buffer, sizeof(buffer), ".%06u", microseconds);
+    output.append(buffer);
+}
+
+
+// payload を signature に従って引数に戻す
+Bool DecodeArguments(
+    const std::string& signature,
+    const std::vector<UInt8>& payload,
+    std::vector<Argument>& outArguments
+)
+{
+    outArguments.clear();
+
+    SizeT offset = 0;
+
+    for (const Char code : signature)
+    {
+        Argument argument;
+        argument.code = code;
+
+        if (code == 's')
+        {
+            UInt16 length = 0;
+            if (offset + sizeof(length) > payload.size()) { return false; }
+
+            std::memcpy(&length, &payload[offset], sizeof(length));
+            offset += sizeof(length);
+
+            if (offset + length > payload.size()) { return false; }
+
+            argument.string.assign(reinterpret_cast<const Char*>(&payload[offset]), length);
+            offset += length;
+        }
+        else
+        {
+            const SizeT size = LogBinary::GetTypeSize(code);
+            if (size == 0 || offset + size > payload.size()) { return false; }
+
+            const UInt8* data = &payload[offset];
+            offset += size;
+
+            switch (code)
+            {
+            case 'b': { Int8 v;   std::memcpy(&v, data, size); argument.integer = v; break; }
+            case 'h': { Int16 v;  std::memcpy(&v, data, size); argument.integer = v; break; }
+            case 'i': { Int32 v;  std::memcpy(&v, data, size); argument.integer = v; break; }
+            case 'q': { Int64 v;  std::memcpy(&v, data, size); argument.integer = v; break; }
+            case 'B': { UInt8 v;  std::memcpy(&v, data, size); argument.unsignedInteger = v; break; }
+            case '?': { UInt8 v;  std::memcpy(&v, data, size); argument.unsignedInteger = v; break; }
+            case 'H': { UInt16 v; std::memcpy(&v, data, size); argument.unsignedInteger = v; break; }
+            case 'I': { UInt32 v; std::memcpy(&v, data, size); argument.unsignedInteger = v; break; }
+            case 'Q': { UInt64 v; std::memcpy(&v, data, size); argument.unsignedInteger = v; break; }
+            case 'P': { UInt64 v; std::memcpy(&v, data, size); argument.unsignedInteger = v; break; }
+            case 'f': { Float v;  std::memcpy(&v, data, size); argument.floating = v; break; }
+            case 'd': { Double v; std::memcpy(&v, data, size); argument.floating = v; break; }
+            default: return false;
+            }
+
+            // 符号付きの値は符号なしとしても参照できるようにしておく
+            if (code == 'b' || code == 'h' || code == 'i' || code == 'q')
+            {
+                argument.unsignedInteger = static_cast<UInt64>(argument.integer);
+            }
+            else
+            {
+                argument.integer = static_cast<Int64>(argument.unsignedInteger);
+            }
+        }
+
+        outArguments.push_back(argument);
+    }
+
+    return true;
+}
+
+
+template<typename T>
+Void AppendFormatted(
+    std::string& output,
+    const std::string& specifier,
+    const Int32* stars,
+    UInt32 starCount,
+    T value
+)
+{
+    Char buffer[1024];
+    Int32 length = 0;
+
+    switch (starCount)
+    {
+    case 0: length = std::snprintf(buffer, sizeof(buffer), specifier.c_str(), value); break;
+    case 1: length = std::snprintf(buffer, sizeof(buffer), specifier.c_str(), stars[0], value); break;
+    default: length = std::snprintf(buffer, sizeof(buffer), specifier.c_str(), stars[0], stars[1], value); break;
+    }
+
+    if (length <= 0) { return; }
+
+    output.append(buffer, (static_cast<SizeT>(length) < sizeof(buffer)) ? static_cast<SizeT>(length) : sizeof(buffer) - 1);
+}
+
+
+Void AppendArgument(
+    std::string& output,
+    const std::string& specifier,
+    const Int32* stars,
+    UInt32 starCount,
+    const Argument& argument
+)
+{
+    switch (argument.code)
+    {
+    case 'b': case 'h': case 'i': case '?':
+        AppendFormatted(output, specifier, stars, starCount, static_cast<Int32>(argument.integer));
+        break;
+
+    case 'B': case 'H': case 'I':
+        AppendFormatted(output, specifier, stars, starCount, static_cast<UInt32>(argument.unsignedInteger));
+        break;
+
+    case 'q':
+        AppendFormatted(output, specifier, stars, starCount, static_cast<long long>(argument.integer));
+        break;
+
+    case 'Q':
+        AppendFormatted(output, specifier, stars, starCount, static_cast<unsigned long long>(argument.unsignedInteger));
+        break;
+
+    case 'f': case 'd':
+        AppendFormatted(output, specifier, stars, starCount, argument.floating);
+        break;
+
+    case 's':
+        AppendFormatted(output, specifier, stars, starCount, argument.string.c_str());
+        break;
+
+    case 'P':
+        AppendFormatted(output, specifier, stars, starCount, reinterpret_cast<Void*>(static_cast<std::uintptr_t>(argument.unsignedInteger)));
+        break;
+
+    default:
+        output += "<?>";
+        break;
+    }
+}
+
+
+// 書式文字列を 1 変換指定子ずつ書式化する
+Void FormatText(
+    std::string& output,
+    const std::string& format,
+    const std::vector<Argument>& arguments
+)
+{
+    static const Char* const s_conversions = "diouxXcfFeEgGaAsp";
+
+    SizeT argumentIndex = 0;
+
+    for (SizeT i = 0; i < format.size(); ++i)
+    {
+        if (format[i] != '%')
+        {
+            output += format[i];
+            continue;
+        }
+
+        if (i + 1 < format.size() && format[i + 1] == '%')
+        {
+            output += '%';
+            ++i;
+            continue;
+        }
+
+        SizeT end = i + 1;
+        Int32 stars[2] = {};
+        UInt32 starCount = 0;
+
+        while (end < format.size() && std::strchr(s_conversions, format[end]) == nullptr)
+        {
+            if (format[end] == '*' && starCount < 2 && argumentIndex < arguments.size())
+            {
+                stars[starCount++] = static_cast<Int32>(arguments[argumentIndex++].integer);
+            }
+            ++end;
+        }
+
+        if (end >= format.size() || argumentIndex >= arguments.size())
+        {
+            output += "<?>";
+            return;
+        }
+
+        const std::string specifier = format.substr(i, end - i + 1);
+        AppendArgument(output, specifier, stars, starCount, arguments[argumentIndex++]);
+
+        i = end;
+    }
+}
+
+
+Void EndLine(std::string& output)
+{
+    if (output.empty() || output.back() != '\n')
+    {
+        output += '\n';
+    }
+}
+
+
+Int32 Decode(std::FILE* input, std::FILE* output, Bool withSource)
+{
+    Reader reader(input);
+
+    LogBinary::FileHeader header;
+    if (!reader.Read(header)
+        || std::memcmp(header.magic, LogBinary::MAGIC, sizeof(header.magic)) != 0)
+    {
+        std::fprintf(stderr, "not a binary log file.\n");
+        return 1;
+    }
+
+    if (header.version != LogBinary::VERSION)
+    {
+        std::fprintf(stderr, "unsupported version %u.\n", header.version);
+        return 1;
+    }
+
+    std::vector<FormatDefinition> formats(LogBinary::MAX_FORMAT_COUNT + 1);
+    std::vector<Argument> arguments;
+    std::vector<UInt8> payload;
+    std::string line;
+    UInt64 eventCount = 0;
+
+    for (;;)
+    {
+        UInt8 frameType = 0;
+        if (!reader.Read(frameType)) { break; }
+
+        line.clear();
+
+        if (frameType == LogBinary::FRAME_FORMAT)
+        {
+            UInt32 formatId = 0;
+            UInt8 level = 0;
+            Int32 sourceLine = 0;
+            UInt16 fileLength = 0;
+            UInt16 formatLength = 0;
+            UInt8 signatureLength = 0;
+
+            FormatDefinition definition;
+
+            if (!reader.Read(formatId) || formatId >= formats.size()
+                || !reader.Read(level)
+                || !reader.Read(sourceLine)
+                || !reader.Read(fileLength) || !reader.ReadString(definition.file, fileLength)
+                || !reader.Read(formatLength) || !reader.ReadString(definition.format, formatLength)
+                || !reader.Read(signatureLength) || !reader.ReadString(definition.signature, signatureLength))
+            {
+                break;
+            }
+
+            definition.valid = true;
+            definition.level = level;
+            definition.line = sourceLine;
+            formats[formatId] = definition;
+        }
+        else if (frameType == LogBinary::FRAME_EVENT)
+        {
+            UInt32 formatId = 0;
+            UInt64 timestamp = 0;
+            UInt16 payloadSize = 0;
+
+            if (!reader.Read(formatId) || formatId >= formats.size()
+                || !reader.Read(timestamp)
+                || !reader.Read(payloadSize))
+            {
+                break;
+            }
+
+            payload.resize(payloadSize);
+            if (payloadSize > 0 && std::fread(payload.data(), 1, payloadSize, input) != payloadSize) { break; }
+
+            const FormatDefinition& definition = formats[formatId];
+
+            // 基準時刻からの差分で時刻を求める
+            const Int64 elapsed = static_cast<Int64>(timestamp - header.baseTimestamp) / 1000;
+            AppendTime(line, static_cast<UInt64>(static_cast<Int64>(header.baseSystemTime) + elapsed));
+
+            if (!definition.valid)
+            {
+                line += " <unknown format>";
+            }
+            else
+            {
+                const Char* levelName = GetLevelName(definition.level);
+                if (levelName != nullptr)
+                {
+                    line += " [";
+                    line += levelName;
+                    line += "]";
+                }
+
+                line += ' ';
+
+                if (DecodeArguments(definition.signature, payload, arguments))
+                {
+                    FormatText(line, definition.format, arguments);
+                }
+                else
+                {
+                    line += "<broken payload>";
+                }
+
+                if (withSource)
+                {
+                    while (!line.empty() && line.back() == '\n') { line.pop_back(); }
+
+                    line += " (" + definition.file + ":" + std::to_string(definition.line) + ")";
+                }
+            }
+
+            ++eventCount;
+        }
+        else if (frameType == LogBinary::FRAME_TEXT)
+        {
+            UInt8 level = 0;
+            UInt64 systemTime = 0;
+            UInt32 textLength = 0;
+            std::string text;
+
+            if (!reader.Read(level)
+                || !reader.Read(systemTime)
+                || !reader.Read(textLength) || !reader.ReadString(text, textLength))
+            {
+                break;
+            }
+
+            AppendTime(line, systemTime);
+            line += ' ';
+            line += text;
+        }
+        else
+        {
+            std::fprintf(stderr, "unknown frame type %u.\n", frameType);
+            return 1;
+        }
+
+        if (line.empty()) { continue; }
+
+        EndLine(line);
+        std::fwrite(line.data(), 1, line.size(), output);
+    }
+
+    std::fprintf(stderr, "%llu events decoded.\n", static_cast<unsigned long long>(eventCount));
+    return 0;
+}
+
+
+} // namespace /* unnamed */
+
+
+int main(int argc, char** argv)
+{
+    const Char* inputPath = nullptr;
+    const Char* outputPath = nullptr;
+    Bool withSource = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--source") == 0)
+        {
+            withSource = true;
+        }
+        else if (inputPath == nullptr)
+        {
+            inputPath = argv[i];
+        }
+        else
+        {
+            outputPath = argv[i];
+        }
+    }
+
+    if (inputPath == nullptr)
+    {
+        std::fprintf(stderr, "usage: CiderLogDecoder <input> [output] [--source]\n");
+        return 1;
+    }
+
+    std::FILE* input = nullptr;
+    if (fopen_s(&input, inputPath, "rb") != 0 || input == nullptr)
+    {
+        std::fprintf(stderr, "failed to open %s.\n", inputPath);
+        return 1;
+    }
+
+    std::FILE* output = stdout;
+    if (outputPath != nullptr && (fopen_s(&output, outputPath, "wb") != 0 || output == nullptr))
+    {
+        std::fprintf(stderr, "failed to open %s.\n", outputPath);
+        std::fclose(input);
+        return 1;
+    }
+
+    const Int32 result = Decode(input, output, withSource);
+
+    std::fclose(input);
+
+    if (output != stdout)
+    {
+        std::fclose(output);
+    }
+
+    return result;
+}
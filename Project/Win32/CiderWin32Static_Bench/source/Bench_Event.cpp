@@ -0,0 +1,518 @@
+﻿
+#include "Benchmark.hpp"
+#include "Cider.hpp"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+
+namespace Cider {
+namespace Bench {
+
+
+using System::SystemEvent;
+using System::SystemEventQueue;
+using System::SystemEventBus;
+
+
+// まとめられない (1 つずつ配送される) イベント
+struct QueuedEvent
+{
+    Double value;
+};
+
+
+// [eventCount]
+static Void Bench_EventQueue_Enqueue(State& state)
+{
+    const auto eventCount = static_cast<SizeT>(state.Range(0));
+
+    SystemEventQueue queue;
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < eventCount; ++i)
+        {
+            queue.Enqueue<QueuedEvent>(1.0);
+        }
+
+        state.PauseTiming();
+        queue.Emit();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * eventCount));
+}
+CIDER_BENCHMARK(Bench_EventQueue_Enqueue)
+    ->RangeMultiplier(10)->Range(10, 10000);
+
+
+// [eventCount]
+static Void Bench_EventQueue_EnqueueEmit(State& state)
+{
+    const auto eventCount = static_cast<SizeT>(state.Range(0));
+
+    SystemEventQueue queue;
+
+    Double total = 0.0;
+    System::ScopedConnection connection;
+    connection = queue.Connect([&total](const SystemEvent& eventObject) {
+        if (auto queuedEvent = eventObject.As<QueuedEvent>())
+        {
+            total += queuedEvent->value;
+        }
+    });
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < eventCount; ++i)
+        {
+            queue.Enqueue<QueuedEvent>(1.0);
+        }
+
+        queue.Emit();
+    }
+
+    DoNotOptimize(total);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * eventCount));
+}
+CIDER_BENCHMARK(Bench_EventQueue_EnqueueEmit)
+    ->RangeMultiplier(10)->Range(10, 10000);
+
+
+// 同じフレームに積まれた OnUpdate は 1 つにまとめられ、1 回だけ配送される
+// [eventCount]
+static Void Bench_EventQueue_EnqueueCoalesced(State& state)
+{
+    const auto eventCount = static_cast<SizeT>(state.Range(0));
+
+    SystemEventQueue queue;
+
+    Int64 received = 0;
+    System::ScopedConnection connection;
+    connection = queue.Connect([&received](const SystemEvent&) {
+        ++received;
+    });
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < eventCount; ++i)
+        {
+            queue.Enqueue<GameSystem::OnUpdate>(1.0);
+        }
+
+        queue.Emit();
+    }
+
+    if (received != static_cast<Int64>(state.Iterations()))
+    {
+        state.SkipWithError("OnUpdate was not coalesced.");
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * eventCount));
+}
+CIDER_BENCHMARK(Bench_EventQueue_EnqueueCoalesced)
+    ->RangeMultiplier(10)->Range(10, 10000);
+
+
+// 複数のスレッドから同時に Enqueue する
+// 1 反復で各スレッドが CONTENDED_BATCH_SIZE 個積み、全て配送されるまでを計測する
+// [producerCount]
+static Void Bench_EventQueue_ContendedEnqueue(State& state)
+{
+    constexpr Int64 CONTENDED_BATCH_SIZE = 1000;
+
+    const auto producerCount = static_cast<Int64>(state.Range(0));
+
+    SystemEventQueue queue;
+
+    Int64 received = 0;
+    System::ScopedConnection connection;
+    connection = queue.Connect([&received](const SystemEvent&) {
+        ++received;
+    });
+
+    std::atomic<UInt64> round { 0 };
+    std::atomic<Bool> stop { false };
+
+    std::vector<std::thread> producers;
+    for (Int64 i = 0; i < producerCount; ++i)
+    {
+        producers.emplace_back([&]() {
+            UInt64 observed = 0;
+
+            for (;;)
+            {
+                UInt64 current;
+                while ((current = round.load(std::memory_order_acquire)) == observed)
+                {
+                    if (stop.load(std::memory_order_relaxed))
+                    {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+                observed = current;
+
+                for (Int64 j = 0; j < CONTENDED_BATCH_SIZE; ++j)
+                {
+                    queue.Enqueue<QueuedEvent>(1.0);
+                }
+            }
+        });
+    }
+
+    Int64 expected = 0;
+
+    while (state.KeepRunning())
+    {
+        expected += producerCount * CONTENDED_BATCH_SIZE;
+        round.fetch_add(1, std::memory_order_release);
+
+        while (received < expected)
+        {
+            queue.Emit();
+        }
+    }
+
+    stop.store(true);
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    state.SetItemsProcessed(received);
+}
+CIDER_BENCHMARK(Bench_EventQueue_ContendedEnqueue)
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->Arg(32);
+
+
+// 容量の 10 倍を積んでから配送する (取り出しが追いつかない状況)
+// [overflow]
+static Void Bench_EventQueue_Overflow(State& state)
+{
+    constexpr SizeT CAPACITY = 1000;
+    constexpr SizeT EVENT_COUNT = CAPACITY * 10;
+
+    const auto overflow = static_cast<System::EVENT_OVERFLOW>(state.Range(0));
+
+    SystemEventQueue queue(CAPACITY, overflow);
+
+    Int64 received = 0;
+    System::ScopedConnection connection;
+    connection = queue.Connect([&received](const SystemEvent&) {
+        ++received;
+    });
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < EVENT_COUNT; ++i)
+        {
+            queue.Enqueue<QueuedEvent>(1.0);
+        }
+
+        queue.Emit();
+    }
+
+    const auto statistics = queue.GetStatistics();
+
+    static Char label[128];
+    std::snprintf(
+        label,
+        sizeof(label),
+        "received %lld dropped %llu (newest %llu) spilled %llu blocked %llu high-water %llu",
+        static_cast<long long>(received),
+        static_cast<unsigned long long>(statistics.droppedCount),
+        static_cast<unsigned long long>(statistics.droppedNewestCount),
+        static_cast<unsigned long long>(statistics.spilledCount),
+        static_cast<unsigned long long>(statistics.blockedCount),
+        static_cast<unsigned long long>(statistics.highWaterMark));
+    state.SetLabel(label);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * EVENT_COUNT));
+}
+CIDER_BENCHMARK(Bench_EventQueue_Overflow)
+    ->Arg(static_cast<Int64>(System::EVENT_OVERFLOW::BLOCK))
+    ->Arg(static_cast<Int64>(System::EVENT_OVERFLOW::DROP_NEWEST))
+    ->Arg(static_cast<Int64>(System::EVENT_OVERFLOW::DROP_OLDEST))
+    ->Arg(static_cast<Int64>(System::EVENT_OVERFLOW::SPILL));
+
+
+// 別のスレッドが容量の 10 倍を積み、配送するスレッドが空けるのを待つ (EVENT_OVERFLOW::BLOCK の待ち)
+static Void Bench_EventQueue_BlockProducer(State& state)
+{
+    constexpr SizeT CAPACITY = 1000;
+    constexpr Int64 EVENT_COUNT = CAPACITY * 10;
+
+    SystemEventQueue queue(CAPACITY, System::EVENT_OVERFLOW::BLOCK);
+
+    Int64 received = 0;
+    System::ScopedConnection connection;
+    connection = queue.Connect([&received](const SystemEvent&) {
+        ++received;
+    });
+
+    // 配送するスレッドを決めておく (最初の配送の前は待たずに積むため)
+    queue.Emit();
+
+    Int64 expected = 0;
+
+    while (state.KeepRunning())
+    {
+        expected += EVENT_COUNT;
+
+        std::thread producer([&queue] {
+            for (Int64 i = 0; i < EVENT_COUNT; ++i)
+            {
+                queue.Enqueue<QueuedEvent>(1.0);
+            }
+        });
+
+        while (received < expected)
+        {
+            queue.Emit();
+        }
+
+        producer.join();
+    }
+
+    const auto statistics = queue.GetStatistics();
+
+    static Char label[128];
+    std::snprintf(
+        label,
+        sizeof(label),
+        "blocked %llu high-water %llu",
+        static_cast<unsigned long long>(statistics.blockedCount),
+        static_cast<unsigned long long>(statistics.highWaterMark));
+    state.SetLabel(label);
+
+    state.SetItemsProcessed(received);
+}
+CIDER_BENCHMARK(Bench_EventQueue_BlockProducer);
+
+
+// 10 秒分 (600 フレーム) に散らした時間指定のイベントを積み、全て配送されるまでフレームを進める
+// 1 件あたりの時間は追加と期限切れの取り出しの合計
+// [timerCount]
+static Void Bench_EventQueue_Timers(State& state)
+{
+    constexpr UInt32 FRAME_COUNT = 600;
+
+    const auto timerCount = static_cast<SizeT>(state.Range(0));
+
+    SystemEventQueue queue;
+
+    Int64 received = 0;
+    System::ScopedConnection connection;
+    connection = queue.Connect([&received](const SystemEvent&) {
+        ++received;
+    });
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < timerCount; ++i)
+        {
+            queue.EnqueueAfterFrames<QueuedEvent>(static_cast<UInt32>(i * 7919 % FRAME_COUNT), 1.0);
+        }
+
+        for (UInt32 frame = 0; frame <= FRAME_COUNT; ++frame)
+        {
+            queue.Emit(1.0 / 60.0);
+        }
+    }
+
+    if (received != static_cast<Int64>(state.Iterations() * timerCount))
+    {
+        state.SkipWithError("timers were not delivered.");
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * timerCount));
+}
+CIDER_BENCHMARK(Bench_EventQueue_Timers)
+    ->RangeMultiplier(10)->Range(1000, 100000);
+
+
+// インラインに収まらないイベント
+struct LargeEvent
+{
+    Double values[8];
+};
+
+
+// 1 フレーム分の更新イベントを作って破棄する
+// [eventCount, large]
+static Void Bench_Event_Construct(State& state)
+{
+    const auto eventCount = static_cast<SizeT>(state.Range(0));
+    const Bool large = state.Range(1) != 0;
+
+    std::vector<SystemEvent> events;
+    events.reserve(eventCount);
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < eventCount; ++i)
+        {
+            if (large)
+            {
+                events.emplace_back(LargeEvent{});
+            }
+            else
+            {
+                events.emplace_back(GameSystem::OnUpdate{ 1.0 });
+            }
+        }
+
+        DoNotOptimize(events.data());
+        events.clear();
+    }
+
+    state.SetLabel(large ? "heap" : "inline");
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * eventCount));
+}
+CIDER_BENCHMARK(Bench_Event_Construct)
+    ->Args({ 1000, 0 })->Args({ 1000, 1 });
+
+
+// 判定方法の比較に使う OnStart / OnDestroy / OnUpdate を順に並べたイベント列
+// (Bench_Event_IsAsDispatch / VisitDispatch / Bench_EventBus_TypedDispatch で同じ入力を使う)
+static std::vector<SystemEvent> MakeLifecycleEvents()
+{
+    constexpr SizeT EVENT_COUNT = 1024;
+
+    std::vector<SystemEvent> events;
+    events.reserve(EVENT_COUNT);
+
+    for (SizeT i = 0; i < EVENT_COUNT; ++i)
+    {
+        switch (i % 3)
+        {
+        case 0: events.emplace_back(GameSystem::OnStart{}); break;
+        case 1: events.emplace_back(GameSystem::OnDestroy{}); break;
+        case 2: events.emplace_back(GameSystem::OnUpdate{ 1.0 }); break;
+        }
+    }
+
+    return events;
+}
+
+
+// TestComponentA::HandleEvent と同じ Is / As の連鎖による判定
+static Void Bench_Event_IsAsDispatch(State& state)
+{
+    const std::vector<SystemEvent> events = MakeLifecycleEvents();
+
+    Int32 startCount = 0;
+    Int32 destroyCount = 0;
+    Double total = 0.0;
+
+    while (state.KeepRunning())
+    {
+        for (const auto& eventObject : events)
+        {
+            if (eventObject.Is<GameSystem::OnStart>())
+            {
+                ++startCount;
+            }
+            else if (eventObject.Is<GameSystem::OnDestroy>())
+            {
+                ++destroyCount;
+            }
+            else if (auto onUpdate = eventObject.As<GameSystem::OnUpdate>())
+            {
+                total += onUpdate->deltaTime;
+            }
+        }
+    }
+
+    DoNotOptimize(startCount);
+    DoNotOptimize(destroyCount);
+    DoNotOptimize(total);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * events.size()));
+}
+CIDER_BENCHMARK(Bench_Event_IsAsDispatch);
+
+
+// Bench_Event_IsAsDispatch と同じイベント列を Visit で 1 回で判定する
+static Void Bench_Event_VisitDispatch(State& state)
+{
+    const std::vector<SystemEvent> events = MakeLifecycleEvents();
+
+    Int32 startCount = 0;
+    Int32 destroyCount = 0;
+    Double total = 0.0;
+
+    struct Visitor
+    {
+        Int32& startCount;
+        Int32& destroyCount;
+        Double& total;
+
+        Void operator()(const GameSystem::OnStart&) { ++startCount; }
+        Void operator()(const GameSystem::OnDestroy&) { ++destroyCount; }
+        Void operator()(const GameSystem::OnUpdate& onUpdate) { total += onUpdate.deltaTime; }
+    };
+
+    while (state.KeepRunning())
+    {
+        for (const auto& eventObject : events)
+        {
+            eventObject.Visit<GameSystem::OnStart, GameSystem::OnDestroy, GameSystem::OnUpdate>(
+                Visitor { startCount, destroyCount, total });
+        }
+    }
+
+    DoNotOptimize(startCount);
+    DoNotOptimize(destroyCount);
+    DoNotOptimize(total);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * events.size()));
+}
+CIDER_BENCHMARK(Bench_Event_VisitDispatch);
+
+
+// Bench_Event_IsAsDispatch と同じイベント列を型ごとの購読者へ配送する
+static Void Bench_EventBus_TypedDispatch(State& state)
+{
+    const std::vector<SystemEvent> events = MakeLifecycleEvents();
+
+    Int32 startCount = 0;
+    Int32 destroyCount = 0;
+    Double total = 0.0;
+
+    SystemEventBus eventBus;
+
+    System::ScopedConnection startConnection;
+    System::ScopedConnection destroyConnection;
+    System::ScopedConnection updateConnection;
+
+    startConnection = eventBus.Subscribe<GameSystem::OnStart>(
+        [&startCount](const GameSystem::OnStart&) { ++startCount; });
+    destroyConnection = eventBus.Subscribe<GameSystem::OnDestroy>(
+        [&destroyCount](const GameSystem::OnDestroy&) { ++destroyCount; });
+    updateConnection = eventBus.Subscribe<GameSystem::OnUpdate>(
+        [&total](const GameSystem::OnUpdate& onUpdate) { total += onUpdate.deltaTime; });
+
+    while (state.KeepRunning())
+    {
+        for (const auto& eventObject : events)
+        {
+            eventBus.Dispatch(eventObject);
+        }
+    }
+
+    DoNotOptimize(startCount);
+    DoNotOptimize(destroyCount);
+    DoNotOptimize(total);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * events.size()));
+}
+CIDER_BENCHMARK(Bench_EventBus_TypedDispatch);
+
+
+} // namespace Bench
+} // namespace Cider
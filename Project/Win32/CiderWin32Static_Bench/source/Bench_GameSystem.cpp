@@ -0,0 +1,351 @@
+﻿
+#include "Benchmark.hpp"
+#include "Cider.hpp"
+#include <algorithm>
+#include <random>
+#include <thread>
+
+
+namespace Cider {
+namespace GameSystem {
+
+
+class BenchComponent : public GameSystem::Component
+{
+public:
+    BenchComponent() = default;
+
+    ~BenchComponent() = default;
+
+    virtual Void RegisterEventHandlers(System::SystemEventBus& eventBus) override
+    {
+        SubscribeEvent<OnUpdate>(eventBus, [this](const OnUpdate& onUpdate) {
+            m_elapsedTime += onUpdate.deltaTime;
+        });
+    }
+
+    virtual const Char* GetComponentName() const override
+    {
+        return "BenchComponent";
+    }
+
+private:
+    Double m_elapsedTime = 0.0;
+};
+
+
+STL::shared_ptr<Component> CreateUserComponent(const Char* componentName)
+{
+    if (strcmp(componentName, "BenchComponent") == 0)
+    {
+        return STL::make_shared<BenchComponent>();
+    }
+
+    return nullptr;
+}
+
+
+// データコンポーネント
+struct BenchPosition
+{
+    Float x, y, z;
+};
+
+struct BenchVelocity
+{
+    Float x, y, z;
+};
+
+
+} // namespace GameSystem
+
+
+namespace Bench {
+
+
+using GameSystem::EntityManager;
+
+
+// [entityCount]
+static Void Bench_EntityManager_CreateDestroy(State& state)
+{
+    const auto entityCount = static_cast<SizeT>(state.Range(0));
+
+    auto entityManager = EntityManager::Instance();
+
+    std::vector<UInt64> entityIds;
+    entityIds.reserve(entityCount);
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < entityCount; ++i)
+        {
+            entityIds.push_back(entityManager->CreateEntity());
+        }
+
+        for (auto entityId : entityIds)
+        {
+            entityManager->DestroyEntity(entityId);
+        }
+
+        entityManager->DispatchEvent();
+
+        state.PauseTiming();
+        entityIds.clear();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * entityCount));
+}
+CIDER_BENCHMARK(Bench_EntityManager_CreateDestroy)
+    ->RangeMultiplier(10)->Range(100, 1000000);
+
+
+// ID からエンティティを引く費用 (生成順と無関係な順に引く)
+// 半分は破棄済みの ID で、世代の不一致で弾かれることを含めて計測する
+// [entityCount]
+static Void Bench_EntityManager_Lookup(State& state)
+{
+    const auto entityCount = static_cast<SizeT>(state.Range(0));
+
+    auto entityManager = EntityManager::Instance();
+
+    std::vector<UInt64> entityIds;
+    entityIds.reserve(entityCount);
+
+    for (SizeT i = 0; i < entityCount; ++i)
+    {
+        entityIds.push_back(entityManager->CreateEntity());
+    }
+
+    for (SizeT i = 0; i < entityCount; i += 2)
+    {
+        entityManager->DestroyEntity(entityIds[i]);
+    }
+    entityManager->DispatchEvent();
+
+    // 破棄したスロットを再利用させ、古い ID と新しい ID を混ぜる
+    for (SizeT i = 0; i < entityCount; i += 2)
+    {
+        entityIds.push_back(entityManager->CreateEntity());
+    }
+
+    std::mt19937 random(12345);
+    std::shuffle(std::begin(entityIds), std::end(entityIds), random);
+
+    SizeT aliveCount = 0;
+
+    while (state.KeepRunning())
+    {
+        for (auto entityId : entityIds)
+        {
+            aliveCount += entityManager->IsEntityAlive(entityId) ? 1 : 0;
+        }
+    }
+
+    DoNotOptimize(aliveCount);
+
+    for (auto entityId : entityIds)
+    {
+        entityManager->DestroyEntity(entityId);
+    }
+    entityManager->DispatchEvent();
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * entityIds.size()));
+}
+CIDER_BENCHMARK(Bench_EntityManager_Lookup)
+    ->RangeMultiplier(10)->Range(1000, 1000000);
+
+
+// [entityCount]
+static Void Bench_EntityManager_BroadcastDispatch(State& state)
+{
+    const auto entityCount = static_cast<SizeT>(state.Range(0));
+
+    auto entityManager = EntityManager::Instance();
+
+    std::vector<UInt64> entityIds;
+    entityIds.reserve(entityCount);
+
+    for (SizeT i = 0; i < entityCount; ++i)
+    {
+        auto entityId = entityManager->CreateEntity();
+        entityManager->RegisterComponent(entityId, "BenchComponent");
+        entityIds.push_back(entityId);
+    }
+
+    // OnStart を処理しておく
+    entityManager->DispatchEvent();
+
+    while (state.KeepRunning())
+    {
+        entityManager->BroadcastEvent(GameSystem::OnUpdate{ 1.0 / 60.0 });
+        entityManager->DispatchEvent();
+    }
+
+    for (auto entityId : entityIds)
+    {
+        entityManager->DestroyEntity(entityId);
+    }
+    entityManager->DispatchEvent();
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * entityCount));
+}
+CIDER_BENCHMARK(Bench_EntityManager_BroadcastDispatch)
+    ->RangeMultiplier(10)->Range(100, 1000000);
+
+
+// DISPATCH_MODE::PARALLEL の配送のスケーリング (BroadcastEvent は計測しない)
+// threadCount は DispatchEvent を呼ぶスレッドを含む
+// [entityCount, threadCount]
+static Void Bench_EntityManager_ParallelDispatch(State& state)
+{
+    const auto entityCount = static_cast<SizeT>(state.Range(0));
+    const auto threadCount = static_cast<SizeT>(state.Range(1));
+
+    if (threadCount > std::thread::hardware_concurrency())
+    {
+        state.SkipWithError("not enough hardware threads.");
+        return;
+    }
+
+    System::JobSystem jobSystem(threadCount - 1);
+
+    auto entityManager = EntityManager::Instance();
+    entityManager->SetDispatchMode(GameSystem::DISPATCH_MODE::PARALLEL, &jobSystem);
+
+    std::vector<UInt64> entityIds;
+    entityIds.reserve(entityCount);
+
+    for (SizeT i = 0; i < entityCount; ++i)
+    {
+        auto entityId = entityManager->CreateEntity();
+        entityManager->RegisterComponent(entityId, "BenchComponent");
+        entityIds.push_back(entityId);
+    }
+
+    // OnStart を処理しておく
+    entityManager->DispatchEvent();
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        entityManager->BroadcastEvent(GameSystem::OnUpdate{ 1.0 / 60.0 });
+        state.ResumeTiming();
+
+        entityManager->DispatchEvent(1.0 / 60.0);
+    }
+
+    for (auto entityId : entityIds)
+    {
+        entityManager->DestroyEntity(entityId);
+    }
+    entityManager->DispatchEvent();
+
+    entityManager->SetDispatchMode(GameSystem::DISPATCH_MODE::SERIAL);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * entityCount));
+}
+CIDER_BENCHMARK(Bench_EntityManager_ParallelDispatch)
+    ->Args({ 10000, 1 })->Args({ 10000, 2 })->Args({ 10000, 4 })->Args({ 10000, 8 })->Args({ 10000, 16 })
+    ->Args({ 100000, 1 })->Args({ 100000, 2 })->Args({ 100000, 4 })->Args({ 100000, 8 })->Args({ 100000, 16 })
+    ->Args({ 1000000, 1 })->Args({ 1000000, 2 })->Args({ 1000000, 4 })->Args({ 1000000, 8 })->Args({ 1000000, 16 });
+
+
+// データコンポーネントの ForEach (Bench_EntityManager_BroadcastDispatch の仮想関数の配送と比べる)
+// 半分のエンティティだけが速度を持ち、2 つのアーキタイプに分かれる
+// [entityCount]
+static Void Bench_EntityManager_ForEach(State& state)
+{
+    const auto entityCount = static_cast<SizeT>(state.Range(0));
+
+    auto entityManager = EntityManager::Instance();
+
+    std::vector<UInt64> entityIds;
+    entityIds.reserve(entityCount);
+
+    for (SizeT i = 0; i < entityCount; ++i)
+    {
+        auto entityId = entityManager->CreateEntity();
+        entityManager->AddDataComponent(entityId, GameSystem::BenchPosition{ 0.0f, 0.0f, 0.0f });
+
+        if (i % 2 == 0)
+        {
+            entityManager->AddDataComponent(entityId, GameSystem::BenchVelocity{ 1.0f, 2.0f, 3.0f });
+        }
+
+        entityIds.push_back(entityId);
+    }
+
+    const Float deltaTime = 1.0f / 60.0f;
+
+    while (state.KeepRunning())
+    {
+        entityManager->ForEach<GameSystem::BenchPosition, const GameSystem::BenchVelocity>(
+            [deltaTime](GameSystem::BenchPosition& position, const GameSystem::BenchVelocity& velocity) {
+            position.x += velocity.x * deltaTime;
+            position.y += velocity.y * deltaTime;
+            position.z += velocity.z * deltaTime;
+        }
+        );
+    }
+
+    DoNotOptimize(*entityManager->GetDataComponent<GameSystem::BenchPosition>(entityIds.front()));
+
+    for (auto entityId : entityIds)
+    {
+        entityManager->DestroyEntity(entityId);
+    }
+    entityManager->DispatchEvent();
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * (entityCount + 1) / 2));
+}
+CIDER_BENCHMARK(Bench_EntityManager_ForEach)
+    ->RangeMultiplier(10)->Range(100, 1000000);
+
+
+// 速度の追加と削除を繰り返し、行をアーキタイプ間で移す
+// [entityCount]
+static Void Bench_EntityManager_AddRemoveDataComponent(State& state)
+{
+    const auto entityCount = static_cast<SizeT>(state.Range(0));
+
+    auto entityManager = EntityManager::Instance();
+
+    std::vector<UInt64> entityIds;
+    entityIds.reserve(entityCount);
+
+    for (SizeT i = 0; i < entityCount; ++i)
+    {
+        auto entityId = entityManager->CreateEntity();
+        entityManager->AddDataComponent(entityId, GameSystem::BenchPosition{ 0.0f, 0.0f, 0.0f });
+        entityIds.push_back(entityId);
+    }
+
+    while (state.KeepRunning())
+    {
+        for (auto entityId : entityIds)
+        {
+            entityManager->AddDataComponent(entityId, GameSystem::BenchVelocity{ 1.0f, 2.0f, 3.0f });
+        }
+
+        for (auto entityId : entityIds)
+        {
+            entityManager->RemoveDataComponent<GameSystem::BenchVelocity>(entityId);
+        }
+    }
+
+    for (auto entityId : entityIds)
+    {
+        entityManager->DestroyEntity(entityId);
+    }
+    entityManager->DispatchEvent();
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * entityCount * 2));
+}
+CIDER_BENCHMARK(Bench_EntityManager_AddRemoveDataComponent)
+    ->RangeMultiplier(10)->Range(100, 100000);
+
+
+} // namespace Bench
+} // namespace Cider
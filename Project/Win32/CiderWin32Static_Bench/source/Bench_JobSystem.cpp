@@ -0,0 +1,120 @@
+﻿
+#include "Benchmark.hpp"
+#include "System.hpp"
+#include <atomic>
+#include <thread>
+
+
+namespace Cider {
+namespace Bench {
+
+
+using System::JobSystem;
+using System::JobCounter;
+
+
+// 何もしない小さなジョブを積んで待つ (確保と配送の費用)
+// threadCount は Wait を呼ぶスレッドを含む
+// [jobCount, threadCount]
+static Void Bench_JobSystem_SubmitWait(State& state)
+{
+    const auto jobCount = static_cast<SizeT>(state.Range(0));
+    const auto threadCount = static_cast<SizeT>(state.Range(1));
+
+    if (threadCount > std::thread::hardware_concurrency())
+    {
+        state.SkipWithError("not enough hardware threads.");
+        return;
+    }
+
+    JobSystem jobSystem(threadCount - 1);
+    std::atomic<SizeT> executedCount { 0 };
+
+    while (state.KeepRunning())
+    {
+        JobCounter counter;
+
+        for (SizeT i = 0; i < jobCount; ++i)
+        {
+            jobSystem.Submit([&executedCount] {
+                executedCount.fetch_add(1, std::memory_order_relaxed);
+            }, &counter);
+        }
+
+        jobSystem.Wait(counter);
+    }
+
+    DoNotOptimize(executedCount.load());
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * jobCount));
+}
+CIDER_BENCHMARK(Bench_JobSystem_SubmitWait)
+    ->Args({ 1000, 1 })->Args({ 1000, 4 })->Args({ 1000, 8 })
+    ->Args({ 100000, 1 })->Args({ 100000, 4 })->Args({ 100000, 8 });
+
+
+// 前のジョブの完了を待って次を積む直列の依存 (依存の解決の費用)
+// [chainLength]
+static Void Bench_JobSystem_DependencyChain(State& state)
+{
+    const auto chainLength = static_cast<SizeT>(state.Range(0));
+
+    JobSystem jobSystem(std::thread::hardware_concurrency() > 1 ? 1 : 0);
+    std::vector<JobCounter> counters(chainLength);
+    SizeT value = 0;
+
+    while (state.KeepRunning())
+    {
+        for (SizeT i = 0; i < chainLength; ++i)
+        {
+            jobSystem.Submit([&value] {
+                ++value;
+            }, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+        }
+
+        jobSystem.Wait(counters.back());
+    }
+
+    DoNotOptimize(value);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * chainLength));
+}
+CIDER_BENCHMARK(Bench_JobSystem_DependencyChain)
+    ->Arg(100)->Arg(10000);
+
+
+// [elementCount, threadCount]
+static Void Bench_JobSystem_ParallelFor(State& state)
+{
+    const auto elementCount = static_cast<SizeT>(state.Range(0));
+    const auto threadCount = static_cast<SizeT>(state.Range(1));
+
+    if (threadCount > std::thread::hardware_concurrency())
+    {
+        state.SkipWithError("not enough hardware threads.");
+        return;
+    }
+
+    JobSystem jobSystem(threadCount - 1);
+    std::vector<Double> values(elementCount, 1.0);
+
+    while (state.KeepRunning())
+    {
+        jobSystem.ParallelFor(elementCount, 4096, [&values](SizeT begin, SizeT end) {
+            for (SizeT i = begin; i < end; ++i)
+            {
+                values[i] = values[i] * 1.000001 + 0.5;
+            }
+        });
+    }
+
+    DoNotOptimize(values.front());
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * elementCount));
+}
+CIDER_BENCHMARK(Bench_JobSystem_ParallelFor)
+    ->Args({ 1000000, 1 })->Args({ 1000000, 2 })->Args({ 1000000, 4 })->Args({ 1000000, 8 })->Args({ 1000000, 16 });
+
+
+} // namespace Bench
+} // namespace Cider
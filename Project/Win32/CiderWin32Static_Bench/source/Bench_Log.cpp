@@ -0,0 +1,252 @@
+﻿
+#include "Benchmark.hpp"
+#include "System.hpp"
+#include <cstring>
+
+
+namespace Cider {
+namespace Bench {
+
+
+using System::Log;
+
+
+// 呼び出し側のコスト [batchCount]
+// (リングバッファが溢れないよう、一定件数ごとに計測を止めて出力を待つ)
+static Void Bench_Log_Format(State& state)
+{
+    const Int64 batchCount = state.Range(0);
+    Int64 count = 0;
+
+    while (state.KeepRunning())
+    {
+        Log::Format(Log::Debug, "Bench_Log_Format { index=%lld, name=%s }", count, "Cider");
+
+        if (++count % batchCount == 0)
+        {
+            state.PauseTiming();
+            Log::Flush();
+            state.ResumeTiming();
+        }
+    }
+
+    Log::Flush();
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_Log_Format)
+    ->Arg(64)->Arg(1024);
+
+
+// 出力完了までのスループット [messageCount]
+static Void Bench_Log_FormatFlush(State& state)
+{
+    const Int64 messageCount = state.Range(0);
+
+    System::MemoryLogSink sink(64 * 1024);
+    Log::AddSink(&sink);
+
+    while (state.KeepRunning())
+    {
+        for (Int64 i = 0; i < messageCount; ++i)
+        {
+            Log::Format(Log::Debug, "Bench_Log_FormatFlush { index=%lld, value=%lf }", i, 0.5);
+        }
+
+        Log::Flush();
+    }
+
+    Log::RemoveSink(&sink);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()) * messageCount);
+}
+CIDER_BENCHMARK(Bench_Log_FormatFlush)
+    ->Arg(1)->Arg(100)->Arg(1000);
+
+
+// バイナリログの呼び出し側のコスト [batchCount]
+static Void Bench_Log_Binary(State& state)
+{
+    const Int64 batchCount = state.Range(0);
+    Int64 count = 0;
+
+    System::BinaryFileLogSink sink;
+    sink.Open("Bench_Log_Binary.clog");
+    Log::AddSink(&sink);
+
+    while (state.KeepRunning())
+    {
+        CIDER_LOG_BINARY(Info, "Bench_Log_Binary { index=%lld, name=%s }", count, "Cider");
+
+        if (++count % batchCount == 0)
+        {
+            state.PauseTiming();
+            Log::Flush();
+            state.ResumeTiming();
+        }
+    }
+
+    Log::Flush();
+    Log::RemoveSink(&sink);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_Log_Binary)
+    ->Arg(64)->Arg(1024);
+
+
+// ペイロードに収まらない長い文字列の後ろに固定長の引数を続ける (切り詰めの確認を兼ねる) [batchCount]
+static Void Bench_Log_BinaryLongStrings(State& state)
+{
+    const Int64 batchCount = state.Range(0);
+    Int64 count = 0;
+
+    Char longText1[600];
+    Char longText2[600];
+    std::memset(longText1, 'a', sizeof(longText1) - 1);
+    std::memset(longText2, 'b', sizeof(longText2) - 1);
+    longText1[sizeof(longText1) - 1] = '\0';
+    longText2[sizeof(longText2) - 1] = '\0';
+
+    System::BinaryFileLogSink sink;
+    sink.Open("Bench_Log_BinaryLongStrings.clog");
+    Log::AddSink(&sink);
+
+    while (state.KeepRunning())
+    {
+        CIDER_LOG_BINARY(Info, "Bench_Log_BinaryLongStrings { %s, %s, index=%lld, value=%d }", longText1, longText2, count, 123);
+
+        if (++count % batchCount == 0)
+        {
+            state.PauseTiming();
+            Log::Flush();
+            state.ResumeTiming();
+        }
+    }
+
+    Log::Flush();
+    Log::RemoveSink(&sink);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_Log_BinaryLongStrings)
+    ->Arg(64);
+
+
+// ファイルシンク単体の書き込み性能 [bufferSize]
+static Void Bench_Log_RotatingFileWrite(State& state)
+{
+    System::RotatingFileLogSink::Settings settings;
+    settings.path = "Bench_Log_RotatingFile.log";
+    settings.bufferSize = static_cast<SizeT>(state.Range(0));
+    settings.maxFileSize = 64 * 1024 * 1024;
+    settings.maxBackupCount = 1;
+
+    System::RotatingFileLogSink sink;
+    sink.Open(settings);
+
+    static const Char s_line[] = "【Info】\nBench_Log_RotatingFileWrite { index=123456, value=0.250000 }\n";
+
+    System::LogEntry entry;
+    entry.level = Log::Info;
+    entry.hasLevel = true;
+    entry.timestamp = Log::GetTimestamp();
+    entry.category = nullptr;
+    entry.text = s_line;
+    entry.length = sizeof(s_line) - 1;
+
+    while (state.KeepRunning())
+    {
+        sink.Write(entry);
+    }
+
+    sink.Flush();
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+    state.SetBytesProcessed(static_cast<Int64>(state.Iterations() * entry.length));
+}
+CIDER_BENCHMARK(Bench_Log_RotatingFileWrite)
+    ->Arg(4 * 1024)->Arg(64 * 1024)->Arg(1024 * 1024);
+
+
+// 書式化からファイル出力までのスループット [messageCount]
+static Void Bench_Log_RotatingFilePipeline(State& state)
+{
+    const Int64 messageCount = state.Range(0);
+
+    System::RotatingFileLogSink::Settings settings;
+    settings.path = "Bench_Log_RotatingFile.log";
+    settings.maxBackupCount = 1;
+
+    System::RotatingFileLogSink sink;
+    sink.Open(settings);
+    Log::AddSink(&sink);
+
+    // 破棄せずにすべて書き込んだ場合の値を計測する
+    const Log::OverflowPolicy policy = Log::GetOverflowPolicy();
+    Log::SetOverflowPolicy(Log::OverflowPolicy::Block);
+
+    while (state.KeepRunning())
+    {
+        for (Int64 i = 0; i < messageCount; ++i)
+        {
+            Log::Format("Bench_Log_RotatingFilePipeline { index=%lld, value=%lf }\n", i, 0.25);
+        }
+
+        Log::Flush();
+    }
+
+    Log::SetOverflowPolicy(policy);
+    Log::RemoveSink(&sink);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()) * messageCount);
+}
+CIDER_BENCHMARK(Bench_Log_RotatingFilePipeline)
+    ->Arg(1000)->Arg(100000);
+
+
+namespace {
+
+CIDER_LOG_DEFINE_CATEGORY(BenchLog, Error);
+
+} // namespace /* unnamed */
+
+
+// 実行時にカテゴリの閾値で弾かれるログ
+static Void Bench_Log_DisabledCategory(State& state)
+{
+    Int64 count = 0;
+
+    while (state.KeepRunning())
+    {
+        CIDER_LOG_CATEGORY(BenchLog, Debug, "Bench_Log_DisabledCategory { index=%lld }", count);
+        ++count;
+    }
+
+    DoNotOptimize(count);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_Log_DisabledCategory);
+
+
+// CIDER_LOG_MIN_LEVEL 未満でコンパイル時に取り除かれるログ (Release では空ループと同等)
+static Void Bench_Log_CompiledOut(State& state)
+{
+    Int64 count = 0;
+
+    while (state.KeepRunning())
+    {
+        CIDER_LOG(Verbose, "Bench_Log_CompiledOut { index=%lld }", count);
+        ++count;
+    }
+
+    DoNotOptimize(count);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_Log_CompiledOut);
+
+
+} // namespace Bench
+} // namespace Cider
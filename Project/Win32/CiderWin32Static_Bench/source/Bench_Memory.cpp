@@ -0,0 +1,92 @@
+﻿
+#include "Benchmark.hpp"
+#include "System.hpp"
+
+
+namespace Cider {
+namespace Bench {
+
+
+using System::MemoryManager;
+using System::MEMORY_AREA;
+
+
+// [area, bytes]
+static Void Bench_MemoryManager_MallocFree(State& state)
+{
+    const auto area = static_cast<MEMORY_AREA>(state.Range(0));
+    const auto bytes = static_cast<SizeT>(state.Range(1));
+
+    while (state.KeepRunning())
+    {
+        Void* memory = MemoryManager::Malloc(area, bytes);
+        DoNotOptimize(memory);
+        MemoryManager::Free(area, memory);
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_MemoryManager_MallocFree)
+    ->Args({ static_cast<Int64>(MEMORY_AREA::STL), 16 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::STL), 256 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::STL), 4096 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::STL), 65536 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::SYSTEM), 16 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::SYSTEM), 256 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::SYSTEM), 4096 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::SYSTEM), 65536 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::APPLICATION), 16 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::APPLICATION), 256 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::APPLICATION), 4096 })
+    ->Args({ static_cast<Int64>(MEMORY_AREA::APPLICATION), 65536 });
+
+
+// [bytes]
+static Void Bench_MemoryManager_MallocDebugFree(State& state)
+{
+    const auto bytes = static_cast<SizeT>(state.Range(0));
+
+    while (state.KeepRunning())
+    {
+        Void* memory = MemoryManager::MallocDebug(__FILE__, __LINE__, MEMORY_AREA::SYSTEM, bytes);
+        DoNotOptimize(memory);
+        MemoryManager::Free(MEMORY_AREA::SYSTEM, memory);
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_MemoryManager_MallocDebugFree)
+    ->RangeMultiplier(16)->Range(16, 65536);
+
+
+// デバッグ情報テーブルに [count] 件の確保が残っている状態での確保・解放
+static Void Bench_MemoryManager_MallocDebugFree_Live(State& state)
+{
+    const auto liveCount = static_cast<SizeT>(state.Range(0));
+
+    std::vector<Void*> liveMemories(liveCount, nullptr);
+    for (auto& memory : liveMemories)
+    {
+        memory = MemoryManager::MallocDebug(__FILE__, __LINE__, MEMORY_AREA::SYSTEM, 64);
+    }
+
+    while (state.KeepRunning())
+    {
+        Void* memory = MemoryManager::MallocDebug(__FILE__, __LINE__, MEMORY_AREA::SYSTEM, 64);
+        DoNotOptimize(memory);
+        MemoryManager::Free(MEMORY_AREA::SYSTEM, memory);
+    }
+
+    for (auto memory : liveMemories)
+    {
+        MemoryManager::Free(MEMORY_AREA::SYSTEM, memory);
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_MemoryManager_MallocDebugFree_Live)
+    ->Arg(0)->Arg(64)->Arg(256)->Arg(768);
+
+
+} // namespace Bench
+} // namespace Cider
@@ -0,0 +1,500 @@
+﻿
+#include "Benchmark.hpp"
+#include "System.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+
+namespace Cider {
+namespace Bench {
+
+
+using System::Signal;
+using System::Connection;
+using System::Delegate;
+using System::SumCombiner;
+using System::FirstTrueCombiner;
+using System::Mailbox;
+
+
+// [slotCount]
+static Void Bench_Signal_ConnectDisconnect(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    std::vector<Connection> connections;
+    connections.reserve(slotCount);
+
+    while (state.KeepRunning())
+    {
+        Signal<Void(Int32)> signal;
+
+        for (SizeT i = 0; i < slotCount; ++i)
+        {
+            connections.push_back(signal.Connect([](Int32 value) { DoNotOptimize(value); }));
+        }
+
+        for (auto& connection : connections)
+        {
+            connection.Disconnect();
+        }
+
+        state.PauseTiming();
+        connections.clear();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * slotCount));
+}
+CIDER_BENCHMARK(Bench_Signal_ConnectDisconnect)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+// 別スレッドが発行し続けている間に 100k 回接続・切断する
+// 切断の費用が既存のスロット数によらないこと、終了後に既存のスロットだけが残ることを確認する
+// [slotCount]
+static Void Bench_Signal_ConnectDisconnectDuringEmit(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Void(Int32)> signal;
+    std::vector<Connection> connections;
+
+    std::atomic<Int64> counter { 0 };
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        connections.push_back(signal.Connect([&counter](Int32 value) {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        }));
+    }
+
+    std::atomic<Bool> stop { false };
+    std::atomic<Int64> emitCount { 0 };
+
+    std::thread emitter([&]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            signal(1);
+            emitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    while (state.KeepRunning())
+    {
+        auto connection = signal.Connect([](Int32 value) { DoNotOptimize(value); });
+        connection.Disconnect();
+    }
+
+    stop.store(true);
+    emitter.join();
+
+    if (signal.InvocationCount() != slotCount)
+    {
+        state.SkipWithError("disconnected slots remain in the signal.");
+    }
+
+    DoNotOptimize(counter.load());
+
+    static Char label[64];
+    std::snprintf(label, sizeof(label), "emits %lld", static_cast<long long>(emitCount.load()));
+    state.SetLabel(label);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_Signal_ConnectDisconnectDuringEmit)
+    ->Arg(1)->Arg(10)->Arg(1000)->Iterations(100000);
+
+
+// [slotCount]
+static Void Bench_Signal_Emit(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Void(Int32)> signal;
+    std::vector<Connection> connections;
+
+    Int32 counter = 0;
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        connections.push_back(signal.Connect([&counter](Int32 value) { counter += value; }));
+    }
+
+    while (state.KeepRunning())
+    {
+        signal(1);
+    }
+
+    DoNotOptimize(counter);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * slotCount));
+}
+CIDER_BENCHMARK(Bench_Signal_Emit)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+struct SignalReceiver
+{
+    Void OnValue(Int32 value)
+    {
+        counter += value;
+    }
+
+    Int32 counter = 0;
+};
+
+// [slotCount]
+static Void Bench_Signal_EmitMember(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Void(Int32)> signal;
+    std::vector<Connection> connections;
+
+    SignalReceiver receiver;
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        connections.push_back(signal.Connect(
+            Delegate<Void(Int32)>::Bind<&SignalReceiver::OnValue>(&receiver)));
+    }
+
+    while (state.KeepRunning())
+    {
+        signal(1);
+    }
+
+    DoNotOptimize(receiver.counter);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * slotCount));
+}
+CIDER_BENCHMARK(Bench_Signal_EmitMember)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+// 8 グループに分けて接続し、奇数グループを無効にする
+// [slotCount]
+static Void Bench_Signal_EmitGrouped(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Void(Int32)> signal;
+    std::vector<Connection> connections;
+
+    Int32 counter = 0;
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        const auto group = static_cast<System::SlotGroup>(i % 8);
+        connections.push_back(signal.Connect(group, [&counter](Int32 value) { counter += value; }));
+    }
+
+    for (System::SlotGroup group = 1; group < 8; group += 2)
+    {
+        signal.SetGroupEnabled(group, false);
+    }
+
+    while (state.KeepRunning())
+    {
+        signal(1);
+    }
+
+    DoNotOptimize(counter);
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * slotCount));
+}
+CIDER_BENCHMARK(Bench_Signal_EmitGrouped)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+// [slotCount]
+static Void Bench_Signal_EmitResult(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Int32(Int32)> signal;
+    std::vector<Connection> connections;
+
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        connections.push_back(signal.Connect([](Int32 value) { return value + 1; }));
+    }
+
+    while (state.KeepRunning())
+    {
+        auto results = signal(1);
+        DoNotOptimize(results);
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * slotCount));
+}
+CIDER_BENCHMARK(Bench_Signal_EmitResult)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+// [slotCount]
+static Void Bench_Signal_EmitResultReuse(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Int32(Int32)> signal;
+    std::vector<Connection> connections;
+
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        connections.push_back(signal.Connect([](Int32 value) { return value + 1; }));
+    }
+
+    Signal<Int32(Int32)>::ResultArray results;
+    results.reserve(slotCount);
+
+    while (state.KeepRunning())
+    {
+        signal.Emit(results, 1);
+        DoNotOptimize(results.data());
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * slotCount));
+}
+CIDER_BENCHMARK(Bench_Signal_EmitResultReuse)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+// [slotCount]
+static Void Bench_Signal_EmitSum(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Int32(Int32), SumCombiner<Int32>> signal;
+    std::vector<Connection> connections;
+
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        connections.push_back(signal.Connect([](Int32 value) { return value + 1; }));
+    }
+
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(signal(1));
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * slotCount));
+}
+CIDER_BENCHMARK(Bench_Signal_EmitSum)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+// 中央のスロットで打ち切る拒否権付きの問い合わせ
+// [slotCount]
+static Void Bench_Signal_EmitFirstTrue(State& state)
+{
+    const auto slotCount = static_cast<SizeT>(state.Range(0));
+
+    Signal<Bool(Int32), FirstTrueCombiner<Bool>> signal;
+    std::vector<Connection> connections;
+
+    for (SizeT i = 0; i < slotCount; ++i)
+    {
+        const auto veto = static_cast<Int32>(i);
+        connections.push_back(signal.Connect([veto](Int32 value) { return value == veto; }));
+    }
+
+    const auto vetoIndex = static_cast<Int32>(slotCount / 2);
+
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(signal(Int32 { vetoIndex }));
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * (slotCount / 2 + 1)));
+}
+CIDER_BENCHMARK(Bench_Signal_EmitFirstTrue)
+    ->Arg(1)->Arg(10)->Arg(1000);
+
+
+
+namespace {
+
+constexpr Int64 QUEUED_BATCH_SIZE = 1000;
+
+Int64 GetQueuedTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+
+// 複数のワーカースレッドから 1 つの受け取りスレッドへ (N → 1)
+// 1 反復で各ワーカーが QUEUED_BATCH_SIZE 回発行し、全て配送されるまでを計測する
+// [producerCount]
+static Void Bench_Signal_QueuedManyToOne(State& state)
+{
+    const auto producerCount = static_cast<Int64>(state.Range(0));
+
+    Mailbox mailbox(4096);
+    Signal<Void(Int64)> signal;
+
+    Int64 received = 0;
+    Int64 latencyTotal = 0;
+
+    auto connection = signal.Connect(mailbox, [&](Int64 timestamp) {
+        latencyTotal += GetQueuedTimestamp() - timestamp;
+        ++received;
+    });
+
+    std::atomic<UInt64> round { 0 };
+    std::atomic<Bool> stop { false };
+
+    std::vector<std::thread> producers;
+    for (Int64 i = 0; i < producerCount; ++i)
+    {
+        producers.emplace_back([&]() {
+            UInt64 observed = 0;
+
+            for (;;)
+            {
+                UInt64 current;
+                while ((current = round.load(std::memory_order_acquire)) == observed)
+                {
+                    if (stop.load(std::memory_order_relaxed))
+                    {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+                observed = current;
+
+                for (Int64 j = 0; j < QUEUED_BATCH_SIZE; ++j)
+                {
+                    signal(GetQueuedTimestamp());
+                }
+            }
+        });
+    }
+
+    Int64 expected = 0;
+
+    while (state.KeepRunning())
+    {
+        expected += producerCount * QUEUED_BATCH_SIZE;
+        round.fetch_add(1, std::memory_order_release);
+
+        while (received < expected)
+        {
+            if (mailbox.Dispatch() == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    stop.store(true);
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    connection.Disconnect();
+
+    static Char label[64];
+    std::snprintf(label, sizeof(label), "latency %lld ns", static_cast<long long>(latencyTotal / (received > 0 ? received : 1)));
+    state.SetLabel(label);
+
+    state.SetItemsProcessed(received);
+}
+CIDER_BENCHMARK(Bench_Signal_QueuedManyToOne)
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+
+// 1 つの発行スレッドから複数の受け取りスレッドへ (1 → N)
+// 1 反復で QUEUED_BATCH_SIZE 回発行し、全ての受け取りスレッドに配送されるまでを計測する
+// [consumerCount]
+static Void Bench_Signal_QueuedOneToMany(State& state)
+{
+    const auto consumerCount = static_cast<SizeT>(state.Range(0));
+
+    struct Consumer
+    {
+        Mailbox             mailbox { 4096 };
+        std::atomic<Int64>  received { 0 };
+        Int64               latencyTotal = 0;
+        std::thread         thread;
+    };
+
+    Signal<Void(Int64)> signal;
+    std::vector<std::unique_ptr<Consumer>> consumers;
+    std::vector<Connection> connections;
+    std::atomic<Bool> stop { false };
+
+    for (SizeT i = 0; i < consumerCount; ++i)
+    {
+        consumers.push_back(std::make_unique<Consumer>());
+
+        Consumer* consumer = consumers.back().get();
+
+        connections.push_back(signal.Connect(consumer->mailbox, [consumer](Int64 timestamp) {
+            consumer->latencyTotal += GetQueuedTimestamp() - timestamp;
+            consumer->received.fetch_add(1, std::memory_order_release);
+        }));
+
+        consumer->thread = std::thread([consumer, &stop]() {
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if (consumer->mailbox.Dispatch() == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    Int64 expected = 0;
+
+    while (state.KeepRunning())
+    {
+        for (Int64 i = 0; i < QUEUED_BATCH_SIZE; ++i)
+        {
+            signal(GetQueuedTimestamp());
+        }
+
+        expected += QUEUED_BATCH_SIZE;
+
+        for (auto& consumer : consumers)
+        {
+            while (consumer->received.load(std::memory_order_acquire) < expected)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    stop.store(true);
+
+    Int64 latencyTotal = 0;
+    for (auto& consumer : consumers)
+    {
+        consumer->thread.join();
+        latencyTotal += consumer->latencyTotal;
+    }
+
+    for (auto& connection : connections)
+    {
+        connection.Disconnect();
+    }
+
+    const Int64 delivered = expected * static_cast<Int64>(consumerCount);
+
+    static Char label[64];
+    std::snprintf(label, sizeof(label), "latency %lld ns", static_cast<long long>(latencyTotal / (delivered > 0 ? delivered : 1)));
+    state.SetLabel(label);
+
+    state.SetItemsProcessed(delivered);
+}
+CIDER_BENCHMARK(Bench_Signal_QueuedOneToMany)
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+
+} // namespace Bench
+} // namespace Cider
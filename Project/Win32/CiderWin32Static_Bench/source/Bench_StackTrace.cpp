@@ -0,0 +1,71 @@
+﻿
+#include "Benchmark.hpp"
+#include "System.hpp"
+
+
+namespace Cider {
+namespace Bench {
+
+
+using System::StackTrace;
+
+
+// [maxDepth]
+static Void Bench_StackTrace_CaptureHash(State& state)
+{
+    const auto maxDepth = static_cast<UInt32>(state.Range(0));
+
+    while (state.KeepRunning())
+    {
+        UInt64 hash = StackTrace::CaptureStackTraceHash(0, maxDepth);
+        DoNotOptimize(hash);
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_StackTrace_CaptureHash)
+    ->Arg(4)->Arg(16)->Arg(StackTrace::MAX_DEPTH);
+
+
+// [maxDepth]
+static Void Bench_StackTrace_CaptureId(State& state)
+{
+    const auto maxDepth = static_cast<UInt32>(state.Range(0));
+
+    while (state.KeepRunning())
+    {
+        StackTrace::StackId stackId = StackTrace::CaptureStackTraceId(0, maxDepth);
+        DoNotOptimize(stackId);
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations()));
+}
+CIDER_BENCHMARK(Bench_StackTrace_CaptureId)
+    ->Arg(4)->Arg(16)->Arg(StackTrace::MAX_DEPTH);
+
+
+// キャッシュ済みアドレスのシンボル解決
+static Void Bench_StackTrace_SymbolizeCached(State& state)
+{
+    Void* backTrace[StackTrace::MAX_DEPTH];
+    const UInt32 depth = StackTrace::CaptureBackTrace(backTrace, 0, StackTrace::MAX_DEPTH);
+
+    const StackTrace::StackId stackId = StackTrace::InternBackTrace(backTrace, depth);
+    StackTrace::SymbolizeStackTraces(&stackId, 1);
+
+    while (state.KeepRunning())
+    {
+        for (UInt32 i = 0; i < depth; ++i)
+        {
+            auto symbol = StackTrace::Symbolize(backTrace[i]);
+            DoNotOptimize(symbol);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<Int64>(state.Iterations() * depth));
+}
+CIDER_BENCHMARK(Bench_StackTrace_SymbolizeCached);
+
+
+} // namespace Bench
+} // namespace Cider
@@ -0,0 +1,453 @@
+﻿
+#include "Benchmark.hpp"
+#include <Windows.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#pragma comment(lib, "CiderWin32Static.lib")
+
+
+namespace {
+
+
+using namespace Cider;
+
+
+constexpr Double DEFAULT_MIN_TIME = 0.5;
+constexpr UInt64 MAX_ITERATIONS = 1000000000;
+
+
+Double GetThreadCpuSeconds()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+
+    if (!::GetThreadTimes(::GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        return 0.0;
+    }
+
+    auto toSeconds = [](const FILETIME& time) -> Double {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return static_cast<Double>(value.QuadPart) * 1e-7;
+    };
+
+    return toSeconds(kernelTime) + toSeconds(userTime);
+}
+
+
+std::vector<Bench::Benchmark*>& GetBenchmarks()
+{
+    static std::vector<Bench::Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+
+struct RunResult
+{
+    std::string name;
+    UInt64      iterations;
+    Double      realTime;   // ns / iteration
+    Double      cpuTime;    // ns / iteration
+    Double      itemsPerSecond;
+    Double      bytesPerSecond;
+    std::string label;
+    std::string errorMessage;
+};
+
+
+std::string MakeRunName(const Bench::Benchmark& benchmark, const std::vector<Int64>& args)
+{
+    std::string name = benchmark.Name();
+
+    for (auto arg : args)
+    {
+        name += "/";
+        name += std::to_string(arg);
+    }
+
+    return name;
+}
+
+
+RunResult RunBenchmark(const Bench::Benchmark& benchmark, const std::vector<Int64>& args)
+{
+    RunResult result = {};
+    result.name = MakeRunName(benchmark, args);
+
+    const Double minTime = benchmark.MinTimeSeconds();
+    UInt64 iterations = benchmark.FixedIterations() > 0 ? benchmark.FixedIterations() : 1;
+
+    for (;;)
+    {
+        Bench::State state(iterations, args);
+
+        benchmark.Function()(state);
+
+        if (state.ErrorMessage())
+        {
+            result.iterations = iterations;
+            result.errorMessage = state.ErrorMessage();
+            return result;
+        }
+
+        const Double seconds = state.ElapsedRealSeconds();
+
+        // 計測時間が十分に得られたら結果を確定する
+        if (benchmark.FixedIterations() > 0 || seconds >= minTime || iterations >= MAX_ITERATIONS)
+        {
+            const Double n = static_cast<Double>(iterations);
+
+            result.iterations = iterations;
+            result.realTime = seconds * 1e9 / n;
+            result.cpuTime = state.ElapsedCpuSeconds() * 1e9 / n;
+            result.itemsPerSecond = seconds > 0.0 ? static_cast<Double>(state.ItemsProcessed()) / seconds : 0.0;
+            result.bytesPerSecond = seconds > 0.0 ? static_cast<Double>(state.BytesProcessed()) / seconds : 0.0;
+            result.label = state.Label() ? state.Label() : "";
+            return result;
+        }
+
+        // 次の試行回数を予測する (Google Benchmark と同じ方針)
+        Double multiplier = minTime * 1.4 / std::max(seconds, 1e-9);
+        if (seconds / minTime <= 0.1)
+        {
+            multiplier = std::min(multiplier, 10.0);
+        }
+        multiplier = std::max(multiplier, 2.0);
+
+        UInt64 next = static_cast<UInt64>(std::ceil(static_cast<Double>(iterations) * multiplier));
+        iterations = std::min(std::max(next, iterations + 1), MAX_ITERATIONS);
+    }
+}
+
+
+Void PrintConsole(const RunResult& result)
+{
+    if (!result.errorMessage.empty())
+    {
+        std::printf("%-60s ERROR: %s\n", result.name.c_str(), result.errorMessage.c_str());
+        return;
+    }
+
+    std::printf(
+        "%-60s %14.1f ns %14.1f ns %12llu",
+        result.name.c_str(),
+        result.realTime,
+        result.cpuTime,
+        result.iterations
+    );
+
+    if (result.itemsPerSecond > 0.0)
+    {
+        std::printf(" items_per_second=%.4g/s", result.itemsPerSecond);
+    }
+
+    if (result.bytesPerSecond > 0.0)
+    {
+        std::printf(" bytes_per_second=%.4g/s", result.bytesPerSecond);
+    }
+
+    if (!result.label.empty())
+    {
+        std::printf(" %s", result.label.c_str());
+    }
+
+    std::printf("\n");
+}
+
+
+std::string EscapeJson(const std::string& text)
+{
+    std::string escaped;
+
+    for (auto c : text)
+    {
+        switch (c)
+        {
+        case '"':  escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        default:   escaped += c; break;
+        }
+    }
+
+    return escaped;
+}
+
+
+Bool WriteJson(const Char* path, const std::vector<RunResult>& results)
+{
+    FILE* file = nullptr;
+    if (fopen_s(&file, path, "w") != 0 || file == nullptr)
+    {
+        std::printf("failed to open '%s'\n", path);
+        return false;
+    }
+
+    Char dateBuffer[64];
+    {
+        time_t t = std::time(nullptr);
+        tm localTime;
+        localtime_s(&localTime, &t);
+        strftime(dateBuffer, sizeof(dateBuffer), "%Y-%m-%dT%H:%M:%S", &localTime);
+    }
+
+    SYSTEM_INFO systemInfo;
+    ::GetSystemInfo(&systemInfo);
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"context\": {\n");
+    std::fprintf(file, "    \"date\": \"%s\",\n", dateBuffer);
+    std::fprintf(file, "    \"executable\": \"CiderWin32Static_Bench\",\n");
+    std::fprintf(file, "    \"num_cpus\": %lu,\n", systemInfo.dwNumberOfProcessors);
+#if defined(CIDER_BUILD_DEBUG)
+    std::fprintf(file, "    \"library_build_type\": \"debug\"\n");
+#else
+    std::fprintf(file, "    \"library_build_type\": \"release\"\n");
+#endif
+    std::fprintf(file, "  },\n");
+    std::fprintf(file, "  \"benchmarks\": [\n");
+
+    for (SizeT i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        const auto name = EscapeJson(result.name);
+
+        std::fprintf(file, "    {\n");
+        std::fprintf(file, "      \"name\": \"%s\",\n", name.c_str());
+        std::fprintf(file, "      \"run_name\": \"%s\",\n", name.c_str());
+        std::fprintf(file, "      \"run_type\": \"iteration\",\n");
+
+        if (!result.errorMessage.empty())
+        {
+            std::fprintf(file, "      \"error_occurred\": true,\n");
+            std::fprintf(file, "      \"error_message\": \"%s\",\n", EscapeJson(result.errorMessage).c_str());
+        }
+
+        if (result.itemsPerSecond > 0.0)
+        {
+            std::fprintf(file, "      \"items_per_second\": %.17g,\n", result.itemsPerSecond);
+        }
+
+        if (result.bytesPerSecond > 0.0)
+        {
+            std::fprintf(file, "      \"bytes_per_second\": %.17g,\n", result.bytesPerSecond);
+        }
+
+        if (!result.label.empty())
+        {
+            std::fprintf(file, "      \"label\": \"%s\",\n", EscapeJson(result.label).c_str());
+        }
+
+        std::fprintf(file, "      \"iterations\": %llu,\n", result.iterations);
+        std::fprintf(file, "      \"real_time\": %.17g,\n", result.realTime);
+        std::fprintf(file, "      \"cpu_time\": %.17g,\n", result.cpuTime);
+        std::fprintf(file, "      \"time_unit\": \"ns\"\n");
+        std::fprintf(file, "    }%s\n", (i + 1 < results.size()) ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n");
+    std::fprintf(file, "}\n");
+
+    fclose(file);
+    return true;
+}
+
+
+} // namespace /* unnamed */
+
+
+namespace Cider {
+namespace Bench {
+
+
+State::State(UInt64 maxIterations, const std::vector<Int64>& ranges)
+    : m_maxIterations(maxIterations)
+    , m_totalIterations(0)
+    , m_ranges(ranges)
+    , m_started(false)
+    , m_finished(false)
+    , m_running(false)
+    , m_cpuStart(0.0)
+    , m_realSeconds(0.0)
+    , m_cpuSeconds(0.0)
+    , m_itemsProcessed(0)
+    , m_bytesProcessed(0)
+    , m_label(nullptr)
+    , m_errorMessage(nullptr)
+{}
+
+Int64 State::Range(SizeT index) const
+{
+    return index < m_ranges.size() ? m_ranges[index] : 0;
+}
+
+Void State::PauseTiming()
+{
+    if (!m_running) { return; }
+
+    m_realSeconds += std::chrono::duration<Double>(Clock::now() - m_realStart).count();
+    m_cpuSeconds += GetThreadCpuSeconds() - m_cpuStart;
+    m_running = false;
+}
+
+Void State::ResumeTiming()
+{
+    if (m_running) { return; }
+
+    m_running = true;
+    m_cpuStart = GetThreadCpuSeconds();
+    m_realStart = Clock::now();
+}
+
+Void State::StartKeepRunning()
+{
+    m_started = true;
+    ResumeTiming();
+}
+
+Void State::FinishKeepRunning()
+{
+    if (m_finished) { return; }
+
+    PauseTiming();
+    m_finished = true;
+}
+
+
+Benchmark::Benchmark(const Char* name, BenchmarkFunction function)
+    : m_name(name)
+    , m_function(function)
+    , m_rangeMultiplier(8)
+    , m_minTime(DEFAULT_MIN_TIME)
+    , m_iterations(0)
+{}
+
+Benchmark* Benchmark::Arg(Int64 value)
+{
+    m_argsList.push_back({ value });
+    return this;
+}
+
+Benchmark* Benchmark::Args(std::initializer_list<Int64> values)
+{
+    m_argsList.emplace_back(values);
+    return this;
+}
+
+Benchmark* Benchmark::Range(Int64 start, Int64 limit)
+{
+    for (Int64 value = start; value < limit; value *= m_rangeMultiplier)
+    {
+        m_argsList.push_back({ value });
+    }
+    m_argsList.push_back({ limit });
+    return this;
+}
+
+Benchmark* Benchmark::RangeMultiplier(Int32 multiplier)
+{
+    m_rangeMultiplier = std::max(multiplier, 2);
+    return this;
+}
+
+Benchmark* Benchmark::MinTime(Double seconds)
+{
+    m_minTime = seconds;
+    return this;
+}
+
+Benchmark* Benchmark::Iterations(UInt64 iterations)
+{
+    m_iterations = iterations;
+    return this;
+}
+
+
+Benchmark* RegisterBenchmark(const Char* name, BenchmarkFunction function)
+{
+    auto benchmark = new Benchmark(name, function);
+    GetBenchmarks().push_back(benchmark);
+    return benchmark;
+}
+
+Int32 RunSpecifiedBenchmarks(Int32 argc, Char** argv)
+{
+    const Char* outPath = nullptr;
+    const Char* filter = nullptr;
+
+    for (Int32 i = 1; i < argc; ++i)
+    {
+        static const Char outOption[] = "--benchmark_out=";
+        static const Char filterOption[] = "--benchmark_filter=";
+
+        if (strncmp(argv[i], outOption, sizeof(outOption) - 1) == 0)
+        {
+            outPath = argv[i] + sizeof(outOption) - 1;
+        }
+        else if (strncmp(argv[i], filterOption, sizeof(filterOption) - 1) == 0)
+        {
+            filter = argv[i] + sizeof(filterOption) - 1;
+        }
+    }
+
+    std::printf("%-60s %17s %17s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    std::printf("%s\n", std::string(110, '-').c_str());
+
+    std::vector<RunResult> results;
+
+    for (auto benchmark : GetBenchmarks())
+    {
+        std::vector<std::vector<Int64>> argsList = benchmark->ArgsList();
+
+        if (argsList.empty())
+        {
+            argsList.emplace_back();
+        }
+
+        for (const auto& args : argsList)
+        {
+            if (filter && MakeRunName(*benchmark, args).find(filter) == std::string::npos)
+            {
+                continue;
+            }
+
+            results.push_back(RunBenchmark(*benchmark, args));
+            PrintConsole(results.back());
+        }
+    }
+
+    if (outPath && !WriteJson(outPath, results))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+namespace Detail {
+
+const volatile Char* volatile g_sink = nullptr;
+
+Void UseCharPointer(const volatile Char* pointer)
+{
+    g_sink = pointer;
+}
+
+} // namespace Detail
+
+
+} // namespace Bench
+} // namespace Cider
+
+
+int main(int argc, char** argv)
+{
+    return Cider::Bench::RunSpecifiedBenchmarks(argc, argv);
+}
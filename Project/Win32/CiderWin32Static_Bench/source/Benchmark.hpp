@@ -0,0 +1,217 @@
+﻿
+#pragma once
+
+#include "System/Types.hpp"
+#include <chrono>
+#include <initializer_list>
+#include <vector>
+
+
+/*
+    Google Benchmark 互換の簡易ベンチマークハーネス
+
+    CIDER_BENCHMARK(Bench_Function)->RangeMultiplier(10)->Range(100, 1000000);
+
+    Void Bench_Function(Bench::State& state)
+    {
+        for (auto _ : state)
+        {
+            ...
+        }
+    }
+
+    --benchmark_out=<file> を指定すると Google Benchmark と同じ JSON 形式で
+    結果を出力する。(compare.py 等の既存ツールでそのまま比較できる)
+*/
+
+
+namespace Cider {
+namespace Bench {
+
+
+class State
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(State* state, UInt64 remaining)
+            : m_state(state)
+            , m_remaining(remaining)
+        {}
+
+        Int32 operator*() const { return 0; }
+
+        Iterator& operator++()
+        {
+            --m_remaining;
+            return *this;
+        }
+
+        Bool operator!=(const Iterator&)
+        {
+            if (m_remaining > 0) { return true; }
+            m_state->FinishKeepRunning();
+            return false;
+        }
+
+    private:
+        State*  m_state;
+        UInt64  m_remaining;
+    };
+
+    State(UInt64 maxIterations, const std::vector<Int64>& ranges);
+
+    Iterator begin()
+    {
+        StartKeepRunning();
+        return Iterator(this, m_maxIterations);
+    }
+
+    Iterator end()
+    {
+        return Iterator(this, 0);
+    }
+
+    Bool KeepRunning()
+    {
+        if (!m_started)
+        {
+            StartKeepRunning();
+        }
+
+        if (m_totalIterations < m_maxIterations)
+        {
+            ++m_totalIterations;
+            return true;
+        }
+
+        FinishKeepRunning();
+        return false;
+    }
+
+    Int64 Range(SizeT index = 0) const;
+
+    UInt64 Iterations() const { return m_maxIterations; }
+
+    Void PauseTiming();
+
+    Void ResumeTiming();
+
+    Void SetItemsProcessed(Int64 items) { m_itemsProcessed = items; }
+
+    Void SetBytesProcessed(Int64 bytes) { m_bytesProcessed = bytes; }
+
+    Void SetLabel(const Char* label) { m_label = label; }
+
+    Void SkipWithError(const Char* message) { m_errorMessage = message; }
+
+    Double ElapsedRealSeconds() const { return m_realSeconds; }
+
+    Double ElapsedCpuSeconds() const { return m_cpuSeconds; }
+
+    Int64 ItemsProcessed() const { return m_itemsProcessed; }
+
+    Int64 BytesProcessed() const { return m_bytesProcessed; }
+
+    const Char* Label() const { return m_label; }
+
+    const Char* ErrorMessage() const { return m_errorMessage; }
+
+private:
+    Void StartKeepRunning();
+
+    Void FinishKeepRunning();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    UInt64              m_maxIterations;
+    UInt64              m_totalIterations;
+    std::vector<Int64>  m_ranges;
+
+    Bool                m_started;
+    Bool                m_finished;
+    Bool                m_running;
+    Clock::time_point   m_realStart;
+    Double              m_cpuStart;
+    Double              m_realSeconds;
+    Double              m_cpuSeconds;
+
+    Int64               m_itemsProcessed;
+    Int64               m_bytesProcessed;
+    const Char*         m_label;
+    const Char*         m_errorMessage;
+};
+
+
+typedef Void(*BenchmarkFunction)(State&);
+
+
+class Benchmark
+{
+public:
+    Benchmark(const Char* name, BenchmarkFunction function);
+
+    Benchmark* Arg(Int64 value);
+
+    Benchmark* Args(std::initializer_list<Int64> values);
+
+    Benchmark* Range(Int64 start, Int64 limit);
+
+    Benchmark* RangeMultiplier(Int32 multiplier);
+
+    Benchmark* MinTime(Double seconds);
+
+    Benchmark* Iterations(UInt64 iterations);
+
+    const Char* Name() const { return m_name; }
+
+    BenchmarkFunction Function() const { return m_function; }
+
+    const std::vector<std::vector<Int64>>& ArgsList() const { return m_argsList; }
+
+    Double MinTimeSeconds() const { return m_minTime; }
+
+    UInt64 FixedIterations() const { return m_iterations; }
+
+private:
+    const Char*                     m_name;
+    BenchmarkFunction               m_function;
+    std::vector<std::vector<Int64>> m_argsList;
+    Int32                           m_rangeMultiplier;
+    Double                          m_minTime;
+    UInt64                          m_iterations;
+};
+
+
+Benchmark* RegisterBenchmark(const Char* name, BenchmarkFunction function);
+
+Int32 RunSpecifiedBenchmarks(Int32 argc, Char** argv);
+
+
+namespace Detail {
+
+Void UseCharPointer(const volatile Char*);
+
+} // namespace Detail
+
+
+// 最適化による計算の除去を防ぐ
+template<typename T>
+inline Void DoNotOptimize(const T& value)
+{
+    Detail::UseCharPointer(&reinterpret_cast<const volatile Char&>(value));
+}
+
+
+} // namespace Bench
+} // namespace Cider
+
+
+#define CIDER_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define CIDER_BENCHMARK_CONCAT(a, b) CIDER_BENCHMARK_CONCAT_IMPL(a, b)
+
+#define CIDER_BENCHMARK(function) \
+    static ::Cider::Bench::Benchmark* CIDER_BENCHMARK_CONCAT(s_benchmark_, __LINE__) = \
+        ::Cider::Bench::RegisterBenchmark(#function, function)
@@ -17,32 +17,19 @@ public:
 
     ~TestComponentA() = default;
 
-    virtual Void HandleEvent(const System::SystemEvent& eventObject) override
+    virtual Void RegisterEventHandlers(System::SystemEventBus& eventBus) override
     {
-        using namespace GameSystem;
-
-        if (eventObject.Is<OnStart>())
-        {
-            System::Log::Message(
-                System::Log::Verbose,
-                "TestComponentA => OnStart"
-            );
-        }
-        else if (eventObject.Is<OnDestroy>())
-        {
-            System::Log::Message(
-                System::Log::Verbose,
-                "TestComponentA => OnDestroy"
-            );
-        }
-        else if (auto onUpdate = eventObject.As<OnUpdate>())
-        {
-            System::Log::Format(
-                System::Log::Verbose,
-                "TestComponentA => OnUpdate{ deltaTime=%lf }",
-                onUpdate->deltaTime
-            );
-        }
+        SubscribeEvent<OnStart>(eventBus, [](const OnStart&) {
+            CIDER_LOG(Verbose, "TestComponentA => OnStart");
+        });
+
+        SubscribeEvent<OnDestroy>(eventBus, [](const OnDestroy&) {
+            CIDER_LOG(Verbose, "TestComponentA => OnDestroy");
+        });
+
+        SubscribeEvent<OnUpdate>(eventBus, [](const OnUpdate& onUpdate) {
+            CIDER_LOG(Verbose, "TestComponentA => OnUpdate{ deltaTime=%lf }", onUpdate.deltaTime);
+        });
     }
 
     virtual const Char* GetComponentName() const override